@@ -1,78 +1,343 @@
-#pragma once
-
-class Accumulator;
-
-class Accumulator
-{
-public:
-	Accumulator()
-	{
-		_sum = 0.0f;
-		_residual = 0.0f;
-	}
-	~Accumulator()
-	{
-
-	}
-
-	float sum()
-	{
-		return _sum;
-	}
-
-	void clear()
-	{
-		_sum = 0.0f;
-		_residual = 0.0f;
-	}
-
-	Accumulator operator=(const float rhs)
-	{
-		_sum = rhs;
-		_residual = 0.0f;
-		return *this;
-	}
-
-	Accumulator operator=(const Accumulator& rhs)
-	{
-		_sum = rhs._sum;
-		_residual = rhs._residual;
-		return *this;
-	}
-
-	Accumulator operator+(const float rhs)
-	{
-		Accumulator acc = *this;
-
-		float y = rhs - _residual;
-		float t = _sum + y;
-		acc._residual = (t - _sum) - y;
-		acc._sum = t;
-
-		return acc;
-	}
-
-	Accumulator& operator-(const float rhs)
-	{
-		return (*this) - rhs;
-	}
-
-	Accumulator& operator+=(const float rhs)
-	{
-		float y = rhs - _residual;
-		float t = _sum + y;
-		_residual = (t - _sum) - y;
-		_sum = t;
-
-		return *this;
-	}
-
-	Accumulator& operator-=(const float rhs)
-	{
-		return (*this) += -rhs;
-	}
-
-private:
-	float _sum;
-	float _residual;
-};
\ No newline at end of file
+/*
+Accumulator.h
+Summation with a selectable precision policy.
+
+FloatPrecision: plain single precision sums. Array sums use blocked pairwise summation.
+DoublePrecision: double precision sums.
+CompensatedPrecision: Kahan compensated single precision sums. Array sums use a multi lane
+	Kahan summation, with one compensated sum per vector lane.
+
+The policy of the Accumulator and AccumulatorArray used by the learners is selected at compile
+time with ACCUMULATOR_PRECISION, compensated summation by default.
+*/
+
+#pragma once
+#include <Simd.h>
+
+#ifndef ACCUMULATOR_PRECISION
+#define ACCUMULATOR_PRECISION CompensatedPrecision
+#endif
+
+//number of values summed directly by the blocked pairwise summation.
+#define PAIRWISE_BLOCK_SIZE 128
+
+/*
+Sums 'count' values, with two vectors of independent partial sums.
+*/
+inline float vectorSum(const float* x, int count)
+{
+	FloatVector sum0 = simdSet(0.0f);
+	FloatVector sum1 = simdSet(0.0f);
+	int i = 0;
+	for (; i + 2 * SIMD_WIDTH <= count; i += 2 * SIMD_WIDTH)
+	{
+		sum0 = simdAdd(sum0, simdLoad(&x[i]));
+		sum1 = simdAdd(sum1, simdLoad(&x[i + SIMD_WIDTH]));
+	}
+
+	float lanes[SIMD_WIDTH];
+	simdStore(lanes, simdAdd(sum0, sum1));
+	float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < count; i++)
+		sum += x[i];
+	return sum;
+}
+
+/*
+Blocked pairwise summation. The error grows with log(count) instead of count.
+*/
+inline float pairwiseSum(const float* x, int count)
+{
+	if (count <= PAIRWISE_BLOCK_SIZE)
+		return vectorSum(x, count);
+
+	int half = (count / 2 + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	return pairwiseSum(x, half) + pairwiseSum(x + half, count - half);
+}
+
+/*
+Multi lane Kahan summation. Returns the sum, and stores the compensation in 'compensation',
+the sum of the values is sum - compensation.
+*/
+inline float kahanSum(const float* x, int count, float& compensation)
+{
+	FloatVector sum = simdSet(0.0f);
+	FloatVector residual = simdSet(0.0f);
+	int i = 0;
+	for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+	{
+		FloatVector y = simdSub(simdLoad(&x[i]), residual);
+		FloatVector t = simdAdd(sum, y);
+		residual = simdSub(simdSub(t, sum), y);
+		sum = t;
+	}
+
+	float sums[SIMD_WIDTH];
+	float residuals[SIMD_WIDTH];
+	simdStore(sums, sum);
+	simdStore(residuals, residual);
+
+	//combine the lanes and the remaining values.
+	float s = 0.0f;
+	float c = 0.0f;
+	for (int lane = 0; lane < 2 * SIMD_WIDTH + count - i; lane++)
+	{
+		float value;
+		if (lane < SIMD_WIDTH)
+			value = sums[lane];
+		else if (lane < 2 * SIMD_WIDTH)
+			value = -residuals[lane - SIMD_WIDTH];
+		else
+			value = x[i + lane - 2 * SIMD_WIDTH];
+
+		float y = value - c;
+		float t = s + y;
+		c = (t - s) - y;
+		s = t;
+	}
+	compensation = c;
+	return s;
+}
+
+/*
+Precision policies. Each policy provides the type of the running sum, and the scalar and array
+updates of a sum and its compensation.
+*/
+struct FloatPrecision
+{
+	typedef float Sum;
+
+	static void add(Sum& sum, Sum&, float value)
+	{
+		sum += value;
+	}
+	static void add(Sum& sum, Sum&, const float* x, int count)
+	{
+		sum += pairwiseSum(x, count);
+	}
+	static void addScaled(Sum* sums, Sum*, float scale, const float* x, int count)
+	{
+		int i = 0;
+		FloatVector s = simdSet(scale);
+		for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+			simdStore(&sums[i], simdMulAdd(s, simdLoad(&x[i]), simdLoad(&sums[i])));
+		for (; i < count; i++)
+			sums[i] += scale * x[i];
+	}
+};
+
+struct DoublePrecision
+{
+	typedef double Sum;
+
+	static void add(Sum& sum, Sum&, float value)
+	{
+		sum += value;
+	}
+	static void add(Sum& sum, Sum&, const float* x, int count)
+	{
+		//four independent partial sums.
+		double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			s0 += x[i];
+			s1 += x[i + 1];
+			s2 += x[i + 2];
+			s3 += x[i + 3];
+		}
+		for (; i < count; i++)
+			s0 += x[i];
+		sum += (s0 + s1) + (s2 + s3);
+	}
+	static void addScaled(Sum* sums, Sum*, float scale, const float* x, int count)
+	{
+		for (int i = 0; i < count; i++)
+			sums[i] += (double)scale * x[i];
+	}
+};
+
+struct CompensatedPrecision
+{
+	typedef float Sum;
+
+	static void add(Sum& sum, Sum& residual, float value)
+	{
+		float y = value - residual;
+		float t = sum + y;
+		residual = (t - sum) - y;
+		sum = t;
+	}
+	static void add(Sum& sum, Sum& residual, const float* x, int count)
+	{
+		float compensation;
+		float blockSum = kahanSum(x, count, compensation);
+		add(sum, residual, blockSum);
+		add(sum, residual, -compensation);
+	}
+	static void addScaled(Sum* sums, Sum* residuals, float scale, const float* x, int count)
+	{
+		//independent compensated sums, one per element.
+		int i = 0;
+		FloatVector s = simdSet(scale);
+		for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+		{
+			FloatVector sum = simdLoad(&sums[i]);
+			FloatVector y = simdSub(simdMul(s, simdLoad(&x[i])), simdLoad(&residuals[i]));
+			FloatVector t = simdAdd(sum, y);
+			simdStore(&residuals[i], simdSub(simdSub(t, sum), y));
+			simdStore(&sums[i], t);
+		}
+		for (; i < count; i++)
+			add(sums[i], residuals[i], scale * x[i]);
+	}
+};
+
+template <class Precision>
+class BasicAccumulator
+{
+public:
+	typedef typename Precision::Sum Sum;
+
+	BasicAccumulator()
+	{
+		_sum = 0.0f;
+		_residual = 0.0f;
+	}
+	~BasicAccumulator()
+	{
+
+	}
+
+	float sum()
+	{
+		return (float)_sum;
+	}
+
+	void clear()
+	{
+		_sum = 0.0f;
+		_residual = 0.0f;
+	}
+
+	/*
+	Adds the 'count' values of x, with the array reduction of the precision policy.
+	*/
+	void add(const float* x, int count)
+	{
+		Precision::add(_sum, _residual, x, count);
+	}
+
+	BasicAccumulator& operator=(const float rhs)
+	{
+		_sum = rhs;
+		_residual = 0.0f;
+		return *this;
+	}
+
+	BasicAccumulator& operator=(const BasicAccumulator& rhs)
+	{
+		_sum = rhs._sum;
+		_residual = rhs._residual;
+		return *this;
+	}
+
+	BasicAccumulator operator+(const float rhs)
+	{
+		BasicAccumulator acc = *this;
+		acc += rhs;
+		return acc;
+	}
+
+	BasicAccumulator operator-(const float rhs)
+	{
+		BasicAccumulator acc = *this;
+		acc += -rhs;
+		return acc;
+	}
+
+	BasicAccumulator& operator+=(const float rhs)
+	{
+		Precision::add(_sum, _residual, rhs);
+		return *this;
+	}
+
+	BasicAccumulator& operator-=(const float rhs)
+	{
+		return (*this) += -rhs;
+	}
+
+private:
+	Sum _sum;
+	Sum _residual;
+};
+
+/*
+BasicAccumulatorArray. Array of independent sums, stored as separate arrays of sums and
+compensations so that an update of every element is vectorized.
+*/
+template <class Precision>
+class BasicAccumulatorArray
+{
+public:
+	typedef typename Precision::Sum Sum;
+
+	BasicAccumulatorArray(int size)
+	{
+		_size = size;
+		_sums = new Sum[size];
+		_residuals = new Sum[size];
+		clear();
+	}
+	~BasicAccumulatorArray()
+	{
+		delete[] _sums;
+		delete[] _residuals;
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < _size; i++)
+		{
+			_sums[i] = 0.0f;
+			_residuals[i] = 0.0f;
+		}
+	}
+
+	/*
+	Adds scale * x[i] to every element i.
+	*/
+	void add(float scale, const float* x)
+	{
+		Precision::addScaled(_sums, _residuals, scale, x, _size);
+	}
+
+	/*
+	Adds a value to element i.
+	*/
+	void add(int i, float value)
+	{
+		Precision::add(_sums[i], _residuals[i], value);
+	}
+
+	float sum(int i)
+	{
+		return (float)_sums[i];
+	}
+
+	int size()
+	{
+		return _size;
+	}
+
+private:
+	BasicAccumulatorArray(const BasicAccumulatorArray&);
+	BasicAccumulatorArray& operator=(const BasicAccumulatorArray&);
+
+	Sum* _sums;
+	Sum* _residuals;
+	int _size;
+};
+
+typedef BasicAccumulator<ACCUMULATOR_PRECISION> Accumulator;
+typedef BasicAccumulatorArray<ACCUMULATOR_PRECISION> AccumulatorArray;
\ No newline at end of file
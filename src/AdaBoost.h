@@ -10,14 +10,75 @@ gregjksmith@gmail.com
 
 #pragma once
 #include <vector>
+#include <algorithm>
 #include <Sample.h>
 #include <WeakLearner.h>
 #include <Accumulator.h>
+#include <FastMath.h>
+#include <BinaryFormat.h>
+#include <MappedFile.h>
+
+#define ADABOOST_BINARY_MAGIC 0x54534241
+#define ADABOOST_BINARY_VERSION 2
+
+//default number of rounds without improvement of the validation loss before a class stops training.
+#define EARLY_STOPPING_PATIENCE 10
+
+//number of classes labelled with a stack buffer by labelFast, models of more classes allocate the labels.
+#define ADABOOST_STACK_LABELS 64
+
+/*
+Header of a binary AdaBoost model. The header is followed by the payload: for each class and each
+weak learner, the float ensemble weight and the binary parameters of the weak learner, every entry
+starting at an aligned position. If the classes have different numbers of weak learners, numWeakLearners
+is negated, and the entries of each class follow its int32 number of weak learners. The checksum covers
+the payload. Version 1 models, written before the negated numbers of weak learners, are still loaded.
+*/
+struct AdaBoostBinaryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t numWeakLearners;
+	int32_t n;
+	int32_t k;
+	int32_t reserved;
+	uint64_t payloadSize;
+	uint64_t checksum;
+	uint64_t reserved2;
+};
+
+/*
+Statistics of a boosting round of a class.
+*/
+struct BoostingRound
+{
+	float error;	//weighted error of the weak learner.
+	float alpha;	//ensemble weight of the weak learner.
+	float trainingError;	//fraction of the training samples misclassified by the ensemble of the class after the round.
+	double loss;	//exponential loss of the ensemble after the round, the sum of the initial weights times exp(-y * F(x)).
+	float validationError;	//fraction of the validation samples misclassified by the ensemble of the class, 0 without validation set.
+	double validationLoss;	//exponential loss of the ensemble on the validation set, 0 without validation set.
+};
 
 template <class T>
 class AdaBoost
 {
 public:
+	/*
+	Creates an empty model, to be loaded with importParams.
+	*/
+	AdaBoost()
+	{
+		_ensembles = nullptr;
+		_numWeakLearners = 0;
+		_n = 0;
+		_k = 0;
+		_fastMath = false;
+		_mappedFile = nullptr;
+		_validationSamples = nullptr;
+		_patience = EARLY_STOPPING_PATIENCE;
+	}
+
 	/*
 	Constructor:
 	std::vector<Sample*>& samples: training set. provided as a vector of Samples*.
@@ -25,17 +86,38 @@ public:
 		Training supports multiple classes, where the label can be any non-negative integer.
 	int numWeakLearners: number of weak learners trained. Setting numWeakLearners = 1
 		results in standard non-boosted classification.
+	bool warmStart: if true, the weak learner of each round starts training from the
+		solution of the previous round of the same class. Only the last weak learner of a class
+		keeps its warm start state, and none without warm start.
 	*/
-	AdaBoost(std::vector<Sample*>& samples, int numWeakLearners)
+	AdaBoost(std::vector<Sample*>& samples, int numWeakLearners, bool warmStart = false)
 	{
 		_ensembles = nullptr;
-		train(samples, numWeakLearners);
+		_fastMath = false;
+		_mappedFile = nullptr;
+		_validationSamples = nullptr;
+		_patience = EARLY_STOPPING_PATIENCE;
+		T prototype;
+		train(samples, numWeakLearners, prototype, warmStart);
+	}
+
+	/*
+	Constructor:
+	T& prototype: untrained weak learner holding the training configuration. Every weak
+		learner of the model is created from the prototype.
+	*/
+	AdaBoost(std::vector<Sample*>& samples, int numWeakLearners, T& prototype, bool warmStart = false)
+	{
+		_ensembles = nullptr;
+		_fastMath = false;
+		_mappedFile = nullptr;
+		_validationSamples = nullptr;
+		_patience = EARLY_STOPPING_PATIENCE;
+		train(samples, numWeakLearners, prototype, warmStart);
 	}
 	virtual ~AdaBoost()
 	{
-		for (int k = 0; k < _k; k++)
-			delete _ensembles[k];
-		delete[] _ensembles;
+		clear();
 	}
 
 	/*
@@ -54,6 +136,119 @@ public:
 		return (float)numNegativeSamples / (float)samples.size();
 	}
 
+	/*
+	Resumes boosting, e.g. of an imported model, and appends 'numWeakLearners' rounds to every class.
+	The sample weights of each class are rebuilt from the margins of the existing ensemble on 'samples',
+	so that training continues where it stopped when 'samples' is the original training set, or adapts
+	the model to a new training set. Classes of 'samples' missing from the model are added, and are
+	trained from scratch for every round of the model.
+	If a validation set is set, a class may stop early, see setValidationSet.
+	Returns false if the samples do not have the number of attributes of the model.
+	*/
+	bool continueTraining(std::vector<Sample*>& samples, int numWeakLearners, bool warmStart = false)
+	{
+		T prototype;
+		return continueTraining(samples, numWeakLearners, prototype, warmStart);
+	}
+
+	bool continueTraining(std::vector<Sample*>& samples, int numWeakLearners, T& prototype, bool warmStart = false)
+	{
+		if (samples.size() == 0 || (_k > 0 && samples[0]->n() != _n))
+			return false;
+
+		_fastMath = prototype.fastMath();
+		_n = samples[0]->n();
+		int numClasses = _k;
+		_numWeakLearners += numWeakLearners;
+
+		//add the ensembles of the new classes.
+		int k = getNumClasses(samples);
+		if (k > _k)
+		{
+			Ensemble** ensembles = new Ensemble * [k];
+			for (int c = 0; c < k; c++)
+				ensembles[c] = (c < _k) ? _ensembles[c] : new Ensemble();
+			delete[] _ensembles;
+			_ensembles = ensembles;
+			_k = k;
+		}
+		_rounds.resize(_k);
+
+		//create the dataset scoped cache, shared by the weak learners of every class and round.
+		TrainingCache* trainingCache = prototype.createTrainingCache(samples);
+
+		//the classes of the model append their rounds, the new classes are trained for every round.
+		int* targetNumWeakLearners = new int[_k];
+		for (int c = 0; c < _k; c++)
+			targetNumWeakLearners[c] = (c < numClasses) ? _ensembles[c]->size() + numWeakLearners : _numWeakLearners;
+
+		if (prototype.jointTraining())
+			trainClassesJointly(samples, targetNumWeakLearners, prototype, warmStart, trainingCache);
+		else
+		{
+			for (int c = 0; c < _k; c++)
+				trainClass(samples, c, targetNumWeakLearners[c], prototype, warmStart, trainingCache);
+		}
+		delete[] targetNumWeakLearners;
+
+		_numWeakLearners = 0;
+		for (int c = 0; c < _k; c++)
+			_numWeakLearners = std::max(_numWeakLearners, _ensembles[c]->size());
+
+		delete trainingCache;
+		return true;
+	}
+
+	/*
+	Sets a held-out validation set, used by the following calls of continueTraining. After each round,
+	the exponential loss of the ensemble of the class on the validation set is updated from its cached
+	validation margins, which costs one evaluation of the new weak learner per validation sample.
+	A class stops training when the validation loss did not improve for 'patience' rounds, and its
+	ensemble is truncated to the round with the lowest validation loss. If patience is 0, every round is
+	trained and the ensemble is still truncated. The samples are not owned, and must outlive the
+	training. A nullptr removes the validation set.
+	*/
+	void setValidationSet(std::vector<Sample*>* validationSamples, int patience = EARLY_STOPPING_PATIENCE)
+	{
+		_validationSamples = validationSamples;
+		_patience = patience;
+	}
+
+	/*
+	Returns the statistics of the rounds of class 'classIndex' trained by the model, in order. The rounds
+	of an imported model are not included, the rounds removed by early stopping are.
+	*/
+	const std::vector<BoostingRound>& rounds(int classIndex)
+	{
+		return _rounds[classIndex];
+	}
+
+	/*
+	Returns the number of weak learners of each class, the largest number if the classes differ,
+	e.g. after early stopping.
+	*/
+	int numWeakLearners()
+	{
+		return _numWeakLearners;
+	}
+
+	/*
+	Returns the number of weak learners of class 'classIndex'.
+	*/
+	int numWeakLearners(int classIndex)
+	{
+		return _ensembles[classIndex]->size();
+	}
+
+	/*
+	If fastMath is true, the ensemble uses the approximations of FastMath.h in label. Models
+	trained from a prototype with fast math enabled use them by default.
+	*/
+	void setFastMath(bool fastMath)
+	{
+		_fastMath = fastMath;
+	}
+
 	/*
 	Returns the most likely label for a sample given the learned parameters.
 	Sample* x: input sample.
@@ -61,6 +256,9 @@ public:
 	*/
 	int label(Sample* x, float &confidence)
 	{
+		if (_fastMath)
+			return labelFast(x, confidence);
+
 		float expSum = 0.0f;
 		int maxClassIndex = 0;
 		float maxLabel = _ensembles[0]->label(x);
@@ -80,16 +278,50 @@ public:
 		return maxClassIndex;
 	}
 
+	/*
+	Quantizes the inference parameters of every weak learner, see WeakLearner::quantize.
+	*/
+	void quantize(QuantizationType type)
+	{
+		for (int k = 0; k < _k; k++)
+		{
+			for (int w = 0; w < _ensembles[k]->size(); w++)
+				_ensembles[k]->weakLearner(w)->quantize(type);
+		}
+	}
+
+	/*
+	Returns the size in bytes of the parameters used for inference, of the weak learners and their weights.
+	*/
+	size_t parameterSize()
+	{
+		size_t size = 0;
+		for (int k = 0; k < _k; k++)
+		{
+			for (int w = 0; w < _ensembles[k]->size(); w++)
+				size += _ensembles[k]->weakLearner(w)->parameterSize() + sizeof(float);
+		}
+		return size;
+	}
+
+	/*
+	Stores the model in the text format. If the classes have different numbers of weak learners, the
+	number of weak learners is stored negated, and each class starts with its number of weak learners.
+	*/
 	std::string exportParams()
 	{
+		bool uniform = uniformEnsembles();
 		std::string params;
-		params += std::to_string(_numWeakLearners) + ENSEMBLE_DELIM;
+		params += std::to_string(uniform ? _numWeakLearners : -_numWeakLearners) + ENSEMBLE_DELIM;
 		params += std::to_string(_n) + ENSEMBLE_DELIM;
 		params += std::to_string(_k) + ENSEMBLE_DELIM;
 		
 		for (int k = 0; k < _k; k++)
 		{
-			for (int w = 0; w < _numWeakLearners; w++)
+			if (!uniform)
+				params += std::to_string(_ensembles[k]->size()) + ENSEMBLE_DELIM;
+
+			for (int w = 0; w < _ensembles[k]->size(); w++)
 			{
 				params += std::to_string(_ensembles[k]->weight(w)) + ENSEMBLE_DELIM;
 				params += _ensembles[k]->weakLearner(w)->exportParams() + ENSEMBLE_DELIM;
@@ -98,14 +330,27 @@ public:
 		return params;
 	}
 
+	/*
+	Loads a model in the text format of exportParams. The model is removed from 'params'.
+	*/
 	void importParams(std::string& params)
 	{
-		_numWeakLearners = atoi(getNextParam(params, ENSEMBLE_DELIM).c_str());
-		_n = atoi(getNextParam(params, ENSEMBLE_DELIM).c_str());
-		_k = atoi(getNextParam(params, ENSEMBLE_DELIM).c_str());
+		ParamReader reader(params);
+		importParams(reader);
+		params.erase(0, reader.position());
+	}
 
-		if (_ensembles != nullptr)
-			delete[] _ensembles;
+	void importParams(ParamReader& params)
+	{
+		int numWeakLearners = params.nextInt(ENSEMBLE_DELIM);
+		int n = params.nextInt(ENSEMBLE_DELIM);
+		int k = params.nextInt(ENSEMBLE_DELIM);
+
+		clear();
+		_numWeakLearners = abs(numWeakLearners);
+		_n = n;
+		_k = k;
+		_rounds.resize(_k);
 
 		_ensembles = new Ensemble * [_k];
 		for (int k = 0; k < _k; k++)
@@ -113,10 +358,11 @@ public:
 
 		for (int k = 0; k < _k; k++)
 		{
-			for (int w = 0; w < _numWeakLearners; w++)
+			int size = (numWeakLearners < 0) ? params.nextInt(ENSEMBLE_DELIM) : numWeakLearners;
+			for (int w = 0; w < size; w++)
 			{
-				float alpha = atof(getNextParam(params, ENSEMBLE_DELIM).c_str());
-				std::string weakLearnerParams = getNextParam(params, ENSEMBLE_DELIM);
+				float alpha = params.nextFloat(ENSEMBLE_DELIM);
+				ParamReader weakLearnerParams = params.nextReader(ENSEMBLE_DELIM);
 
 				WeakLearner* weakLearner = new T();
 				weakLearner->importParams(weakLearnerParams);
@@ -126,8 +372,221 @@ public:
 		}
 	}
 
+	/*
+	Stores the model in the binary format, appended to 'buffer'. The buffer is cleared first.
+	*/
+	void exportBinary(std::vector<char>& buffer)
+	{
+		buffer.clear();
+		BinaryWriter writer(buffer);
+
+		AdaBoostBinaryHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = ADABOOST_BINARY_MAGIC;
+		header.version = ADABOOST_BINARY_VERSION;
+		bool uniform = uniformEnsembles();
+		header.numWeakLearners = uniform ? _numWeakLearners : -_numWeakLearners;
+		header.n = _n;
+		header.k = _k;
+		writer.write(header);
+		writer.align();
+
+		size_t payloadStart = writer.position();
+		for (int k = 0; k < _k; k++)
+		{
+			if (!uniform)
+			{
+				writer.write((int32_t)_ensembles[k]->size());
+				writer.align();
+			}
+
+			for (int w = 0; w < _ensembles[k]->size(); w++)
+			{
+				writer.write(_ensembles[k]->weight(w));
+				writer.align();
+				_ensembles[k]->weakLearner(w)->exportBinary(writer);
+				writer.align();
+			}
+		}
+
+		header.payloadSize = writer.position() - payloadStart;
+		header.checksum = binaryChecksum(&buffer[payloadStart], header.payloadSize);
+		memcpy(&buffer[0], &header, sizeof(header));
+	}
+
+	/*
+	Loads a binary model from 'size' bytes at 'data', which must be aligned to BINARY_ALIGNMENT.
+	The parameters of the weak learners reference the data in place, the data must outlive the model.
+	bool verifyChecksum: if false, the checksum of the payload is not computed, e.g. for a trusted
+		model file, such that loading does not touch the parameter pages.
+	Returns false, and leaves the model unchanged, if the data is not a valid model.
+	*/
+	bool importBinary(const char* data, size_t size, bool verifyChecksum = true)
+	{
+		if (data == nullptr || (uintptr_t)data % BINARY_ALIGNMENT != 0)
+			return false;
+
+		BinaryReader reader(data, size);
+		AdaBoostBinaryHeader header;
+		if (!reader.read(header))
+			return false;
+		if (header.magic != ADABOOST_BINARY_MAGIC || header.version < 1 || header.version > ADABOOST_BINARY_VERSION)
+			return false;
+		if (header.version == 1 && header.numWeakLearners < 0)
+			return false;
+		if (header.n < 0 || header.k <= 0)
+			return false;
+
+		reader.align();
+		size_t payloadStart = reader.position();
+		if (header.payloadSize > size - payloadStart)
+			return false;
+		if (verifyChecksum && binaryChecksum(data + payloadStart, header.payloadSize) != header.checksum)
+			return false;
+
+		Ensemble** ensembles = new Ensemble * [header.k];
+		for (int k = 0; k < header.k; k++)
+			ensembles[k] = new Ensemble();
+
+		bool valid = true;
+		for (int k = 0; k < header.k && valid; k++)
+		{
+			int32_t size = header.numWeakLearners;
+			if (header.numWeakLearners < 0)
+			{
+				valid = reader.read(size) && size >= 0;
+				reader.align();
+			}
+
+			for (int w = 0; w < size && valid; w++)
+			{
+				float alpha;
+				reader.read(alpha);
+				reader.align();
+
+				WeakLearner* weakLearner = new T();
+				valid = reader.valid() && weakLearner->importBinary(reader, header.n);
+				reader.align();
+				ensembles[k]->addWeakLearner(weakLearner, alpha);
+			}
+		}
+
+		if (!valid)
+		{
+			for (int k = 0; k < header.k; k++)
+				delete ensembles[k];
+			delete[] ensembles;
+			return false;
+		}
+
+		clear();
+		_ensembles = ensembles;
+		_numWeakLearners = abs(header.numWeakLearners);
+		_n = header.n;
+		_k = header.k;
+		_rounds.resize(_k);
+		return true;
+	}
+
+	/*
+	Writes the binary model to a file. Returns false if the file could not be written.
+	*/
+	bool saveBinary(const std::string& path)
+	{
+		std::vector<char> buffer;
+		exportBinary(buffer);
+
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write(buffer.data(), buffer.size());
+		return file.good();
+	}
+
+	/*
+	Loads a binary model file by memory mapping it. The model is used in place, no parameter is
+	parsed or copied, and the pages of the file are shared between processes serving the same model.
+	The mapping is owned by the model.
+	*/
+	bool loadBinary(const std::string& path, bool verifyChecksum = true)
+	{
+		MappedFile* mappedFile = new MappedFile(path);
+		if (!mappedFile->isOpen() || !importBinary(mappedFile->data(), mappedFile->size(), verifyChecksum))
+		{
+			delete mappedFile;
+			return false;
+		}
+
+		//importBinary released the previous mapping.
+		_mappedFile = mappedFile;
+		return true;
+	}
+
 private:
 
+	/*
+	Releases the ensembles, and the mapped model file they reference.
+	*/
+	void clear()
+	{
+		if (_ensembles != nullptr)
+		{
+			for (int k = 0; k < _k; k++)
+				delete _ensembles[k];
+			delete[] _ensembles;
+		}
+		_ensembles = nullptr;
+		_k = 0;
+		_rounds.clear();
+
+		delete _mappedFile;
+		_mappedFile = nullptr;
+	}
+
+	/*
+	Returns true if every class has _numWeakLearners weak learners.
+	*/
+	bool uniformEnsembles()
+	{
+		for (int k = 0; k < _k; k++)
+		{
+			if (_ensembles[k]->size() != _numWeakLearners)
+				return false;
+		}
+		return true;
+	}
+
+	/*
+	label with fast math, the softmax confidence is computed with a log sum exp.
+	*/
+	int labelFast(Sample* x, float& confidence)
+	{
+		confidence = 0.0f;
+		if (_k <= 0)
+			return 0;
+
+		//the labels of most models fit on the stack.
+		float stackLabels[ADABOOST_STACK_LABELS];
+		std::vector<float> heapLabels;
+		float* labels = stackLabels;
+		if (_k > ADABOOST_STACK_LABELS)
+		{
+			heapLabels.resize(_k);
+			labels = heapLabels.data();
+		}
+
+		int maxClassIndex = 0;
+		for (int i = 0; i < _k; i++)
+		{
+			labels[i] = _ensembles[i]->label(x);
+			if (labels[i] > labels[maxClassIndex])
+				maxClassIndex = i;
+		}
+
+		confidence = fastExp(labels[maxClassIndex] - fastLogSumExp(labels, _k));
+		return maxClassIndex;
+	}
+
 	/*
 	Ensembe
 	private nested container class.
@@ -172,6 +631,11 @@ private:
 			return l;
 		}
 
+		int size()
+		{
+			return _weakLearners.size();
+		}
+
 		WeakLearner* weakLearner(int index)
 		{
 			return _weakLearners[index];
@@ -182,87 +646,441 @@ private:
 			return _weights[index];
 		}
 
+		/*
+		Removes the weak learners after the first 'size'.
+		*/
+		void truncate(int size)
+		{
+			for (int i = size; i < _weakLearners.size(); i++)
+				delete _weakLearners[i];
+			_weakLearners.resize(size);
+			_weights.resize(size);
+		}
+
 	private:
 		std::vector<WeakLearner*> _weakLearners;
 		std::vector<float> _weights;
 	};
 
-	void train(std::vector<Sample*>& samples, int numWeakLearners)
+	void train(std::vector<Sample*>& samples, int numWeakLearners, T& prototype, bool warmStart)
+	{
+		_n = samples[0]->n();
+		_numWeakLearners = 0;
+		_k = 0;
+		continueTraining(samples, numWeakLearners, prototype, warmStart);
+	}
+
+	/*
+	Computes the signed labels y of class 'classIndex', and the initial sample weights, such that the positive
+	and the negative samples have the same total weight. If the ensemble of the class has weak learners, the
+	margins y * F(x) of the ensemble are stored in 'margins', and the weights are multiplied by exp(-y * F(x)),
+	which are the weights after the existing rounds, and normalized. Only the log weights are computed, to
+	avoid overflowing exp.
+	Returns the exponential loss of the ensemble, the sum of the initial weights times exp(-y * F(x)).
+	*/
+	double initWeights(std::vector<Sample*>& samples, int classIndex, float* labelSigns, float* w, float* margins, float* computedLabels)
 	{
 		int numSamples = samples.size();
+		int numPositiveSamples = 0;
+		for (int i = 0; i < numSamples; i++)
+		{
+			if (samples[i]->y() == classIndex)
+				numPositiveSamples++;
+		}
 
-		//create the samples weights, initialize with uniform weighting.
-		float* w = new float[numSamples];
+		for (int i = 0; i < numSamples; i++)
+		{
+			labelSigns[i] = binaryLabel(samples[i]->y(), classIndex);
+			margins[i] = 0.0f;
 
-		//get the number of attributes for each sample.
-		_n = samples[0]->n();
-		_numWeakLearners = numWeakLearners;
+			if (samples[i]->y() == classIndex)
+				w[i] = 1.0f / (float)(numPositiveSamples * 2);
+			else
+				w[i] = 1.0f / (float)((numSamples - numPositiveSamples) * 2);
 
-		//compute the number of unique classes in the sample set.
-		_k = getNumClasses(samples);
+			//a class without positive or without negative samples starts from uniform weights.
+			if (numPositiveSamples == 0 || numPositiveSamples == numSamples)
+				w[i] = 1.0f / (float)numSamples;
+		}
 
-		_ensembles = new Ensemble * [_k];
-		for (int k = 0; k < _k; k++)
-			_ensembles[k] = new Ensemble();
-		
-		float* computedLabels = new float[numSamples];
+		Ensemble* ensemble = _ensembles[classIndex];
+		if (ensemble->size() == 0)
+			return 1.0;
 
-		for (int k = 0; k < _k; k++)
+		//sum the margins in double precision, the ensemble may have many rounds.
+		double* logW = new double[numSamples];
+		for (int i = 0; i < numSamples; i++)
+			logW[i] = 0.0;
+
+		for (int wl = 0; wl < ensemble->size(); wl++)
 		{
-			int numPositiveSamples = 0;
+			ensemble->weakLearner(wl)->labelBatch(samples, computedLabels);
 			for (int i = 0; i < numSamples; i++)
+				logW[i] += (double)ensemble->weight(wl) * computedLabels[i] * labelSigns[i];
+		}
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			margins[i] = (float)logW[i];
+			logW[i] = log((double)w[i]) - logW[i];
+		}
+
+		double maxLogW = logW[0];
+		for (int i = 1; i < numSamples; i++)
+			maxLogW = fmax(maxLogW, logW[i]);
+
+		Accumulator weightSum;
+		for (int i = 0; i < numSamples; i++)
+		{
+			w[i] = exp(logW[i] - maxLogW);
+			weightSum += w[i];
+		}
+		for (int i = 0; i < numSamples; i++)
+			w[i] /= weightSum.sum();
+
+		delete[] logW;
+		return exp(maxLogW) * (double)weightSum.sum();
+	}
+
+	/*
+	Training state of the ensemble of a class: the sample weights, the cached margins y * F(x) and the
+	validation state, from beginClass to endClass.
+	*/
+	struct ClassTraining
+	{
+		int classIndex;
+		int numWeakLearners;	//size of the ensemble at the end of the training.
+		bool done;
+		float* w;
+		float* computedLabels;
+		float* labelSigns;
+		float* margins;
+		double loss;
+
+		int numValidationSamples;
+		float* validationW;
+		float* validationLabels;
+		float* validationSigns;
+		float* validationMargins;
+		double validationLoss;
+		int bestSize;	//the ensemble is truncated to the size with the lowest validation loss, at least one weak learner.
+		double bestValidationLoss;
+
+		WeakLearner* previousWeakLearner;
+	};
+
+	/*
+	Appends boosting rounds to the ensemble of class 'classIndex', until it has 'numWeakLearners' weak learners.
+	The margins y * F(x) of the ensemble are cached per sample for the whole class. After the weak learner of
+	a round is trained and labels the samples, a single pass computes the weighted error, and a second pass
+	applies the ensemble weight to the margins and to the sample weights. The validation set, if any, keeps
+	the same state and is updated by the same passes, its weight sums give the validation loss.
+	*/
+	void trainClass(std::vector<Sample*>& samples, int classIndex, int numWeakLearners, T& prototype, bool warmStart, TrainingCache* trainingCache)
+	{
+		ClassTraining state;
+		beginClass(state, samples, classIndex, numWeakLearners);
+		while (!state.done)
+		{
+			//train a weak learner with the sample weights.
+			WeakLearner* weakLearner = createWeakLearner(state, prototype, warmStart, trainingCache);
+			weakLearner->train(samples, state.w, classIndex);
+			weakLearner->setTrainingCache(nullptr);
+			if (!warmStart)
+				weakLearner->releaseWarmStart();
+			addRound(state, samples, weakLearner);
+		}
+		endClass(state);
+	}
+
+	/*
+	Trains the classes round by round, the weak learners of a round of every class with a single call to
+	trainClasses of the prototype, which shares the passes over the training set between the classes. The
+	rounds of a class depend only on the previous rounds of the class, so the model is the one trained by
+	trainClass, class after class. The state of every class is kept for the whole training.
+	*/
+	void trainClassesJointly(std::vector<Sample*>& samples, int* numWeakLearners, T& prototype, bool warmStart, TrainingCache* trainingCache)
+	{
+		std::vector<ClassTraining> states(_k);
+		for (int c = 0; c < _k; c++)
+			beginClass(states[c], samples, c, numWeakLearners[c]);
+
+		std::vector<WeakLearner*> weakLearners;
+		std::vector<float*> sampleWeights;
+		std::vector<int> classIndices;
+		while (true)
+		{
+			weakLearners.clear();
+			sampleWeights.clear();
+			classIndices.clear();
+			for (int c = 0; c < _k; c++)
 			{
-				if (samples[i]->y() == k)
-					numPositiveSamples++;
+				if (states[c].done)
+					continue;
+				weakLearners.push_back(createWeakLearner(states[c], prototype, warmStart, trainingCache));
+				sampleWeights.push_back(states[c].w);
+				classIndices.push_back(c);
 			}
-			
-			for (int i = 0; i < numSamples; i++)
+			if (weakLearners.size() == 0)
+				break;
+
+			int numClasses = weakLearners.size();
+			if (!prototype.trainClasses(samples, sampleWeights.data(), classIndices.data(), numClasses, weakLearners.data()))
 			{
-				if (samples[i]->y() == k)
-					w[i] = 1.0f / (float)(numPositiveSamples * 2);
-				else
-					w[i] = 1.0f / (float)((numSamples - numPositiveSamples) * 2);
+				for (int i = 0; i < numClasses; i++)
+					weakLearners[i]->train(samples, sampleWeights[i], classIndices[i]);
 			}
 
-			for (int wl = 0; wl < _numWeakLearners; wl++)
+			for (int i = 0; i < numClasses; i++)
 			{
-				//train a weak learner with the sample weights.
-				WeakLearner* weakLearner = new T();
-				weakLearner->train(samples, w, k);
-
-				Accumulator errorSum;
-				for (int i = 0; i < numSamples; i++)
-				{
-					Sample* x = samples[i];
-					computedLabels[i] = weakLearner->label(x);
-					if (computedLabels[i] * binaryLabel(x->y(), k) <= 0.0f)
-					{
-						errorSum += w[i];
-					}
-				}
-
-				//compute the AdaBoost ensemble weight.
-				float alpha = log((1.0f - fmax(errorSum.sum(), 1e-9f)) / fmax(errorSum.sum(), 1e-9f));
-				_ensembles[k]->addWeakLearner(weakLearner, alpha);
+				weakLearners[i]->setTrainingCache(nullptr);
+				if (!warmStart)
+					weakLearners[i]->releaseWarmStart();
+				addRound(states[classIndices[i]], samples, weakLearners[i]);
+			}
+		}
+
+		for (int c = 0; c < _k; c++)
+			endClass(states[c]);
+	}
+
+	/*
+	Initializes the training state of class 'classIndex', from the margins of its ensemble.
+	*/
+	void beginClass(ClassTraining& state, std::vector<Sample*>& samples, int classIndex, int numWeakLearners)
+	{
+		int numSamples = samples.size();
+		Ensemble* ensemble = _ensembles[classIndex];
+		state.classIndex = classIndex;
+		state.numWeakLearners = numWeakLearners;
+		state.done = ensemble->size() >= numWeakLearners;
+
+		state.w = new float[numSamples];
+		state.computedLabels = new float[numSamples];
+		state.labelSigns = new float[numSamples];
+		state.margins = new float[numSamples];
+		state.loss = initWeights(samples, classIndex, state.labelSigns, state.w, state.margins, state.computedLabels);
 
-				//recalculate the sample weights.
-				Accumulator weightSum;
-				for (int i = 0; i < numSamples; i++)
-				{
-					Sample* x = samples[i];
-					float wFactor = exp(-alpha * computedLabels[i] * binaryLabel(x->y(), k));
-					w[i] = w[i] * wFactor;
-					weightSum += w[i];
-				}
-
-				for (int i = 0; i < numSamples; i++)
-				{
-					w[i] /= weightSum.sum();
-				}
+		state.numValidationSamples = (_validationSamples != nullptr) ? _validationSamples->size() : 0;
+		state.validationW = nullptr;
+		state.validationLabels = nullptr;
+		state.validationSigns = nullptr;
+		state.validationMargins = nullptr;
+		state.validationLoss = 0.0;
+		if (state.numValidationSamples > 0)
+		{
+			int numValidationSamples = state.numValidationSamples;
+			state.validationW = new float[numValidationSamples];
+			state.validationLabels = new float[numValidationSamples];
+			state.validationSigns = new float[numValidationSamples];
+			state.validationMargins = new float[numValidationSamples];
+			state.validationLoss = initWeights(*_validationSamples, classIndex, state.validationSigns, state.validationW, state.validationMargins, state.validationLabels);
+		}
+
+		state.bestSize = ensemble->size();
+		state.bestValidationLoss = (state.bestSize > 0) ? state.validationLoss : HUGE_VAL;
+
+		state.previousWeakLearner = nullptr;
+		if (ensemble->size() > 0)
+			state.previousWeakLearner = ensemble->weakLearner(ensemble->size() - 1);
+	}
+
+	/*
+	Creates the weak learner of the next round of a class, ready to train, seeded from rand.
+	*/
+	WeakLearner* createWeakLearner(ClassTraining& state, T& prototype, bool warmStart, TrainingCache* trainingCache)
+	{
+		WeakLearner* weakLearner = prototype.create();
+		weakLearner->setRandomSeed(rand());
+		//only the last learner of a class keeps its warm start state.
+		if (warmStart && state.previousWeakLearner != nullptr)
+		{
+			weakLearner->warmStart(state.previousWeakLearner);
+			state.previousWeakLearner->releaseWarmStart();
+		}
+		weakLearner->setTrainingCache(trainingCache);
+		return weakLearner;
+	}
+
+	/*
+	Adds a trained weak learner to the ensemble of a class, and updates the training state. Sets state.done
+	once the ensemble has its number of weak learners, or the validation loss stopped improving.
+	*/
+	void addRound(ClassTraining& state, std::vector<Sample*>& samples, WeakLearner* weakLearner)
+	{
+		int numSamples = samples.size();
+		int numValidationSamples = state.numValidationSamples;
+		Ensemble* ensemble = _ensembles[state.classIndex];
+
+		weakLearner->labelBatch(samples, state.computedLabels);
+		float error = roundError(state.labelSigns, state.w, state.computedLabels, numSamples);
+
+		//compute the AdaBoost ensemble weight.
+		float alpha = log((1.0f - fmax(error, 1e-9f)) / fmax(error, 1e-9f));
+		ensemble->addWeakLearner(weakLearner, alpha);
+		state.previousWeakLearner = weakLearner;
+
+		//update the margins and the sample weights. The weight sum of the round is the factor of the
+		//exponential loss of the ensemble.
+		int numErrors;
+		float weightSum = applyRound(alpha, state.computedLabels, state.margins, state.w, numSamples, numErrors);
+		state.loss *= weightSum;
+
+		BoostingRound round;
+		round.error = error;
+		round.alpha = alpha;
+		round.trainingError = (float)numErrors / (float)numSamples;
+		round.loss = state.loss;
+		round.validationError = 0.0f;
+		round.validationLoss = 0.0;
+		normalizeWeights(state.w, numSamples, weightSum);
+
+		if (numValidationSamples > 0)
+		{
+			weakLearner->labelBatch(*_validationSamples, state.validationLabels);
+			roundError(state.validationSigns, state.validationW, state.validationLabels, numValidationSamples);
+
+			int numValidationErrors;
+			float validationWeightSum = applyRound(alpha, state.validationLabels, state.validationMargins, state.validationW, numValidationSamples, numValidationErrors);
+			state.validationLoss *= validationWeightSum;
+			normalizeWeights(state.validationW, numValidationSamples, validationWeightSum);
+
+			round.validationError = (float)numValidationErrors / (float)numValidationSamples;
+			round.validationLoss = state.validationLoss;
+		}
+		_rounds[state.classIndex].push_back(round);
+
+		if (ensemble->size() >= state.numWeakLearners)
+			state.done = true;
+
+		if (numValidationSamples > 0)
+		{
+			if (state.validationLoss < state.bestValidationLoss)
+			{
+				state.bestValidationLoss = state.validationLoss;
+				state.bestSize = ensemble->size();
 			}
+			else if (_patience > 0 && ensemble->size() - state.bestSize >= _patience)
+				state.done = true;
 		}
 	}
 
+	/*
+	Truncates the ensemble of a class to its best size if a validation set is set, and releases the state.
+	*/
+	void endClass(ClassTraining& state)
+	{
+		if (state.numValidationSamples > 0)
+			_ensembles[state.classIndex]->truncate(state.bestSize);
+
+		delete[] state.w;
+		delete[] state.computedLabels;
+		delete[] state.labelSigns;
+		delete[] state.margins;
+		delete[] state.validationW;
+		delete[] state.validationLabels;
+		delete[] state.validationSigns;
+		delete[] state.validationMargins;
+	}
+
+	/*
+	Divides the 'count' weights by their sum.
+	*/
+	void normalizeWeights(float* w, int count, float sum)
+	{
+		int i = 0;
+		FloatVector sumVector = simdSet(sum);
+		for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+			simdStore(&w[i], simdDiv(simdLoad(&w[i]), sumVector));
+		for (; i < count; i++)
+			w[i] /= sum;
+	}
+
+	/*
+	Error pass of a round. Replaces the labels h(x) of the weak learner by the products y * h(x) with the
+	signed labels, and returns the weighted error of the round, the weight of the samples with y * h(x) <= 0.
+	A NaN label is an error.
+	*/
+	float roundError(float* labelSigns, float* w, float* computedLabels, int numSamples)
+	{
+		Accumulator errorSum;
+		FloatVector zero = simdSet(0.0f);
+
+		int i = 0;
+		for (; i + SIMD_WIDTH <= numSamples; i += SIMD_WIDTH)
+		{
+			FloatVector product = simdMul(simdLoad(&labelSigns[i]), simdLoad(&computedLabels[i]));
+			simdStore(&computedLabels[i], product);
+			errorSum += simdSum(simdSelect(simdLess(zero, product), zero, simdLoad(&w[i])));
+		}
+		for (; i < numSamples; i++)
+		{
+			computedLabels[i] *= labelSigns[i];
+			if (!(computedLabels[i] > 0.0f))
+				errorSum += w[i];
+		}
+		return errorSum.sum();
+	}
+
+	/*
+	Applies the ensemble weight 'alpha' of a round, given the products y * h(x) of the error pass: adds
+	alpha * y * h(x) to the margins, and multiplies the sample weights by exp(-alpha * y * h(x)).
+	Returns the sum of the updated weights, and the number of samples misclassified by the ensemble in 'numErrors'.
+	*/
+	float applyRound(float alpha, float* products, float* margins, float* w, int numSamples, int& numErrors)
+	{
+		Accumulator weightSum;
+		FloatVector zero = simdSet(0.0f);
+		FloatVector one = simdSet(1.0f);
+		FloatVector alphaVector = simdSet(alpha);
+		FloatVector negativeAlpha = simdSet(-alpha);
+		FloatVector errors = zero;
+
+		int i = 0;
+		for (; i + SIMD_WIDTH <= numSamples; i += SIMD_WIDTH)
+		{
+			FloatVector product = simdLoad(&products[i]);
+			FloatVector margin = simdMulAdd(alphaVector, product, simdLoad(&margins[i]));
+			simdStore(&margins[i], margin);
+			errors = simdAdd(errors, simdSelect(simdLess(zero, margin), zero, one));
+
+			FloatVector factor = simdMul(negativeAlpha, product);
+			if (_fastMath)
+				factor = simdExp(factor);
+			else
+				factor = exactExp(factor);
+
+			FloatVector weight = simdMul(simdLoad(&w[i]), factor);
+			simdStore(&w[i], weight);
+			weightSum += simdSum(weight);
+		}
+
+		numErrors = (int)simdSum(errors);
+		for (; i < numSamples; i++)
+		{
+			margins[i] += alpha * products[i];
+			if (!(margins[i] > 0.0f))
+				numErrors++;
+
+			float factor = -alpha * products[i];
+			w[i] *= _fastMath ? fastExp(factor) : exp(factor);
+			weightSum += w[i];
+		}
+		return weightSum.sum();
+	}
+
+	/*
+	Computes exp of every lane with the standard library, the results are those of the scalar exp.
+	*/
+	FloatVector exactExp(FloatVector x)
+	{
+		float values[SIMD_WIDTH];
+		simdStore(values, x);
+		for (int i = 0; i < SIMD_WIDTH; i++)
+			values[i] = exp(values[i]);
+		return simdLoad(values);
+	}
+
 	/*
 	Get the total number of unique classes in a sample set. 
 	*/
@@ -288,4 +1106,9 @@ private:
 	int _numWeakLearners;
 	int _n;
 	int _k;
+	bool _fastMath;
+	std::vector<std::vector<BoostingRound>> _rounds;	//statistics of the rounds trained by the model, per class.
+	std::vector<Sample*>* _validationSamples;	//held-out samples for early stopping, nullptr if none.
+	int _patience;
+	MappedFile* _mappedFile;	//model file referenced by the weak learners, nullptr if the model is not mapped.
 };
\ No newline at end of file
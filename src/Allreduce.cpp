@@ -0,0 +1,450 @@
+#include <Allreduce.h>
+
+#ifdef _WIN32
+
+Allreduce::Allreduce(int rank, int size, const std::string& host, int port)
+{
+	_rank = rank;
+	_size = size;
+	_open = false;
+}
+
+Allreduce::Allreduce(int rank, int size, int listener, int port)
+{
+	_rank = rank;
+	_size = size;
+	_open = false;
+}
+
+bool Allreduce::accept(int listener)
+{
+	return false;
+}
+
+bool Allreduce::connect(const std::string& host, int port)
+{
+	return false;
+}
+
+Allreduce::~Allreduce()
+{
+}
+
+void Allreduce::close()
+{
+	_open = false;
+}
+
+bool Allreduce::sum(double* values, size_t count)
+{
+	return false;
+}
+
+bool Allreduce::allgather(const std::string& data, std::vector<std::string>& gathered)
+{
+	return false;
+}
+
+bool launchWorkers(int numWorkers, const std::function<bool(Allreduce&)>& worker)
+{
+	return false;
+}
+
+#else
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+/*
+Sends 'size' bytes, returns false if the connection failed.
+*/
+static bool sendAll(int socket, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t sent = send(socket, bytes, size, SEND_FLAGS);
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+/*
+Receives 'size' bytes, returns false if the connection failed or was closed.
+*/
+static bool receiveAll(int socket, void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		ssize_t received = recv(socket, bytes, size, 0);
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+/*
+Sends a string, preceded by its length.
+*/
+static bool sendString(int socket, const std::string& data)
+{
+	uint64_t length = data.size();
+	return sendAll(socket, &length, sizeof(length)) && sendAll(socket, data.data(), data.size());
+}
+
+static bool receiveString(int socket, std::string& data)
+{
+	uint64_t length;
+	if (!receiveAll(socket, &length, sizeof(length)))
+		return false;
+	data.resize(length);
+	return receiveAll(socket, &data[0], length);
+}
+
+/*
+Waits until 'socket' is readable, or accepts a connection if it listens. Returns false at the deadline.
+*/
+static bool waitReadable(int socket, std::chrono::steady_clock::time_point deadline)
+{
+	while (true)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0)
+			return false;
+
+		pollfd request;
+		request.fd = socket;
+		request.events = POLLIN;
+		request.revents = 0;
+		int ready = poll(&request, 1, (int)remaining.count());
+		if (ready > 0)
+			return true;
+		if (ready < 0 && errno != EINTR)
+			return false;
+	}
+}
+
+/*
+Sends the messages of every sum or gather without waiting for a full packet.
+*/
+static void setNoDelay(int socket)
+{
+	int noDelay = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+}
+
+Allreduce::Allreduce(int rank, int size, const std::string& host, int port)
+{
+	_rank = rank;
+	_size = size;
+	_open = false;
+	if (size <= 1)
+	{
+		_open = true;
+		return;
+	}
+
+	if (rank != 0)
+	{
+		_open = connect(host, port);
+		return;
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+		return;
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0)
+		return;
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) == 0 && listen(listener, size) == 0)
+		_open = accept(listener);
+	::close(listener);
+}
+
+Allreduce::Allreduce(int rank, int size, int listener, int port)
+{
+	_rank = rank;
+	_size = size;
+	_open = false;
+	if (rank == 0)
+	{
+		_open = accept(listener);
+		::close(listener);
+	}
+	else
+		_open = connect("127.0.0.1", port);
+}
+
+Allreduce::~Allreduce()
+{
+	close();
+}
+
+bool Allreduce::accept(int listener)
+{
+	//the other workers must connect and send their rank before the timeout.
+	_sockets.assign(_size, -1);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(ALLREDUCE_CONNECT_TIMEOUT);
+	for (int i = 1; i < _size; i++)
+	{
+		if (!waitReadable(listener, deadline))
+			return false;
+		int socket = ::accept(listener, nullptr, nullptr);
+		if (socket < 0)
+			return false;
+
+		int32_t rank;
+		if (!waitReadable(socket, deadline) || !receiveAll(socket, &rank, sizeof(rank)) || rank <= 0 || rank >= _size || _sockets[rank] >= 0)
+		{
+			::close(socket);
+			return false;
+		}
+		setNoDelay(socket);
+		_sockets[rank] = socket;
+	}
+	return true;
+}
+
+bool Allreduce::connect(const std::string& host, int port)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+		return false;
+
+	//rank 0 may not listen yet, retry until the timeout.
+	int socket = -1;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(ALLREDUCE_CONNECT_TIMEOUT);
+	while (socket < 0 && std::chrono::steady_clock::now() < deadline)
+	{
+		socket = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (socket >= 0 && ::connect(socket, addresses->ai_addr, addresses->ai_addrlen) != 0)
+		{
+			::close(socket);
+			socket = -1;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	}
+	freeaddrinfo(addresses);
+	if (socket < 0)
+		return false;
+
+	setNoDelay(socket);
+	_sockets.assign(1, socket);
+	int32_t rank = _rank;
+	return sendAll(socket, &rank, sizeof(rank));
+}
+
+void Allreduce::close()
+{
+	for (int i = 0; i < _sockets.size(); i++)
+	{
+		if (_sockets[i] >= 0)
+			::close(_sockets[i]);
+	}
+	_sockets.clear();
+	_open = false;
+}
+
+bool Allreduce::sum(double* values, size_t count)
+{
+	if (!_open)
+		return false;
+	if (_size == 1)
+		return true;
+
+	uint64_t size = count;
+	if (_rank == 0)
+	{
+		//add the values of the workers in rank order, then send the sums to every worker.
+		_buffer.assign(values, values + count);
+		std::vector<double> partial(count);
+		for (int r = 1; r < _size; r++)
+		{
+			uint64_t workerSize;
+			if (!receiveAll(_sockets[r], &workerSize, sizeof(workerSize)) || workerSize != size ||
+				!receiveAll(_sockets[r], partial.data(), sizeof(double) * count))
+			{
+				close();
+				return false;
+			}
+			for (size_t i = 0; i < count; i++)
+				_buffer[i] += partial[i];
+		}
+
+		for (int r = 1; r < _size; r++)
+		{
+			if (!sendAll(_sockets[r], _buffer.data(), sizeof(double) * count))
+			{
+				close();
+				return false;
+			}
+		}
+	}
+	else
+	{
+		_buffer.resize(count);
+		if (!sendAll(_sockets[0], &size, sizeof(size)) || !sendAll(_sockets[0], values, sizeof(double) * count) ||
+			!receiveAll(_sockets[0], _buffer.data(), sizeof(double) * count))
+		{
+			close();
+			return false;
+		}
+	}
+
+	memcpy(values, _buffer.data(), sizeof(double) * count);
+	return true;
+}
+
+bool Allreduce::allgather(const std::string& data, std::vector<std::string>& gathered)
+{
+	gathered.clear();
+	if (!_open)
+		return false;
+
+	gathered.resize(_size);
+	if (_size == 1)
+	{
+		gathered[0] = data;
+		return true;
+	}
+
+	bool success = true;
+	if (_rank == 0)
+	{
+		gathered[0] = data;
+		for (int r = 1; r < _size && success; r++)
+			success = receiveString(_sockets[r], gathered[r]);
+		for (int r = 1; r < _size && success; r++)
+		{
+			for (int i = 0; i < _size && success; i++)
+				success = sendString(_sockets[r], gathered[i]);
+		}
+	}
+	else
+	{
+		success = sendString(_sockets[0], data);
+		for (int i = 0; i < _size && success; i++)
+			success = receiveString(_sockets[0], gathered[i]);
+	}
+
+	if (!success)
+	{
+		gathered.clear();
+		close();
+	}
+	return success;
+}
+
+bool launchWorkers(int numWorkers, const std::function<bool(Allreduce&)>& worker)
+{
+	//the socket of rank 0 listens before any worker starts, on a free port of the local host.
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t addressSize = sizeof(address);
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0)
+		return false;
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, numWorkers) != 0 ||
+		getsockname(listener, (sockaddr*)&address, &addressSize) != 0)
+	{
+		::close(listener);
+		return false;
+	}
+	int port = ntohs(address.sin_port);
+
+	//flush the output of the caller, so that the workers do not repeat it.
+	fflush(nullptr);
+
+	std::vector<pid_t> workers;
+	for (int r = 0; r < numWorkers; r++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			if (r != 0)
+				::close(listener);
+
+			bool success;
+			{
+				Allreduce allreduce(r, numWorkers, listener, port);
+				success = allreduce.isOpen() && worker(allreduce) && allreduce.isOpen();
+			}
+			fflush(nullptr);
+			_exit(success ? 0 : 1);
+		}
+		workers.push_back(pid);
+	}
+	::close(listener);
+
+	//rank 0 waits for every worker, stop the started workers if a worker could not be started.
+	bool success = workers.size() == numWorkers;
+	if (!success)
+	{
+		for (int i = 0; i < workers.size(); i++)
+			kill(workers[i], SIGKILL);
+	}
+	for (int i = 0; i < workers.size(); i++)
+	{
+		int status;
+		if (waitpid(workers[i], &status, 0) != workers[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			success = false;
+	}
+	return success;
+}
+
+#endif
+
+bool Allreduce::isOpen()
+{
+	return _open;
+}
+
+int Allreduce::rank()
+{
+	return _rank;
+}
+
+int Allreduce::size()
+{
+	return _size;
+}
\ No newline at end of file
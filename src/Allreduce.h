@@ -0,0 +1,96 @@
+/*
+Allreduce.h
+Combination of the partial results of worker processes, each training on its own shard of a training
+set, e.g. the split histograms of OutOfCoreTree, the statistics of NaiveBayesStatistics or the loss
+and gradient of LogisticLoss. Every worker passes its partial result and receives the combined
+result of every worker, so every worker takes the same training decisions and ends with the same model.
+
+The workers are connected by TCP sockets to the worker of rank 0, which combines the partial results
+in rank order and sends the result back. The results are therefore identical on every worker, and do
+not depend on the order in which the workers arrive. The workers run on a single host, started by
+launchWorkers, or on several hosts, each constructing an Allreduce with the address of rank 0.
+
+Requires POSIX sockets. On other platforms an Allreduce is never open and launchWorkers fails.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+//seconds a worker retries to connect to the worker of rank 0, and the worker of rank 0 waits for the others.
+#define ALLREDUCE_CONNECT_TIMEOUT 30
+
+class Allreduce
+{
+public:
+	/*
+	Connects the worker 'rank' of 'size' workers. The worker of rank 0 listens on 'port' of the IPv4
+	address 'host', the other workers connect to 'host', which may be a host name. Blocks until every
+	worker is connected, at most ALLREDUCE_CONNECT_TIMEOUT seconds.
+	*/
+	Allreduce(int rank, int size, const std::string& host, int port);
+	~Allreduce();
+
+	/*
+	Returns true if every worker is connected, and no operation failed.
+	*/
+	bool isOpen();
+
+	int rank();
+	int size();
+
+	/*
+	Replaces 'values' by the sums of the values of every worker, added in rank order. Every worker must
+	pass the same count. Returns false, and leaves the values unchanged, if a worker failed.
+	*/
+	bool sum(double* values, size_t count);
+
+	/*
+	Gathers the data of every worker, in rank order, on every worker.
+	*/
+	bool allgather(const std::string& data, std::vector<std::string>& gathered);
+
+private:
+	friend bool launchWorkers(int numWorkers, const std::function<bool(Allreduce&)>& worker);
+
+	/*
+	Connects the worker 'rank' of the workers started by launchWorkers. The worker of rank 0 accepts
+	the other workers on the socket 'listener', the others connect to 'port' of the local host.
+	*/
+	Allreduce(int rank, int size, int listener, int port);
+
+	Allreduce(const Allreduce&);
+	Allreduce& operator=(const Allreduce&);
+
+	/*
+	Accepts the connections of the other workers on 'listener', the socket of rank 0.
+	*/
+	bool accept(int listener);
+
+	/*
+	Connects to rank 0, and sends the rank of the worker.
+	*/
+	bool connect(const std::string& host, int port);
+
+	/*
+	Closes the connections, every later operation fails.
+	*/
+	void close();
+
+	int _rank;
+	int _size;
+	bool _open;
+	std::vector<int> _sockets;	//rank 0: the socket of every worker, at its rank. Else: the socket of rank 0.
+	std::vector<double> _buffer;
+};
+
+/*
+Runs 'numWorkers' workers in child processes of the calling process, each with the Allreduce of its
+rank, for training on a single host. The function should train on the shard of the rank. The child
+processes exit when the function returns, they share nothing with the caller but the state at the
+time of the call, so the workers report their results through files, e.g. the model of rank 0.
+Returns true if every worker returned true.
+*/
+bool launchWorkers(int numWorkers, const std::function<bool(Allreduce&)>& worker);
\ No newline at end of file
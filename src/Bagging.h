@@ -0,0 +1,378 @@
+/*
+Bagging.h
+Bootstrap aggregating. Every weak learner is trained on a bootstrap sample of the training set, drawn
+with replacement, and the ensemble label is the mean label of the weak learners. With DecisionTree weak
+learners sampling the attributes of each split, the ensemble is a random forest.
+
+The weak learners are independent, and are trained concurrently on a thread pool. A bootstrap sample
+is not copied: the learner is trained on the distinct drawn samples, weighted by the number of times
+they are drawn. The samples not drawn for a learner, out of bag, estimate the generalization error of
+the ensemble without a separate validation pass.
+*/
+
+#pragma once
+#include <vector>
+#include <random>
+#include <mutex>
+#include <algorithm>
+#include <Sample.h>
+#include <WeakLearner.h>
+#include <ThreadPool.h>
+
+template <class T>
+class Bagging
+{
+public:
+	/*
+	Creates an empty model, to be loaded with importParams.
+	*/
+	Bagging()
+	{
+		_numWeakLearners = 0;
+		_n = 0;
+		_k = 0;
+		_outOfBagError = 0.0f;
+	}
+
+	/*
+	Constructor:
+	std::vector<Sample*>& samples: training set. Training supports multiple classes, where the label
+		can be any non-negative integer. Every class has its own one against many ensemble.
+	int numWeakLearners: number of bootstrap samples, and of weak learners of each class.
+	int numThreads: number of training threads, 0 for every hardware thread.
+	*/
+	Bagging(std::vector<Sample*>& samples, int numWeakLearners, int numThreads = 0)
+	{
+		T prototype;
+		train(samples, numWeakLearners, prototype, nullptr, numThreads);
+	}
+
+	/*
+	Constructor:
+	T& prototype: untrained weak learner holding the training configuration, e.g. a DecisionTree
+		with attribute sampling. Every weak learner of the model is created from the prototype.
+	float* sampleWeights: if not nullptr, the bootstrap samples are drawn with probabilities
+		proportional to the sample weights.
+	*/
+	Bagging(std::vector<Sample*>& samples, int numWeakLearners, T& prototype, float* sampleWeights = nullptr, int numThreads = 0)
+	{
+		train(samples, numWeakLearners, prototype, sampleWeights, numThreads);
+	}
+
+	virtual ~Bagging()
+	{
+		clear();
+	}
+
+	/*
+	Computes the classification error of a data set.
+	*/
+	float error(std::vector<Sample*>& samples)
+	{
+		int numNegativeSamples = 0;
+		for (int i = 0; i < samples.size(); i++)
+		{
+			float confidence;
+			if (label(samples[i], confidence) != samples[i]->y())
+				numNegativeSamples++;
+		}
+		return (float)numNegativeSamples / (float)samples.size();
+	}
+
+	/*
+	Returns the classification error of the training samples, each labeled by the weak learners which
+	were not trained on it. Samples drawn for every weak learner are not counted. The estimate is
+	computed by training, and is 0 for an imported model.
+	*/
+	float outOfBagError()
+	{
+		return _outOfBagError;
+	}
+
+	/*
+	Returns the most likely label for a sample given the learned parameters.
+	Sample* x: input sample.
+	float& confidence: likelihood of the label is stored here.
+	*/
+	int label(Sample* x, float& confidence)
+	{
+		float expSum = 0.0f;
+		int maxClassIndex = 0;
+		float maxLabel = classLabel(x, 0);
+		expSum += exp(maxLabel);
+		for (int i = 1; i < _k; i++)
+		{
+			float l = classLabel(x, i);
+			expSum += exp(l);
+			if (l > maxLabel)
+			{
+				maxLabel = l;
+				maxClassIndex = i;
+			}
+		}
+
+		confidence = exp(maxLabel) / expSum;
+		return maxClassIndex;
+	}
+
+	/*
+	Returns the number of weak learners of each class.
+	*/
+	int numWeakLearners()
+	{
+		return _numWeakLearners;
+	}
+
+	std::string exportParams()
+	{
+		std::string params;
+		params += std::to_string(_numWeakLearners) + ENSEMBLE_DELIM;
+		params += std::to_string(_n) + ENSEMBLE_DELIM;
+		params += std::to_string(_k) + ENSEMBLE_DELIM;
+
+		for (int k = 0; k < _k; k++)
+		{
+			for (int w = 0; w < _numWeakLearners; w++)
+				params += _ensembles[k][w]->exportParams() + ENSEMBLE_DELIM;
+		}
+		return params;
+	}
+
+	/*
+	Loads a model in the text format of exportParams. The model is removed from 'params'.
+	*/
+	void importParams(std::string& params)
+	{
+		ParamReader reader(params);
+		importParams(reader);
+		params.erase(0, reader.position());
+	}
+
+	void importParams(ParamReader& params)
+	{
+		int numWeakLearners = params.nextInt(ENSEMBLE_DELIM);
+		int n = params.nextInt(ENSEMBLE_DELIM);
+		int k = params.nextInt(ENSEMBLE_DELIM);
+
+		clear();
+		_numWeakLearners = numWeakLearners;
+		_n = n;
+		_k = k;
+		_outOfBagError = 0.0f;
+
+		_ensembles.resize(_k);
+		for (int k = 0; k < _k; k++)
+		{
+			for (int w = 0; w < _numWeakLearners; w++)
+			{
+				ParamReader weakLearnerParams = params.nextReader(ENSEMBLE_DELIM);
+
+				WeakLearner* weakLearner = new T();
+				weakLearner->importParams(weakLearnerParams);
+				_ensembles[k].push_back(weakLearner);
+			}
+		}
+	}
+
+private:
+
+	/*
+	Trains the weak learners, one task per bootstrap sample. The weak learners are created, and their
+	seeds and the seeds of the tasks drawn with rand, on the calling thread before the training starts,
+	so the model does not depend on the number of threads or on their scheduling, as long as the weak
+	learner only uses the seed of setRandomSeed.
+	*/
+	void train(std::vector<Sample*>& samples, int numWeakLearners, T& prototype, float* sampleWeights, int numThreads)
+	{
+		_numWeakLearners = numWeakLearners;
+		_n = samples[0]->n();
+		_k = getNumClasses(samples);
+		_outOfBagError = 0.0f;
+
+		int numSamples = samples.size();
+		_ensembles.resize(_k);
+		for (int k = 0; k < _k; k++)
+			_ensembles[k].resize(numWeakLearners, nullptr);
+
+		unsigned int* seeds = new unsigned int[numWeakLearners];
+		for (int w = 0; w < numWeakLearners; w++)
+			seeds[w] = rand();
+
+		//the weak learners are created and seeded here, the tasks only train them.
+		for (int w = 0; w < numWeakLearners; w++)
+		{
+			for (int k = 0; k < _k; k++)
+			{
+				_ensembles[k][w] = prototype.create();
+				_ensembles[k][w]->setRandomSeed(rand());
+			}
+		}
+
+		//the cumulative sample weights of a weighted bootstrap.
+		std::vector<double> cumulativeWeights;
+		if (sampleWeights != nullptr)
+		{
+			cumulativeWeights.resize(numSamples);
+			double sum = 0.0;
+			for (int i = 0; i < numSamples; i++)
+			{
+				sum += sampleWeights[i];
+				cumulativeWeights[i] = sum;
+			}
+		}
+
+		//sum of the out of bag labels of every sample and class, and number of out of bag learners of every sample.
+		float* outOfBagLabels = new float[numSamples * _k];
+		int* outOfBagCounts = new int[numSamples];
+		for (int i = 0; i < numSamples * _k; i++)
+			outOfBagLabels[i] = 0.0f;
+		for (int i = 0; i < numSamples; i++)
+			outOfBagCounts[i] = 0;
+		std::mutex outOfBagMutex;
+
+		auto trainBootstrapSample = [&](int w)
+		{
+			std::mt19937 random(seeds[w]);
+
+			//draw the bootstrap sample as the number of draws of every sample.
+			int* draws = new int[numSamples];
+			for (int i = 0; i < numSamples; i++)
+				draws[i] = 0;
+
+			if (sampleWeights != nullptr)
+			{
+				std::uniform_real_distribution<double> uniform(0.0, cumulativeWeights[numSamples - 1]);
+				for (int i = 0; i < numSamples; i++)
+				{
+					int index = std::upper_bound(cumulativeWeights.begin(), cumulativeWeights.end(), uniform(random)) - cumulativeWeights.begin();
+					draws[std::min(index, numSamples - 1)]++;
+				}
+			}
+			else
+			{
+				std::uniform_int_distribution<int> uniform(0, numSamples - 1);
+				for (int i = 0; i < numSamples; i++)
+					draws[uniform(random)]++;
+			}
+
+			//the distinct drawn samples, weighted by their number of draws.
+			std::vector<Sample*> bootstrapSamples;
+			std::vector<float> bootstrapWeights;
+			for (int i = 0; i < numSamples; i++)
+			{
+				if (draws[i] > 0)
+				{
+					bootstrapSamples.push_back(samples[i]);
+					bootstrapWeights.push_back((float)draws[i] / (float)numSamples);
+				}
+			}
+
+			std::vector<float> labels;
+			for (int k = 0; k < _k; k++)
+			{
+				WeakLearner* weakLearner = _ensembles[k][w];
+				weakLearner->train(bootstrapSamples, bootstrapWeights.data(), k);
+				weakLearner->releaseWarmStart();
+
+				//label the out of bag samples.
+				for (int i = 0; i < numSamples; i++)
+				{
+					if (draws[i] == 0)
+						labels.push_back(weakLearner->label(samples[i]));
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(outOfBagMutex);
+				int numOutOfBag = labels.size() / _k;
+				for (int k = 0; k < _k; k++)
+				{
+					int j = 0;
+					for (int i = 0; i < numSamples; i++)
+					{
+						if (draws[i] == 0)
+							outOfBagLabels[i * _k + k] += labels[k * numOutOfBag + j++];
+					}
+				}
+				for (int i = 0; i < numSamples; i++)
+				{
+					if (draws[i] == 0)
+						outOfBagCounts[i]++;
+				}
+			}
+
+			delete[] draws;
+		};
+
+		ThreadPool threadPool(numThreads);
+		threadPool.parallelFor(numWeakLearners, trainBootstrapSample);
+
+		//the out of bag label of a sample is the class with the largest sum of out of bag labels.
+		int numOutOfBagSamples = 0;
+		int numOutOfBagErrors = 0;
+		for (int i = 0; i < numSamples; i++)
+		{
+			if (outOfBagCounts[i] == 0)
+				continue;
+
+			int maxClassIndex = 0;
+			for (int k = 1; k < _k; k++)
+			{
+				if (outOfBagLabels[i * _k + k] > outOfBagLabels[i * _k + maxClassIndex])
+					maxClassIndex = k;
+			}
+			numOutOfBagSamples++;
+			if (maxClassIndex != samples[i]->y())
+				numOutOfBagErrors++;
+		}
+		_outOfBagError = (float)numOutOfBagErrors / (float)std::max(numOutOfBagSamples, 1);
+
+		delete[] seeds;
+		delete[] outOfBagLabels;
+		delete[] outOfBagCounts;
+	}
+
+	/*
+	Returns the mean label of the weak learners of class 'classIndex'.
+	*/
+	float classLabel(Sample* x, int classIndex)
+	{
+		std::vector<WeakLearner*>& ensemble = _ensembles[classIndex];
+		float l = 0.0f;
+		for (int i = 0; i < ensemble.size(); i++)
+			l += ensemble[i]->label(x);
+		return l / (float)std::max((int)ensemble.size(), 1);
+	}
+
+	/*
+	Releases the weak learners.
+	*/
+	void clear()
+	{
+		for (int k = 0; k < _ensembles.size(); k++)
+		{
+			for (int w = 0; w < _ensembles[k].size(); w++)
+				delete _ensembles[k][w];
+		}
+		_ensembles.clear();
+		_k = 0;
+	}
+
+	/*
+	Get the total number of unique classes in a sample set.
+	*/
+	int getNumClasses(std::vector<Sample*>& samples)
+	{
+		int maxClassIndex = 0;
+		for (int i = 0; i < samples.size(); i++)
+			maxClassIndex = std::max(maxClassIndex, samples[i]->y());
+		return maxClassIndex + 1;
+	}
+
+	std::vector<std::vector<WeakLearner*>> _ensembles;	//weak learners of every class, the learners of a class at the same index share their bootstrap sample.
+
+	int _numWeakLearners;
+	int _n;
+	int _k;
+	float _outOfBagError;
+};
\ No newline at end of file
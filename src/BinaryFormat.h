@@ -0,0 +1,159 @@
+/*
+BinaryFormat.h
+Helpers of the binary model format. Values are stored in the native (little endian) layout,
+and arrays are aligned to BINARY_ALIGNMENT bytes, so that a model in memory, e.g. a memory
+mapped model file, is used for inference in place, without parsing or copying.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+//alignment in bytes of the arrays of a binary model.
+#define BINARY_ALIGNMENT 16
+
+/*
+Returns the 64 bit checksum of 'size' bytes: FNV-1a over 8 byte words, followed by the remaining bytes.
+*/
+inline uint64_t binaryChecksum(const char* data, size_t size)
+{
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ (unsigned char)data[i]) * prime;
+	return hash;
+}
+
+/*
+BinaryWriter. Appends values and aligned arrays to a buffer.
+*/
+class BinaryWriter
+{
+public:
+	BinaryWriter(std::vector<char>& buffer) : _buffer(buffer)
+	{
+	}
+
+	void write(const void* data, size_t size)
+	{
+		const char* bytes = (const char*)data;
+		_buffer.insert(_buffer.end(), bytes, bytes + size);
+	}
+
+	template <class T>
+	void write(const T& value)
+	{
+		write(&value, sizeof(T));
+	}
+
+	/*
+	Writes an array of 'count' values, starting at an aligned position.
+	*/
+	template <class T>
+	void writeArray(const T* values, int count)
+	{
+		align();
+		write(values, sizeof(T) * count);
+	}
+
+	/*
+	Pads the buffer with zeros to a multiple of 'alignment' bytes.
+	*/
+	void align(size_t alignment = BINARY_ALIGNMENT)
+	{
+		while (_buffer.size() % alignment != 0)
+			_buffer.push_back(0);
+	}
+
+	size_t position()
+	{
+		return _buffer.size();
+	}
+
+	std::vector<char>& buffer()
+	{
+		return _buffer;
+	}
+
+private:
+	std::vector<char>& _buffer;
+};
+
+/*
+BinaryReader. Reads values from binary model data, and returns arrays as pointers into the data.
+The data must start at an address aligned to BINARY_ALIGNMENT. Reading past the end of the data
+invalidates the reader.
+*/
+class BinaryReader
+{
+public:
+	BinaryReader(const char* data, size_t size)
+	{
+		_data = data;
+		_size = size;
+		_position = 0;
+		_valid = (data != nullptr);
+	}
+
+	template <class T>
+	bool read(T& value)
+	{
+		if (!_valid || _position + sizeof(T) > _size)
+		{
+			_valid = false;
+			return false;
+		}
+		memcpy(&value, _data + _position, sizeof(T));
+		_position += sizeof(T);
+		return true;
+	}
+
+	/*
+	Returns a pointer to an array of 'count' values at the next aligned position, nullptr if the
+	data is too short. The pointer references the data, it is not copied.
+	*/
+	template <class T>
+	T* readArray(int count)
+	{
+		align();
+		if (!_valid || count < 0 || _position + sizeof(T) * (size_t)count > _size)
+		{
+			_valid = false;
+			return nullptr;
+		}
+		T* values = (T*)(_data + _position);
+		_position += sizeof(T) * count;
+		return values;
+	}
+
+	void align(size_t alignment = BINARY_ALIGNMENT)
+	{
+		_position = (_position + alignment - 1) / alignment * alignment;
+	}
+
+	bool valid()
+	{
+		return _valid;
+	}
+
+	size_t position()
+	{
+		return _position;
+	}
+
+private:
+	const char* _data;
+	size_t _size;
+	size_t _position;
+	bool _valid;
+};
\ No newline at end of file
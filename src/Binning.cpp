@@ -0,0 +1,89 @@
+#include <Binning.h>
+#include <algorithm>
+#include <cmath>
+
+AttributeBins::AttributeBins()
+{
+}
+
+AttributeBins::AttributeBins(std::vector<Sample*>& samples, int numBins)
+{
+	if (samples.size() == 0)
+		return;
+
+	int n = samples[0]->n();
+	numBins = std::max(1, std::min(numBins, MAX_BINS));
+	resize(n);
+
+	for (int a = 0; a < n; a++)
+	{
+		float minValue = samples[0]->x(a);
+		float maxValue = minValue;
+		for (int i = 1; i < samples.size(); i++)
+		{
+			minValue = fmin(minValue, samples[i]->x(a));
+			maxValue = fmax(maxValue, samples[i]->x(a));
+		}
+
+		//the upper edge of bin b is the value at bin coordinate b + 1.
+		std::vector<float> edges;
+		double width = fmax(maxValue - minValue, 1e-6) / (double)numBins;
+		for (int b = 0; b < numBins - 1; b++)
+			edges.push_back((float)(minValue + width * (b + 1)));
+		setEdges(a, edges);
+	}
+}
+
+void AttributeBins::resize(int n)
+{
+	_edges.clear();
+	_edges.resize(n);
+}
+
+void AttributeBins::setEdges(int attribute, const std::vector<float>& edges)
+{
+	std::vector<float>& attributeEdges = _edges[attribute];
+	attributeEdges = edges;
+	attributeEdges.erase(std::unique(attributeEdges.begin(), attributeEdges.end()), attributeEdges.end());
+	if (attributeEdges.size() > MAX_BINS - 1)
+		attributeEdges.resize(MAX_BINS - 1);
+}
+
+int AttributeBins::bin(int attribute, float x)
+{
+	//the first edge which is not below x.
+	std::vector<float>& edges = _edges[attribute];
+	return std::lower_bound(edges.begin(), edges.end(), x) - edges.begin();
+}
+
+int AttributeBins::maxNumBins()
+{
+	int maxBins = 1;
+	for (int a = 0; a < n(); a++)
+		maxBins = std::max(maxBins, numBins(a));
+	return maxBins;
+}
+
+BinnedSamples::BinnedSamples(std::vector<Sample*>& samples, const AttributeBins& bins) : _samples(samples), _attributeBins(bins)
+{
+	_numSamples = samples.size();
+	_n = _attributeBins.n();
+	_bins = new uint8_t[(size_t)_n * _numSamples];
+
+	for (int a = 0; a < _n; a++)
+	{
+		uint8_t* attributeBins = &_bins[(size_t)a * _numSamples];
+		for (int i = 0; i < _numSamples; i++)
+			attributeBins[i] = _attributeBins.bin(a, samples[i]->x(a));
+	}
+}
+
+BinnedSamples::~BinnedSamples()
+{
+	delete[] _bins;
+}
+
+bool BinnedSamples::matches(std::vector<Sample*>& samples)
+{
+	return samples == _samples;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+Binning.h
+Discretization of the attribute values into bins, the basis of the histogram split search of the
+tree learners. DecisionTree bins the values of every node between the minimum and the maximum of
+the node, see binCoordinate. Learners which bin the training set once, e.g. GradientBoosting or
+DecisionTree with quantile bins, map the values to the bins of AttributeBins, and store the bin of
+every value in BinnedSamples. The bins
+of the quantiles of a training set are computed by the sketches of QuantileSketch.h.
+*/
+
+#pragma once
+#include <WeakLearner.h>
+#include <vector>
+#include <stdint.h>
+#include <cmath>
+
+//number of bins used to compute the attribute histograms.
+#define NUM_BINS 25
+
+//maximum number of bins of an attribute of AttributeBins, a bin index is stored in a byte.
+#define MAX_BINS 256
+
+/*
+Returns the position of x in 'numBins' bins of equal width between min and max, in [0, numBins]
+for a value in [min, max]. The integer part is the index of the bin.
+*/
+inline double binCoordinate(float x, float min, float max, int numBins = NUM_BINS)
+{
+	return (double)numBins * (x - min) / fmax(max - min, 1e-6);
+}
+
+/*
+AttributeBins. Bin edges of every attribute of a training set. A value x of an attribute is in bin b
+if edge(b - 1) < x <= edge(b), the last bin has no upper edge. A split x > edge(b) therefore separates
+the bins up to b from the bins after b exactly, for the training values and for any other value.
+The bins of a training set are shared by the learners trained on it as a TrainingCache.
+*/
+class AttributeBins : public TrainingCache
+{
+public:
+	AttributeBins();
+
+	/*
+	Bins of equal width between the minimum and the maximum of every attribute of 'samples', with the
+	bin coordinates of DecisionTree. numBins is at most MAX_BINS.
+	*/
+	AttributeBins(std::vector<Sample*>& samples, int numBins = NUM_BINS);
+
+	/*
+	Sets the number of attributes, every attribute has a single bin.
+	*/
+	void resize(int n);
+
+	/*
+	Sets the upper edges of the bins of an attribute, in increasing order. Duplicate edges are removed,
+	and at most MAX_BINS - 1 edges are kept.
+	*/
+	void setEdges(int attribute, const std::vector<float>& edges);
+
+	/*
+	Returns the bin of the value x of an attribute.
+	*/
+	int bin(int attribute, float x);
+
+	/*
+	Returns the upper edge of a bin of an attribute, which is not the last bin.
+	*/
+	float edge(int attribute, int bin)
+	{
+		return _edges[attribute][bin];
+	}
+
+	int numBins(int attribute)
+	{
+		return _edges[attribute].size() + 1;
+	}
+
+	/*
+	Returns the largest number of bins of an attribute.
+	*/
+	int maxNumBins();
+
+	int n()
+	{
+		return _edges.size();
+	}
+
+private:
+	std::vector<std::vector<float>> _edges;	//upper edges of the bins of every attribute.
+};
+
+/*
+BinnedSamples. The bin of every attribute value of a training set, stored attribute by attribute so
+that the histogram of an attribute reads a contiguous array of bytes. The bins do not depend on the
+class or on the sample weights, so a single instance is shared as a TrainingCache.
+*/
+class BinnedSamples : public TrainingCache
+{
+public:
+	BinnedSamples(std::vector<Sample*>& samples, const AttributeBins& bins);
+	virtual ~BinnedSamples();
+
+	/*
+	Returns true if the samples were binned from the training set 'samples'.
+	*/
+	bool matches(std::vector<Sample*>& samples);
+
+	/*
+	Returns the bins of every sample for an attribute.
+	*/
+	const uint8_t* attribute(int attribute)
+	{
+		return &_bins[(size_t)attribute * _numSamples];
+	}
+
+	AttributeBins& bins()
+	{
+		return _attributeBins;
+	}
+
+	int numSamples()
+	{
+		return _numSamples;
+	}
+
+	int n()
+	{
+		return _n;
+	}
+
+private:
+	std::vector<Sample*> _samples;
+	uint8_t* _bins;
+	int _numSamples;
+	int _n;
+	AttributeBins _attributeBins;
+};
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include <DecisionTree.h>
+#include <SortedAttributes.h>
+#include <QuantileSketch.h>
+#include <algorithm>
+#include <queue>
 
 DecisionTree::DecisionTree()
 {
@@ -7,15 +11,49 @@ DecisionTree::DecisionTree()
 	_nodeLabel = 0.0f;
 	_childNode[0] = nullptr;
 	_childNode[1] = nullptr;
+	_numSampledAttributes = 0;
+	_seed = 0;
+	_exactSplits = false;
+	_jointTraining = false;
+	_numQuantileBins = 0;
+	_attributeBins = nullptr;
+	_nodes = nullptr;
+	_numNodes = 0;
+	_compactNodes = nullptr;
+	_thresholds = nullptr;
+	_leafLabels = nullptr;
+	_numThresholds = 0;
+	_numLeafLabels = 0;
 }
 DecisionTree::~DecisionTree()
 {
-	delete _childNode[0];
-	delete _childNode[1];
+	clear();
 }
 
 float DecisionTree::label(Sample* x)
 {
+	if (_compactNodes != nullptr)
+	{
+		int index = 0;
+		while (_compactNodes[index].child >= 0)
+		{
+			const CompactTreeNode& node = _compactNodes[index];
+			index = node.child + (x->x(node.attribute) > _thresholds[node.value] ? 1 : 0);
+		}
+		return _leafLabels[_compactNodes[index].value];
+	}
+
+	if (_nodes != nullptr)
+	{
+		int index = 0;
+		while (_nodes[index].child >= 0)
+		{
+			const DecisionTreeNode& node = _nodes[index];
+			index = node.child + (x->x(node.attribute) > node.threshold ? 1 : 0);
+		}
+		return _nodes[index].label;
+	}
+
 	if (_childNode[0] == nullptr && _childNode[1] == nullptr)
 		return _nodeLabel;
 
@@ -25,113 +63,702 @@ float DecisionTree::label(Sample* x)
 		return _childNode[0]->label(x);
 }
 
+/*
+Leaf of a tree grown leaf wise, with the samples of the leaf and the seeds of its children.
+*/
+struct PendingSplit
+{
+	DecisionTree* node;
+	std::vector<Sample*> samples;
+	std::vector<float> sampleWeights;
+	std::vector<int> indices;
+	int depth;
+	unsigned int childSeeds[2];
+};
+
 void DecisionTree::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
 {
+	clear();
 	if (samples.size() == 0)
 		return;
 
-	//if all the samples are part of the sample class, the node is a leaf.
-	if (isSameClass(samples, classIndex, _nodeLabel))	
+	if (_exactSplits)
+	{
+		trainExact(samples, sampleWeights, classIndex);
 		return;
+	}
+
+	//the binned training set of the histograms: shared by the learners of the training set, or binned
+	//for these samples with the bins set, or the quantile bins of the samples.
+	BinnedSamples* binnedSamples = nullptr;
+	BinnedSamples* localBinnedSamples = nullptr;
+	if (_attributeBins != nullptr || _numQuantileBins > 0)
+	{
+		binnedSamples = dynamic_cast<BinnedSamples*>(_trainingCache);
+		if (binnedSamples == nullptr || !binnedSamples->matches(samples))
+		{
+			if (_attributeBins != nullptr)
+				localBinnedSamples = new BinnedSamples(samples, *_attributeBins);
+			else
+				localBinnedSamples = new BinnedSamples(samples, AttributeSketches(samples).bins(_numQuantileBins));
+			binnedSamples = localBinnedSamples;
+		}
+	}
+
+	if (_limits.leafWise)
+		trainLeafWise(samples, sampleWeights, classIndex, binnedSamples);
+	else
+	{
+		std::vector<int> indices;
+		if (binnedSamples != nullptr)
+		{
+			indices.resize(samples.size());
+			for (int i = 0; i < samples.size(); i++)
+				indices[i] = i;
+		}
+
+		int numLeaves = 1;
+		trainNode(samples, sampleWeights, indices, classIndex, binnedSamples, 0, numLeaves);
+	}
+	delete localBinnedSamples;
+}
+
+void DecisionTree::trainNode(std::vector<Sample*>& samples, float* sampleWeights, std::vector<int>& indices, int classIndex, BinnedSamples* binnedSamples, int depth, int& numLeaves)
+{
+	std::minstd_rand random(_seed);
+	float gain;
+	if (_limits.maxLeaves > 0 && numLeaves >= _limits.maxLeaves)
+	{
+		isSameClass(samples, sampleWeights, classIndex, _nodeLabel);
+		return;
+	}
+	if (!findSplit(samples, sampleWeights, indices.data(), classIndex, binnedSamples, depth, random, gain))
+		return;
+
+	std::vector<Sample*> childSamples[2];
+	std::vector<float> childSampleWeights[2];
+	std::vector<int> childIndices[2];
+	splitSamples(samples, sampleWeights, indices, childSamples, childSampleWeights, childIndices);
+	numLeaves++;
+
+	//create the leaf nodes.
+	_childNode[0] = createChild(random());
+	_childNode[0]->trainNode(childSamples[0], childSampleWeights[0].data(), childIndices[0], classIndex, binnedSamples, depth + 1, numLeaves);
+
+	_childNode[1] = createChild(random());
+	_childNode[1]->trainNode(childSamples[1], childSampleWeights[1].data(), childIndices[1], classIndex, binnedSamples, depth + 1, numLeaves);
+}
+
+void DecisionTree::trainLeafWise(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, BinnedSamples* binnedSamples)
+{
+	//the leaves which can be split, ordered by their information gain times their sample weight.
+	std::vector<PendingSplit> pendingSplits;
+	std::priority_queue<std::pair<double, int>> queue;
+
+	auto addLeaf = [&](DecisionTree* node, std::vector<Sample*>& nodeSamples, std::vector<float>& nodeSampleWeights, std::vector<int>& nodeIndices, int depth)
+	{
+		std::minstd_rand random(node->_seed);
+		float gain;
+		if (!node->findSplit(nodeSamples, nodeSampleWeights.data(), nodeIndices.data(), classIndex, binnedSamples, depth, random, gain))
+			return;
+
+		double weightSum = 0.0;
+		for (int i = 0; i < nodeSampleWeights.size(); i++)
+			weightSum += nodeSampleWeights[i];
+
+		PendingSplit pendingSplit;
+		pendingSplit.node = node;
+		pendingSplit.samples.swap(nodeSamples);
+		pendingSplit.sampleWeights.swap(nodeSampleWeights);
+		pendingSplit.indices.swap(nodeIndices);
+		pendingSplit.depth = depth;
+		pendingSplit.childSeeds[0] = random();
+		pendingSplit.childSeeds[1] = random();
+		pendingSplits.push_back(std::move(pendingSplit));
+		queue.push(std::make_pair(gain * weightSum, (int)pendingSplits.size() - 1));
+	};
+
+	std::vector<Sample*> rootSamples = samples;
+	std::vector<float> rootSampleWeights(sampleWeights, sampleWeights + samples.size());
+	std::vector<int> rootIndices;
+	if (binnedSamples != nullptr)
+	{
+		rootIndices.resize(samples.size());
+		for (int i = 0; i < samples.size(); i++)
+			rootIndices[i] = i;
+	}
+	addLeaf(this, rootSamples, rootSampleWeights, rootIndices, 0);
+
+	int numLeaves = 1;
+	while (!queue.empty() && (_limits.maxLeaves <= 0 || numLeaves < _limits.maxLeaves))
+	{
+		PendingSplit pendingSplit = std::move(pendingSplits[queue.top().second]);
+		queue.pop();
+
+		DecisionTree* node = pendingSplit.node;
+		std::vector<Sample*> childSamples[2];
+		std::vector<float> childSampleWeights[2];
+		std::vector<int> childIndices[2];
+		node->splitSamples(pendingSplit.samples, pendingSplit.sampleWeights.data(), pendingSplit.indices, childSamples, childSampleWeights, childIndices);
+		numLeaves++;
+
+		for (int i = 0; i < 2; i++)
+		{
+			node->_childNode[i] = node->createChild(pendingSplit.childSeeds[i]);
+			addLeaf(node->_childNode[i], childSamples[i], childSampleWeights[i], childIndices[i], pendingSplit.depth + 1);
+		}
+	}
+}
 
+/*
+Entropy of a two class distribution with a positive fraction p.
+*/
+static double binaryEntropy(double p)
+{
+	if (p <= 0.0 || p >= 1.0)
+		return 0.0;
+	return -p * log2(p) - (1.0 - p) * log2(1.0 - p);
+}
+
+bool DecisionTree::findSplit(std::vector<Sample*>& samples, float* sampleWeights, const int* indices, int classIndex, BinnedSamples* binnedSamples, int depth, std::minstd_rand& random, float& gain)
+{
+	//if all the samples are part of the sample class, the node is a leaf.
+	if (isSameClass(samples, sampleWeights, classIndex, _nodeLabel))
+		return false;
+
+	if (_limits.maxDepth > 0 && depth >= _limits.maxDepth)
+		return false;
+	if (samples.size() < 2 * _limits.minSamplesLeaf)
+		return false;
 
 	int numAttributes = samples[0]->n();
-	
 
-	//compute the information gain of each attribute, get the maximum.
-	float maxInformationGain = informationGain(samples, sampleWeights, classIndex, 0);
-	int maxAttributeIndex = 0;
-	for (int i = 1; i < numAttributes; i++)
+	//the candidate attributes of the split, a random subset if the attributes are sampled.
+	std::vector<int> attributes(numAttributes);
+	for (int i = 0; i < numAttributes; i++)
+		attributes[i] = i;
+
+	int numCandidates = numAttributes;
+	if (_numSampledAttributes > 0 && _numSampledAttributes < numAttributes)
 	{
-		float ig = informationGain(samples, sampleWeights, classIndex, i);
-		if (ig > maxInformationGain)
+		numCandidates = _numSampledAttributes;
+		for (int i = 0; i < numCandidates; i++)
+			std::swap(attributes[i], attributes[i + random() % (numAttributes - i)]);
+	}
+
+	float maxInformationGain;
+	if (binnedSamples != nullptr)
+	{
+		//split at the best bin edge of the candidate attributes.
+		if (!findBinSplit(samples, sampleWeights, indices, classIndex, binnedSamples, attributes.data(), numCandidates, maxInformationGain))
+			return false;
+	}
+	else
+	{
+		//compute the information gain of each candidate attribute, get the maximum.
+		maxInformationGain = informationGain(samples, sampleWeights, classIndex, attributes[0]);
+		int maxAttributeIndex = attributes[0];
+		for (int i = 1; i < numCandidates; i++)
 		{
-			maxInformationGain = ig;
-			maxAttributeIndex = i;
+			float ig = informationGain(samples, sampleWeights, classIndex, attributes[i]);
+			if (ig > maxInformationGain)
+			{
+				maxInformationGain = ig;
+				maxAttributeIndex = attributes[i];
+			}
 		}
+
+		//the attribute with the maximum information gain is the split attribute.
+		_splitAttributeIndex = maxAttributeIndex;
+		//compute the split threshold.
+		_splitThresh = threshold(samples, sampleWeights, classIndex, _splitAttributeIndex);
 	}
 
-	//the attribute with the maximum information gain is the split attribute.
-	_splitAttributeIndex = maxAttributeIndex;
-	//compute the split threshold.
-	_splitThresh = threshold(samples, sampleWeights, classIndex, _splitAttributeIndex);
+	if (maxInformationGain < _limits.minInformationGain)
+		return false;
 
-	//get the number of positive samples and negative samples given the split.
+	//get the number and the weight of the positive samples and negative samples given the split.
 	int numPositiveSamples = 0;
 	int numNegativeSamples = 0;
+	double positiveWeight = 0.0;
+	double negativeWeight = 0.0;
 	for (int i = 0; i < samples.size(); i++)
 	{
 		if (samples[i]->x(_splitAttributeIndex) > _splitThresh)
+		{
 			numPositiveSamples++;
+			positiveWeight += sampleWeights[i];
+		}
 		else
+		{
 			numNegativeSamples++;
+			negativeWeight += sampleWeights[i];
+		}
 	}
 
 	//if there is no split, the node is a leaf.
 	if (numPositiveSamples == 0 || numNegativeSamples == 0)
-		return;
+		return false;
+	if (numPositiveSamples < _limits.minSamplesLeaf || numNegativeSamples < _limits.minSamplesLeaf)
+		return false;
+	if (positiveWeight < _limits.minWeightLeaf || negativeWeight < _limits.minWeightLeaf)
+		return false;
 
-	std::vector<Sample*> positiveSamples;
-	std::vector<Sample*> negativeSamples;
+	gain = maxInformationGain;
+	return true;
+}
 
-	float* positiveSampleWeights = nullptr;
-	float* negativeSampleWeights = nullptr;
+bool DecisionTree::findBinSplit(std::vector<Sample*>& samples, float* sampleWeights, const int* indices, int classIndex, BinnedSamples* binnedSamples, const int* attributes, int numAttributes, float& gain)
+{
+	int numSamples = samples.size();
+	AttributeBins& bins = binnedSamples->bins();
 
-	if (numPositiveSamples > 0)
-		positiveSampleWeights = new float[numPositiveSamples];
-	if (numNegativeSamples > 0)
-		negativeSampleWeights = new float[numNegativeSamples];
+	//the class of every sample is read once, not once per attribute.
+	std::vector<uint8_t> positive(numSamples);
+	double positiveWeight = 0.0;
+	double weightSum = 0.0;
+	for (int i = 0; i < numSamples; i++)
+	{
+		positive[i] = (samples[i]->y() == classIndex) ? 1 : 0;
+		if (positive[i])
+			positiveWeight += sampleWeights[i];
+		weightSum += sampleWeights[i];
+	}
+	if (weightSum <= 0.0)
+		return false;
+
+	int minSamplesLeaf = std::max(_limits.minSamplesLeaf, 1);
+	double positiveHistogram[MAX_BINS];
+	double negativeHistogram[MAX_BINS];
+	int countHistogram[MAX_BINS];
+
+	double minChildEntropy = DBL_MAX;
+	for (int c = 0; c < numAttributes; c++)
+	{
+		int a = attributes[c];
+		int numBins = bins.numBins(a);
+		for (int b = 0; b < numBins; b++)
+		{
+			positiveHistogram[b] = 0.0;
+			negativeHistogram[b] = 0.0;
+			countHistogram[b] = 0;
+		}
+
+		const uint8_t* sampleBins = binnedSamples->attribute(a);
+		for (int i = 0; i < numSamples; i++)
+		{
+			int b = sampleBins[indices[i]];
+			if (positive[i])
+				positiveHistogram[b] += sampleWeights[i];
+			else
+				negativeHistogram[b] += sampleWeights[i];
+			countHistogram[b]++;
+		}
+
+		//sweep the bin edges, the samples of the bins up to an edge go to child 0.
+		double leftPositiveWeight = 0.0;
+		double leftWeight = 0.0;
+		int leftCount = 0;
+		for (int b = 0; b < numBins - 1; b++)
+		{
+			leftPositiveWeight += positiveHistogram[b];
+			leftWeight += positiveHistogram[b] + negativeHistogram[b];
+			leftCount += countHistogram[b];
 
+			if (leftCount < minSamplesLeaf || numSamples - leftCount < minSamplesLeaf)
+				continue;
+
+			double rightWeight = weightSum - leftWeight;
+			if (leftWeight < _limits.minWeightLeaf || rightWeight < _limits.minWeightLeaf)
+				continue;
+
+			double childEntropy = 0.0;
+			if (leftWeight > 0.0)
+				childEntropy += leftWeight * binaryEntropy(leftPositiveWeight / leftWeight);
+			if (rightWeight > 0.0)
+				childEntropy += rightWeight * binaryEntropy((positiveWeight - leftPositiveWeight) / rightWeight);
+
+			if (childEntropy < minChildEntropy)
+			{
+				minChildEntropy = childEntropy;
+				_splitAttributeIndex = a;
+				_splitThresh = bins.edge(a, b);
+			}
+		}
+	}
+
+	if (minChildEntropy == DBL_MAX)
+		return false;
+
+	gain = (float)(binaryEntropy(positiveWeight / weightSum) - minChildEntropy / weightSum);
+	return true;
+}
+
+void DecisionTree::splitSamples(std::vector<Sample*>& samples, float* sampleWeights, std::vector<int>& indices, std::vector<Sample*> childSamples[2], std::vector<float> childSampleWeights[2], std::vector<int> childIndices[2])
+{
 	//iterate through the samples, compute the split samples and the corresponding
 	//sample weights.
 	for (int i = 0; i < samples.size(); i++)
 	{
-		if (samples[i]->x(_splitAttributeIndex) > _splitThresh)
+		int child = (samples[i]->x(_splitAttributeIndex) > _splitThresh) ? 1 : 0;
+		childSamples[child].push_back(samples[i]);
+		childSampleWeights[child].push_back(sampleWeights[i]);
+		if (indices.size() > 0)
+			childIndices[child].push_back(indices[i]);
+	}
+}
+
+/*
+Working state of the exact split search. The node of a tree is a range [begin, end) of the sorted lists
+of every attribute, holding the same samples in the value order of each attribute.
+*/
+struct ExactSplitState
+{
+	int numSamples;
+	int n;
+	std::vector<int32_t> indices;	//sample indices of every attribute, sorted within every node, n x numSamples.
+	std::vector<float> values;	//attribute values, in the order of indices.
+	std::vector<uint8_t> positive;	//1 if the sample is of the trained class.
+	std::vector<uint8_t> right;	//1 if the sample goes to child 1 of the split being applied.
+	std::vector<int32_t> indexBuffer;
+	std::vector<float> valueBuffer;
+	float* sampleWeights;
+	int splitAttribute;	//split attribute of the last call of findExactSplit.
+};
+
+/*
+Node of a tree grown with the exact split search, whose split has been found.
+*/
+struct PendingRange
+{
+	DecisionTree* node;
+	int begin;
+	int end;
+	int depth;
+	int numLeft;
+	int splitAttribute;
+	unsigned int childSeeds[2];
+};
+
+/*
+Splits the range [begin, end) of every sorted list into the samples of child 0, followed by the samples
+of child 1, keeping the value order of each child.
+*/
+static void partitionRange(ExactSplitState& state, int begin, int end, int attribute, int numLeft)
+{
+	size_t offset = (size_t)attribute * state.numSamples;
+	for (int j = begin; j < end; j++)
+		state.right[state.indices[offset + j]] = (j - begin >= numLeft) ? 1 : 0;
+
+	for (int a = 0; a < state.n; a++)
+	{
+		if (a == attribute)
+			continue;
+
+		int32_t* indices = &state.indices[(size_t)a * state.numSamples];
+		float* values = &state.values[(size_t)a * state.numSamples];
+		int left = begin;
+		int numRight = 0;
+		for (int j = begin; j < end; j++)
 		{
-			positiveSampleWeights[positiveSamples.size()] = sampleWeights[i];
-			positiveSamples.push_back(samples[i]);
+			if (state.right[indices[j]])
+			{
+				state.indexBuffer[numRight] = indices[j];
+				state.valueBuffer[numRight++] = values[j];
+			}
+			else
+			{
+				indices[left] = indices[j];
+				values[left++] = values[j];
+			}
 		}
-		else
+		std::copy(state.indexBuffer.begin(), state.indexBuffer.begin() + numRight, indices + left);
+		std::copy(state.valueBuffer.begin(), state.valueBuffer.begin() + numRight, values + left);
+	}
+}
+
+void DecisionTree::trainExact(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	//use the shared presorted attributes of the training set, or sort the samples of this tree.
+	SortedAttributes* sortedAttributes = dynamic_cast<SortedAttributes*>(_trainingCache);
+	SortedAttributes* localSortedAttributes = nullptr;
+	if (sortedAttributes == nullptr || !sortedAttributes->matches(samples))
+	{
+		localSortedAttributes = new SortedAttributes(samples);
+		sortedAttributes = localSortedAttributes;
+	}
+
+	ExactSplitState state;
+	state.numSamples = samples.size();
+	state.n = sortedAttributes->n();
+	state.indices.assign(sortedAttributes->indices(0), sortedAttributes->indices(0) + (size_t)state.n * state.numSamples);
+	state.values.assign(sortedAttributes->values(0), sortedAttributes->values(0) + (size_t)state.n * state.numSamples);
+	state.positive.resize(state.numSamples);
+	for (int i = 0; i < state.numSamples; i++)
+		state.positive[i] = (samples[i]->y() == classIndex) ? 1 : 0;
+	state.right.resize(state.numSamples);
+	state.indexBuffer.resize(state.numSamples);
+	state.valueBuffer.resize(state.numSamples);
+	state.sampleWeights = sampleWeights;
+	state.splitAttribute = 0;
+	delete localSortedAttributes;
+
+	//the nodes to split, by gain times weight when grown leaf wise, in depth first order else.
+	std::vector<PendingRange> pendingRanges;
+	std::priority_queue<std::pair<double, int>> queue;
+
+	auto addNode = [&](DecisionTree* node, int begin, int end, int depth)
+	{
+		std::minstd_rand random(node->_seed);
+		float gain;
+		int numLeft;
+		if (!node->findExactSplit(state, begin, end, depth, random, gain, numLeft))
+			return;
+
+		double weightSum = 0.0;
+		const int32_t* indices = &state.indices[0];
+		for (int j = begin; j < end; j++)
+			weightSum += sampleWeights[indices[j]];
+
+		PendingRange pendingRange = { node, begin, end, depth, numLeft, state.splitAttribute, { 0, 0 } };
+		pendingRange.childSeeds[0] = random();
+		pendingRange.childSeeds[1] = random();
+		pendingRanges.push_back(pendingRange);
+
+		double priority = _limits.leafWise ? gain * weightSum : (double)pendingRanges.size();
+		queue.push(std::make_pair(priority, (int)pendingRanges.size() - 1));
+	};
+
+	addNode(this, 0, state.numSamples, 0);
+
+	int numLeaves = 1;
+	while (!queue.empty() && (_limits.maxLeaves <= 0 || numLeaves < _limits.maxLeaves))
+	{
+		PendingRange pendingRange = pendingRanges[queue.top().second];
+		queue.pop();
+
+		int middle = pendingRange.begin + pendingRange.numLeft;
+		partitionRange(state, pendingRange.begin, pendingRange.end, pendingRange.splitAttribute, pendingRange.numLeft);
+		numLeaves++;
+
+		DecisionTree* node = pendingRange.node;
+		node->_childNode[0] = node->createChild(pendingRange.childSeeds[0]);
+		node->_childNode[1] = node->createChild(pendingRange.childSeeds[1]);
+
+		//child 0 is added last, so the depth first order visits it first.
+		addNode(node->_childNode[1], middle, pendingRange.end, pendingRange.depth + 1);
+		addNode(node->_childNode[0], pendingRange.begin, middle, pendingRange.depth + 1);
+	}
+}
+
+bool DecisionTree::findExactSplit(ExactSplitState& state, int begin, int end, int depth, std::minstd_rand& random, float& gain, int& numLeft)
+{
+	//the class counts and weights of the node, from the sorted list of any attribute.
+	const int32_t* nodeIndices = &state.indices[begin];
+	int numPositiveSamples = 0;
+	double positiveWeight = 0.0;
+	double weightSum = 0.0;
+	for (int j = 0; j < end - begin; j++)
+	{
+		float weight = state.sampleWeights[nodeIndices[j]];
+		weightSum += weight;
+		if (state.positive[nodeIndices[j]])
 		{
-			negativeSampleWeights[negativeSamples.size()] = sampleWeights[i];
-			negativeSamples.push_back(samples[i]);
+			numPositiveSamples++;
+			positiveWeight += weight;
 		}
 	}
 
-	//create the leaf nodes.
-	_childNode[0] = new DecisionTree();
-	_childNode[0]->train(negativeSamples, negativeSampleWeights, classIndex);
+	//the label is the class of the larger weight.
+	int numSamples = end - begin;
+	_nodeLabel = (positiveWeight > weightSum - positiveWeight) ? 1.0f : -1.0f;
+	if (numPositiveSamples == 0 || numPositiveSamples == numSamples)
+		return false;
+
+	if (_limits.maxDepth > 0 && depth >= _limits.maxDepth)
+		return false;
+	if (numSamples < 2 * _limits.minSamplesLeaf || weightSum <= 0.0)
+		return false;
+
+	//the candidate attributes of the split, a random subset if the attributes are sampled.
+	std::vector<int> attributes(state.n);
+	for (int i = 0; i < state.n; i++)
+		attributes[i] = i;
+
+	int numCandidates = state.n;
+	if (_numSampledAttributes > 0 && _numSampledAttributes < state.n)
+	{
+		numCandidates = _numSampledAttributes;
+		for (int i = 0; i < numCandidates; i++)
+			std::swap(attributes[i], attributes[i + random() % (state.n - i)]);
+	}
+
+	//sweep the sorted values of every candidate, the children entropy of a boundary between two
+	//distinct values follows from the prefix sums of the weights.
+	double minChildEntropy = DBL_MAX;
+	for (int c = 0; c < numCandidates; c++)
+	{
+		int a = attributes[c];
+		const int32_t* indices = &state.indices[(size_t)a * state.numSamples + begin];
+		const float* values = &state.values[(size_t)a * state.numSamples + begin];
+
+		double leftWeight = 0.0;
+		double leftPositiveWeight = 0.0;
+		for (int j = 0; j < numSamples - 1; j++)
+		{
+			float weight = state.sampleWeights[indices[j]];
+			leftWeight += weight;
+			if (state.positive[indices[j]])
+				leftPositiveWeight += weight;
+
+			if (!(values[j] < values[j + 1]))
+				continue;
+			if (j + 1 < _limits.minSamplesLeaf || numSamples - j - 1 < _limits.minSamplesLeaf)
+				continue;
+
+			double rightWeight = weightSum - leftWeight;
+			if (leftWeight < _limits.minWeightLeaf || rightWeight < _limits.minWeightLeaf)
+				continue;
+
+			double childEntropy = 0.0;
+			if (leftWeight > 0.0)
+				childEntropy += leftWeight * binaryEntropy(leftPositiveWeight / leftWeight);
+			if (rightWeight > 0.0)
+				childEntropy += rightWeight * binaryEntropy((positiveWeight - leftPositiveWeight) / rightWeight);
+
+			if (childEntropy < minChildEntropy)
+			{
+				minChildEntropy = childEntropy;
+				_splitAttributeIndex = a;
+				numLeft = j + 1;
+
+				//the midpoint of the two values, or the lower value if they are adjacent floats.
+				_splitThresh = values[j] * 0.5f + values[j + 1] * 0.5f;
+				if (!(_splitThresh >= values[j] && _splitThresh < values[j + 1]))
+					_splitThresh = values[j];
+			}
+		}
+	}
+
+	if (minChildEntropy == DBL_MAX)
+		return false;
+
+	gain = (float)(binaryEntropy(positiveWeight / weightSum) - minChildEntropy / weightSum);
+	if (gain < _limits.minInformationGain)
+		return false;
+
+	state.splitAttribute = _splitAttributeIndex;
+	return true;
+}
 
-	_childNode[1] = new DecisionTree();
-	_childNode[1]->train(positiveSamples, positiveSampleWeights, classIndex);
+WeakLearner* DecisionTree::create()
+{
+	DecisionTree* decisionTree = new DecisionTree();
+	decisionTree->setAttributeSampling(_numSampledAttributes);
+	decisionTree->setGrowthLimits(_limits);
+	decisionTree->setExactSplits(_exactSplits);
+	decisionTree->setJointTraining(_jointTraining);
+	decisionTree->setQuantileBins(_numQuantileBins);
+	decisionTree->setAttributeBins(_attributeBins);
+	return decisionTree;
+}
+
+void DecisionTree::setAttributeSampling(int numAttributes)
+{
+	_numSampledAttributes = numAttributes;
+}
 
-	delete[] negativeSampleWeights;
-	delete[] positiveSampleWeights;
+void DecisionTree::setRandomSeed(unsigned int seed)
+{
+	_seed = seed;
+}
+
+void DecisionTree::setGrowthLimits(const TreeGrowthLimits& limits)
+{
+	_limits = limits;
+}
+
+TreeGrowthLimits DecisionTree::growthLimits()
+{
+	return _limits;
+}
+
+void DecisionTree::setExactSplits(bool exactSplits)
+{
+	_exactSplits = exactSplits;
+}
+
+void DecisionTree::setQuantileBins(int numBins)
+{
+	_numQuantileBins = numBins;
+}
+
+void DecisionTree::setAttributeBins(AttributeBins* bins)
+{
+	_attributeBins = bins;
+}
+
+TrainingCache* DecisionTree::createTrainingCache(std::vector<Sample*>& samples)
+{
+	if (_exactSplits)
+		return new SortedAttributes(samples);
+	if (_attributeBins != nullptr)
+		return new BinnedSamples(samples, *_attributeBins);
+	if (_numQuantileBins > 0)
+		return new BinnedSamples(samples, AttributeSketches(samples).bins(_numQuantileBins));
+	return nullptr;
+}
+
+void DecisionTree::setNodes(const DecisionTreeNode* nodes, int numNodes)
+{
+	clear();
+	_nodes = new DecisionTreeNode[numNodes];
+	std::copy(nodes, nodes + numNodes, _nodes);
+	_numNodes = numNodes;
+	_nodeLabel = _nodes[0].label;
+}
+
+DecisionTree* DecisionTree::createChild(unsigned int seed)
+{
+	DecisionTree* child = new DecisionTree();
+	child->_numSampledAttributes = _numSampledAttributes;
+	child->_seed = seed;
+	child->_limits = _limits;
+	child->_exactSplits = _exactSplits;
+	child->_jointTraining = _jointTraining;
+	child->_numQuantileBins = _numQuantileBins;
+	child->_attributeBins = _attributeBins;
+	return child;
 }
 
 /*
 returns true if all samples in a training set are the same class.
 */
-bool DecisionTree::isSameClass(std::vector<Sample*>& samples, int classIndex, float& majorityClass)
+bool DecisionTree::isSameClass(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, float& majorityClass)
 {
 	if (samples.size() <= 0)
 		return true;
 
+	//the label of the node is the class of the larger weight, the leaves of a bounded tree are impure.
 	int positiveSamples = 0;
 	int negativeSamples = 0;
+	double positiveWeight = 0.0;
+	double negativeWeight = 0.0;
 	for (int i = 0; i < samples.size(); i++)
 	{
 		if (samples[i]->y() == classIndex)
 		{
 			positiveSamples++;
+			positiveWeight += sampleWeights[i];
 		}
 		else
 		{
 			negativeSamples++;
+			negativeWeight += sampleWeights[i];
 		}
 	}
 
-	if (positiveSamples > negativeSamples)
+	if (positiveWeight > negativeWeight)
 		majorityClass = 1.0f;
 	else
 		majorityClass = -1.0f;
@@ -142,6 +769,85 @@ bool DecisionTree::isSameClass(std::vector<Sample*>& samples, int classIndex, fl
 		return false;
 }
 
+/*
+Midpoint of the weighted means of the positive and of the negative samples, from the sums of
+the weighted attribute values and of the weights.
+*/
+static float meanThreshold(float positiveMean, float positiveSum, float negativeMean, float negativeSum)
+{
+	positiveMean /= fmax(positiveSum, 1e-9f);
+	negativeMean /= fmax(negativeSum, 1e-9f);
+
+	//set the threshold to the midpoint of the means.
+	return positiveMean * 0.5f + negativeMean * 0.5f;
+}
+
+/*
+Entropy of the labels, from the weight sums of the positive and of the negative samples.
+*/
+static float entropyFromSums(double positiveP, double negativeP, double weightSum)
+{
+	positiveP /= weightSum;
+	negativeP /= weightSum;
+
+	float entropy = -positiveP * log2(fmax(positiveP, 1e-12f)) - negativeP * log2(fmax(negativeP, 1e-12f));
+	return entropy;
+}
+
+/*
+Adds the weight of a sample to the two bins around its bin coordinate, in proportion to the distance
+of the coordinate to each bin.
+*/
+static inline void addToHistogram(double normalizedBinIndex, bool positive, float sampleWeight, double* positiveHistogram, double* negativeHistogram, double& weightSum)
+{
+	int binIndex = (int)floor(normalizedBinIndex);
+	int nextBinIndex = binIndex + 1;
+	double r = normalizedBinIndex - floor(normalizedBinIndex);
+
+	if (binIndex >= 0 && binIndex < NUM_BINS)
+	{
+		if (positive)
+			positiveHistogram[binIndex] += sampleWeight * (1.0 - r);
+		else
+			negativeHistogram[binIndex] += sampleWeight * (1.0 - r);
+
+		weightSum += sampleWeight * (1.0 - r);
+	}
+	if (nextBinIndex >= 0 && nextBinIndex < NUM_BINS)
+	{
+		if (positive)
+			positiveHistogram[nextBinIndex] += sampleWeight * r;
+		else
+			negativeHistogram[nextBinIndex] += sampleWeight * r;
+
+		weightSum += sampleWeight * r;
+	}
+}
+
+/*
+Information gain of the histograms of an attribute, the sample entropy minus the conditional entropy.
+*/
+static float histogramGain(float sampleEntropy, const double* positiveHistogram, const double* negativeHistogram, double weightSum)
+{
+	float ig = sampleEntropy;
+
+	//add the conditional entropy.
+	for (int i = 0; i < NUM_BINS; i++)
+	{
+		double p = positiveHistogram[i];
+		double n = negativeHistogram[i];
+		double attributeSum = p + n;
+
+		p = p / fmax(attributeSum, 1e-9);
+		n = 1.0 - p;
+
+		float attributeEntropy = -p * log2(fmax(p, 1e-12)) + n * log2(fmax(n, 1e-12));
+		
+		ig -= (attributeSum / weightSum) * attributeEntropy;
+	}
+	return ig;
+}
+
 /*
 computes the classification threshold of the samples given an attribute index.
 The mean attribute value is calcualted for positive samples and negative samples.
@@ -170,11 +876,7 @@ float DecisionTree::threshold(std::vector<Sample*>& samples, float* sampleWeight
 		}
 	}
 
-	positiveMean /= fmax(positiveSum, 1e-9f);
-	negativeMean /= fmax(negativeSum, 1e-9f);
-
-	//set the threshold to the midpoint of the means.
-	return positiveMean * 0.5f + negativeMean * 0.5f;
+	return meanThreshold(positiveMean, positiveSum, negativeMean, negativeSum);
 }
 
 /*
@@ -198,11 +900,7 @@ float DecisionTree::entropy(std::vector<Sample*>& samples, float* sampleWeights,
 		weightSum += sampleWeights[i];
 	}
 
-	positiveP /= weightSum;
-	negativeP /= weightSum;
-
-	float entropy = -positiveP * log2(fmax(positiveP, 1e-12f)) - negativeP * log2(fmax(negativeP, 1e-12f));
-	return entropy;
+	return entropyFromSums(positiveP, negativeP, weightSum);
 }
 
 /*
@@ -215,7 +913,6 @@ float DecisionTree::informationGain(std::vector<Sample*>& samples, float* sample
 {
 	//get the sample entropy.
 	float sampleEntropy = entropy(samples, sampleWeights, classIndex);
-	float ig = sampleEntropy;
 
 	float minAttributeSample = samples[0]->x(attributeIndex);
 	float maxAttributeSample = minAttributeSample;
@@ -237,52 +934,381 @@ float DecisionTree::informationGain(std::vector<Sample*>& samples, float* sample
 	double weightSum = 0.0;
 	for (int i = 0; i < samples.size(); i++)
 	{
-		float attributeSample = samples[i]->x(attributeIndex);
+		double normalizedBinIndex = binCoordinate(samples[i]->x(attributeIndex), minAttributeSample, maxAttributeSample);
+		addToHistogram(normalizedBinIndex, samples[i]->y() == classIndex, sampleWeights[i], _positiveHistogram, _negativeHistogram, weightSum);
+	}
+
+	return histogramGain(sampleEntropy, _positiveHistogram, _negativeHistogram, weightSum);
+}
+
+/*
+Node of a tree grown by trainClasses. The sums of the node are accumulated over its samples in the order
+of the training set, the order of the samples of the node in train, so they are the same sums.
+*/
+struct JointNode
+{
+	DecisionTree* node;
+	int depth;
+	bool split;	//the node is still a split candidate.
+	std::minstd_rand random;
+	std::vector<int> attributes;	//candidate attributes, in the sampled order.
+	std::vector<float> gains;	//information gain of every candidate attribute.
+
+	int numSamples;
+	int numPositiveSamples;
+	double positiveP;
+	double negativeP;
+	double weightSum;
+	float sampleEntropy;
+
+	float positiveMean;
+	float positiveSum;
+	float negativeMean;
+	float negativeSum;
+
+	int numSplitSamples[2];
+	double splitWeights[2];
+	int child;	//index of child 0 in the next level, -1 for a leaf.
+};
+
+/*
+Sample of a node of a tree grown by trainClasses. The entries of a level are ordered by sample, then by
+tree, so every pass reads the values of a sample once for all the trees.
+*/
+struct JointEntry
+{
+	int sample;
+	int node;	//index of the node in the level.
+	float weight;	//weight of the sample for the class of the tree.
+	int positive;	//1 if the sample is of the class of the tree.
+};
+
+void DecisionTree::setJointTraining(bool jointTraining)
+{
+	_jointTraining = jointTraining;
+}
+
+bool DecisionTree::jointTraining()
+{
+	return _jointTraining && !_exactSplits && _numQuantileBins == 0 && _attributeBins == nullptr && !_limits.leafWise && _limits.maxLeaves <= 0;
+}
+
+bool DecisionTree::trainClasses(std::vector<Sample*>& samples, float** sampleWeights, const int* classIndices, int numClasses, WeakLearner** learners)
+{
+	std::vector<DecisionTree*> trees(numClasses);
+	for (int t = 0; t < numClasses; t++)
+	{
+		trees[t] = dynamic_cast<DecisionTree*>(learners[t]);
+		if (trees[t] == nullptr || !trees[t]->jointTraining())
+			return false;
+	}
+	for (int t = 0; t < numClasses; t++)
+		trees[t]->clear();
+
+	int numSamples = samples.size();
+	if (numSamples == 0)
+		return true;
 
-		double normalizedBinIndex = (double)NUM_BINS * (attributeSample - minAttributeSample) / fmax(maxAttributeSample - minAttributeSample, 1e-6);
-		int binIndex = (int)floor(normalizedBinIndex);
-		int nextBinIndex = binIndex + 1;
-		double r = normalizedBinIndex - floor(normalizedBinIndex);
+	int numAttributes = samples[0]->n();
 
-		if (binIndex >= 0 && binIndex < NUM_BINS)
+	//the samples of the roots.
+	std::vector<JointEntry> entries((size_t)numSamples * numClasses);
+	std::vector<JointNode> level(numClasses);
+	for (int t = 0; t < numClasses; t++)
+	{
+		level[t].node = trees[t];
+		level[t].depth = 0;
+	}
+	for (int i = 0; i < numSamples; i++)
+	{
+		int y = samples[i]->y();
+		for (int t = 0; t < numClasses; t++)
 		{
-			if (samples[i]->y() == classIndex)
-				_positiveHistogram[binIndex] += sampleWeights[i] * (1.0 - r);
+			JointEntry& entry = entries[(size_t)i * numClasses + t];
+			entry.sample = i;
+			entry.node = t;
+			entry.weight = sampleWeights[t][i];
+			entry.positive = (y == classIndices[t]) ? 1 : 0;
+		}
+	}
+
+	std::vector<uint8_t> candidates;	//1 if attribute a is a candidate of node j, at j * numAttributes + a.
+	std::vector<uint8_t> evaluated;	//1 if the histograms of the current attribute are accumulated for node j.
+	std::vector<float> minAttributeSamples;
+	std::vector<float> maxAttributeSamples;
+	std::vector<double> histogramWeightSums;
+	std::vector<double> histograms;
+	while (level.size() > 0)
+	{
+		int numNodes = level.size();
+		size_t numEntries = entries.size();
+		for (int j = 0; j < numNodes; j++)
+		{
+			JointNode& node = level[j];
+			node.numSamples = 0;
+			node.numPositiveSamples = 0;
+			node.positiveP = 0.0;
+			node.negativeP = 0.0;
+			node.weightSum = 0.0;
+		}
+
+		//class counts and label entropy of every node.
+		for (size_t e = 0; e < numEntries; e++)
+		{
+			const JointEntry& entry = entries[e];
+			JointNode& node = level[entry.node];
+			float weight = entry.weight;
+			node.numSamples++;
+			if (entry.positive)
+			{
+				node.numPositiveSamples++;
+				node.positiveP += weight;
+			}
 			else
-				_negativeHistogram[binIndex] += sampleWeights[i] *(1.0 - r);
+				node.negativeP += weight;
+			node.weightSum += weight;
+		}
+
+		//the nodes which may be split, with the same tests and random draws as findSplit.
+		std::vector<uint8_t> usedAttributes(numAttributes, 0);
+		candidates.assign((size_t)numNodes * numAttributes, 0);
+		for (int j = 0; j < numNodes; j++)
+		{
+			JointNode& node = level[j];
+			const TreeGrowthLimits& limits = node.node->_limits;
+			int numNegativeSamples = node.numSamples - node.numPositiveSamples;
+			node.node->_nodeLabel = (node.positiveP > node.negativeP) ? 1.0f : -1.0f;
+			node.split = node.numPositiveSamples > 0 && numNegativeSamples > 0;
+			if (limits.maxDepth > 0 && node.depth >= limits.maxDepth)
+				node.split = false;
+			if (node.numSamples < 2 * limits.minSamplesLeaf)
+				node.split = false;
+			node.child = -1;
+			if (!node.split)
+				continue;
+
+			node.random.seed(node.node->_seed);
+			node.attributes.resize(numAttributes);
+			for (int i = 0; i < numAttributes; i++)
+				node.attributes[i] = i;
 
-			weightSum += sampleWeights[i] * (1.0 - r);
+			int numCandidates = numAttributes;
+			int numSampledAttributes = node.node->_numSampledAttributes;
+			if (numSampledAttributes > 0 && numSampledAttributes < numAttributes)
+			{
+				numCandidates = numSampledAttributes;
+				for (int i = 0; i < numCandidates; i++)
+					std::swap(node.attributes[i], node.attributes[i + node.random() % (numAttributes - i)]);
+			}
+			node.attributes.resize(numCandidates);
+			for (int i = 0; i < numCandidates; i++)
+			{
+				candidates[(size_t)j * numAttributes + node.attributes[i]] = 1;
+				usedAttributes[node.attributes[i]] = 1;
+			}
+			node.gains.resize(numAttributes);
+			node.sampleEntropy = entropyFromSums(node.positiveP, node.negativeP, node.weightSum);
 		}
-		if (nextBinIndex >= 0 && nextBinIndex < NUM_BINS)
+
+		//the histograms of an attribute for every node, one pass for the range and one for the histograms.
+		evaluated.resize(numNodes);
+		minAttributeSamples.resize(numNodes);
+		maxAttributeSamples.resize(numNodes);
+		histogramWeightSums.resize(numNodes);
+		histograms.resize((size_t)numNodes * 2 * NUM_BINS);
+		for (int a = 0; a < numAttributes; a++)
 		{
-			if (samples[i]->y() == classIndex)
-				_positiveHistogram[nextBinIndex] += sampleWeights[i] * r;
+			if (!usedAttributes[a])
+				continue;
+
+			for (int j = 0; j < numNodes; j++)
+			{
+				evaluated[j] = candidates[(size_t)j * numAttributes + a];
+				minAttributeSamples[j] = NAN;
+				maxAttributeSamples[j] = NAN;
+				histogramWeightSums[j] = 0.0;
+			}
+			std::fill(histograms.begin(), histograms.end(), 0.0);
+
+			int sample = -1;
+			float attributeSample = 0.0f;
+			for (size_t e = 0; e < numEntries; e++)
+			{
+				const JointEntry& entry = entries[e];
+				if (!evaluated[entry.node])
+					continue;
+				if (entry.sample != sample)
+				{
+					sample = entry.sample;
+					attributeSample = samples[sample]->x(a);
+				}
+
+				minAttributeSamples[entry.node] = fmin(attributeSample, minAttributeSamples[entry.node]);
+				maxAttributeSamples[entry.node] = fmax(attributeSample, maxAttributeSamples[entry.node]);
+			}
+
+			sample = -1;
+			for (size_t e = 0; e < numEntries; e++)
+			{
+				const JointEntry& entry = entries[e];
+				int j = entry.node;
+				if (!evaluated[j])
+					continue;
+				if (entry.sample != sample)
+				{
+					sample = entry.sample;
+					attributeSample = samples[sample]->x(a);
+				}
+
+				double* positiveHistogram = &histograms[(size_t)j * 2 * NUM_BINS];
+				double normalizedBinIndex = binCoordinate(attributeSample, minAttributeSamples[j], maxAttributeSamples[j]);
+				addToHistogram(normalizedBinIndex, entry.positive != 0, entry.weight, positiveHistogram, positiveHistogram + NUM_BINS, histogramWeightSums[j]);
+			}
+
+			for (int j = 0; j < numNodes; j++)
+			{
+				if (evaluated[j])
+				{
+					double* positiveHistogram = &histograms[(size_t)j * 2 * NUM_BINS];
+					level[j].gains[a] = histogramGain(level[j].sampleEntropy, positiveHistogram, positiveHistogram + NUM_BINS, histogramWeightSums[j]);
+				}
+			}
+		}
+
+		//the split attribute is the first candidate with the maximum information gain.
+		for (int j = 0; j < numNodes; j++)
+		{
+			JointNode& node = level[j];
+			if (!node.split)
+				continue;
+
+			float maxInformationGain = node.gains[node.attributes[0]];
+			int maxAttributeIndex = node.attributes[0];
+			for (int i = 1; i < node.attributes.size(); i++)
+			{
+				float ig = node.gains[node.attributes[i]];
+				if (ig > maxInformationGain)
+				{
+					maxInformationGain = ig;
+					maxAttributeIndex = node.attributes[i];
+				}
+			}
+
+			if (maxInformationGain < node.node->_limits.minInformationGain)
+			{
+				node.split = false;
+				continue;
+			}
+			node.node->_splitAttributeIndex = maxAttributeIndex;
+			node.positiveMean = 0.0f;
+			node.positiveSum = 0.0f;
+			node.negativeMean = 0.0f;
+			node.negativeSum = 0.0f;
+		}
+
+		//the thresholds, from the class means of the split attributes.
+		for (size_t e = 0; e < numEntries; e++)
+		{
+			const JointEntry& entry = entries[e];
+			JointNode& node = level[entry.node];
+			if (!node.split)
+				continue;
+
+			float weight = entry.weight;
+			float attributeSample = samples[entry.sample]->x(node.node->_splitAttributeIndex);
+			if (entry.positive)
+			{
+				node.positiveMean += weight * attributeSample;
+				node.positiveSum += weight;
+			}
 			else
-				_negativeHistogram[nextBinIndex] += sampleWeights[i] * r;
+			{
+				node.negativeMean += weight * attributeSample;
+				node.negativeSum += weight;
+			}
+		}
+
+		for (int j = 0; j < numNodes; j++)
+		{
+			JointNode& node = level[j];
+			if (!node.split)
+				continue;
 
-			weightSum += sampleWeights[i] * r;
+			node.node->_splitThresh = meanThreshold(node.positiveMean, node.positiveSum, node.negativeMean, node.negativeSum);
+			node.numSplitSamples[0] = 0;
+			node.numSplitSamples[1] = 0;
+			node.splitWeights[0] = 0.0;
+			node.splitWeights[1] = 0.0;
 		}
-	}
 
-	//add the conditional entropy.
-	for (int i = 0; i < NUM_BINS; i++)
-	{
-		double p = _positiveHistogram[i];
-		double n = _negativeHistogram[i];
-		double attributeSum = p + n;
+		//the number and the weight of the samples of each side of the splits.
+		for (size_t e = 0; e < numEntries; e++)
+		{
+			const JointEntry& entry = entries[e];
+			JointNode& node = level[entry.node];
+			if (!node.split)
+				continue;
 
-		p = p / fmax(attributeSum, 1e-9);
-		n = 1.0 - p;
+			int side = (samples[entry.sample]->x(node.node->_splitAttributeIndex) > node.node->_splitThresh) ? 1 : 0;
+			node.numSplitSamples[side]++;
+			node.splitWeights[side] += entry.weight;
+		}
 
-		float attributeEntropy = -p * log2(fmax(p, 1e-12)) + n * log2(fmax(n, 1e-12));
-		
-		ig -= (attributeSum / weightSum) * attributeEntropy;
+		//split the nodes, the children form the next level.
+		std::vector<JointNode> nextLevel;
+		for (int j = 0; j < numNodes; j++)
+		{
+			JointNode& node = level[j];
+			if (!node.split)
+				continue;
+
+			const TreeGrowthLimits& limits = node.node->_limits;
+			if (node.numSplitSamples[0] == 0 || node.numSplitSamples[1] == 0)
+				continue;
+			if (node.numSplitSamples[0] < limits.minSamplesLeaf || node.numSplitSamples[1] < limits.minSamplesLeaf)
+				continue;
+			if (node.splitWeights[0] < limits.minWeightLeaf || node.splitWeights[1] < limits.minWeightLeaf)
+				continue;
+
+			node.child = nextLevel.size();
+			for (int c = 0; c < 2; c++)
+			{
+				node.node->_childNode[c] = node.node->createChild(node.random());
+				JointNode child;
+				child.node = node.node->_childNode[c];
+				child.depth = node.depth + 1;
+				nextLevel.push_back(child);
+			}
+		}
+
+		//move the samples of the split nodes to the children, keeping the order of the entries.
+		size_t numNextEntries = 0;
+		for (size_t e = 0; e < numEntries; e++)
+		{
+			JointEntry entry = entries[e];
+			JointNode& node = level[entry.node];
+			if (node.child < 0)
+				continue;
+
+			entry.node = node.child + ((samples[entry.sample]->x(node.node->_splitAttributeIndex) > node.node->_splitThresh) ? 1 : 0);
+			entries[numNextEntries++] = entry;
+		}
+		entries.resize(numNextEntries);
+		level.swap(nextLevel);
 	}
-	return ig;
+	return true;
 }
 
 void DecisionTree::exportInternal(std::string& params)
 {
+	if (_nodes != nullptr || _compactNodes != nullptr)
+	{
+		std::vector<DecisionTreeNode> nodes;
+		flatten(nodes);
+		exportNode(params, nodes.data(), 0);
+		return;
+	}
+
 	params += std::to_string(_splitAttributeIndex) + WEAK_LEARNER_DELIM;
 	params += std::to_string(_splitThresh) + WEAK_LEARNER_DELIM;
 	params += std::to_string(_nodeLabel) + WEAK_LEARNER_DELIM;
@@ -302,14 +1328,15 @@ void DecisionTree::exportInternal(std::string& params)
 	if(_childNode[1] != nullptr)
 		_childNode[1]->exportInternal(params);
 }
-void DecisionTree::importInternal(std::string& params)
+void DecisionTree::importInternal(ParamReader& params)
 {
-	_splitAttributeIndex = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-	_splitThresh = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-	_nodeLabel = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+	clear();
+	_splitAttributeIndex = params.nextInt(WEAK_LEARNER_DELIM);
+	_splitThresh = params.nextFloat(WEAK_LEARNER_DELIM);
+	_nodeLabel = params.nextFloat(WEAK_LEARNER_DELIM);
 
-	int childNode0 = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-	int childNode1 = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+	int childNode0 = params.nextInt(WEAK_LEARNER_DELIM);
+	int childNode1 = params.nextInt(WEAK_LEARNER_DELIM);
 
 	if (childNode0 == 1)
 	{
@@ -322,4 +1349,292 @@ void DecisionTree::importInternal(std::string& params)
 		_childNode[1] = new DecisionTree();
 		_childNode[1]->importInternal(params);
 	}
+}
+
+void DecisionTree::exportNode(std::string& params, const DecisionTreeNode* nodes, int index)
+{
+	const DecisionTreeNode& node = nodes[index];
+	params += std::to_string(node.attribute) + WEAK_LEARNER_DELIM;
+	params += std::to_string(node.threshold) + WEAK_LEARNER_DELIM;
+	params += std::to_string(node.label) + WEAK_LEARNER_DELIM;
+
+	int split = (node.child >= 0) ? 1 : 0;
+	params += std::to_string(split) + WEAK_LEARNER_DELIM;
+	params += std::to_string(split) + WEAK_LEARNER_DELIM;
+
+	if (split == 1)
+	{
+		exportNode(params, nodes, node.child);
+		exportNode(params, nodes, node.child + 1);
+	}
+}
+
+void DecisionTree::flatten(std::vector<DecisionTreeNode>& nodes)
+{
+	//a tree loaded from a binary model is already flat.
+	if (_nodes != nullptr)
+	{
+		nodes.insert(nodes.end(), _nodes, _nodes + _numNodes);
+		return;
+	}
+
+	//the labels of the split nodes are not stored by a quantized tree.
+	if (_compactNodes != nullptr)
+	{
+		for (int i = 0; i < _numNodes; i++)
+		{
+			const CompactTreeNode& compactNode = _compactNodes[i];
+			DecisionTreeNode node;
+			node.attribute = compactNode.attribute;
+			node.child = compactNode.child;
+			node.threshold = (node.child >= 0) ? _thresholds[compactNode.value] : 0.0f;
+			node.label = (node.child >= 0) ? 0.0f : _leafLabels[compactNode.value];
+			nodes.push_back(node);
+		}
+		return;
+	}
+
+	//breadth first traversal, the children of a node are appended next to each other.
+	std::vector<DecisionTree*> queue;
+	queue.push_back(this);
+	for (int i = 0; i < queue.size(); i++)
+	{
+		DecisionTree* tree = queue[i];
+		DecisionTreeNode node;
+		node.attribute = tree->_splitAttributeIndex;
+		node.threshold = tree->_splitThresh;
+		node.label = tree->_nodeLabel;
+		node.child = -1;
+
+		//a node with a single child is evaluated as a leaf by label.
+		if (tree->_childNode[0] != nullptr && tree->_childNode[1] != nullptr)
+		{
+			node.child = queue.size();
+			queue.push_back(tree->_childNode[0]);
+			queue.push_back(tree->_childNode[1]);
+		}
+		nodes.push_back(node);
+	}
+}
+
+//tag of the binary parameters.
+#define DECISION_TREE_BINARY_TAG 0x45455254
+
+/*
+Binary parameters: uint32 tag, int32 numNodes, 2 x uint32 reserved, DecisionTreeNode nodes[numNodes] (aligned).
+*/
+void DecisionTree::exportBinary(BinaryWriter& writer)
+{
+	std::vector<DecisionTreeNode> nodes;
+	flatten(nodes);
+
+	writer.write((uint32_t)DECISION_TREE_BINARY_TAG);
+	writer.write((int32_t)nodes.size());
+	writer.write((uint32_t)0);
+	writer.write((uint32_t)0);
+	writer.writeArray(nodes.data(), nodes.size());
+}
+
+bool DecisionTree::importBinary(BinaryReader& reader, int n)
+{
+	uint32_t tag;
+	int32_t numNodes;
+	uint32_t reserved[2];
+	if (!reader.read(tag) || tag != DECISION_TREE_BINARY_TAG)
+		return false;
+	if (!reader.read(numNodes) || !reader.read(reserved[0]) || !reader.read(reserved[1]) || numNodes <= 0)
+		return false;
+
+	DecisionTreeNode* nodes = reader.readArray<DecisionTreeNode>(numNodes);
+	if (nodes == nullptr)
+		return false;
+
+	//children are stored after their parent, which also rules out cycles. Splits read attributes of the samples.
+	for (int i = 0; i < numNodes; i++)
+	{
+		if (nodes[i].child >= 0 && (nodes[i].child <= i || nodes[i].child + 1 >= numNodes || nodes[i].attribute < 0 || nodes[i].attribute >= n))
+			return false;
+	}
+
+	clear();
+	_nodes = nodes;
+	_numNodes = numNodes;
+	_nodeLabel = nodes[0].label;
+	_mappedParams = true;
+	return true;
+}
+
+/*
+Returns the index of 'value' in the sorted table of distinct values.
+*/
+static int tableIndex(std::vector<float>& table, float value)
+{
+	return std::lower_bound(table.begin(), table.end(), value) - table.begin();
+}
+
+/*
+Sorts the values and removes the duplicates.
+*/
+static void distinctValues(std::vector<float>& values)
+{
+	std::sort(values.begin(), values.end());
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+/*
+The remapping to the threshold and label tables is exact, quantized trees label every sample as the
+float tree, for every quantization type.
+*/
+void DecisionTree::quantize(QuantizationType type)
+{
+	std::vector<DecisionTreeNode> nodes;
+	flatten(nodes);
+
+	if (type == QUANTIZE_NONE)
+	{
+		//restore the float nodes of a quantized tree.
+		if (_compactNodes == nullptr)
+			return;
+
+		clear();
+		_nodes = new DecisionTreeNode[nodes.size()];
+		std::copy(nodes.begin(), nodes.end(), _nodes);
+		_numNodes = nodes.size();
+		_nodeLabel = _nodes[0].label;
+		return;
+	}
+
+	std::vector<float> thresholds;
+	std::vector<float> leafLabels;
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].child >= 0)
+			thresholds.push_back(nodes[i].threshold);
+		else
+			leafLabels.push_back(nodes[i].label);
+	}
+	distinctValues(thresholds);
+	distinctValues(leafLabels);
+
+	//the indices must fit the 16 bit fields, otherwise the tree is kept.
+	const int maxIndex = 0xffff;
+	if (thresholds.size() > maxIndex + 1 || leafLabels.size() > maxIndex + 1)
+		return;
+
+	CompactTreeNode* compactNodes = new CompactTreeNode[nodes.size()];
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].attribute > maxIndex)
+		{
+			delete[] compactNodes;
+			return;
+		}
+
+		compactNodes[i].attribute = nodes[i].attribute;
+		compactNodes[i].child = nodes[i].child;
+		if (nodes[i].child >= 0)
+			compactNodes[i].value = tableIndex(thresholds, nodes[i].threshold);
+		else
+			compactNodes[i].value = tableIndex(leafLabels, nodes[i].label);
+	}
+
+	clear();
+	_compactNodes = compactNodes;
+	_numNodes = nodes.size();
+	_numThresholds = thresholds.size();
+	_numLeafLabels = leafLabels.size();
+	_thresholds = new float[_numThresholds];
+	_leafLabels = new float[_numLeafLabels];
+	std::copy(thresholds.begin(), thresholds.end(), _thresholds);
+	std::copy(leafLabels.begin(), leafLabels.end(), _leafLabels);
+	_nodeLabel = nodes[0].label;
+}
+
+int DecisionTree::numNodes()
+{
+	if (_compactNodes != nullptr || _nodes != nullptr)
+		return _numNodes;
+
+	int count = 1;
+	for (int i = 0; i < 2; i++)
+	{
+		if (_childNode[i] != nullptr)
+			count += _childNode[i]->numNodes();
+	}
+	return count;
+}
+
+int DecisionTree::pathLength(Sample* x)
+{
+	int length = 0;
+	if (_compactNodes != nullptr)
+	{
+		int index = 0;
+		while (_compactNodes[index].child >= 0)
+		{
+			const CompactTreeNode& node = _compactNodes[index];
+			index = node.child + (x->x(node.attribute) > _thresholds[node.value] ? 1 : 0);
+			length++;
+		}
+		return length;
+	}
+
+	if (_nodes != nullptr)
+	{
+		int index = 0;
+		while (_nodes[index].child >= 0)
+		{
+			const DecisionTreeNode& node = _nodes[index];
+			index = node.child + (x->x(node.attribute) > node.threshold ? 1 : 0);
+			length++;
+		}
+		return length;
+	}
+
+	if (_childNode[0] == nullptr && _childNode[1] == nullptr)
+		return 0;
+
+	if (x->x(_splitAttributeIndex) > _splitThresh)
+		return 1 + _childNode[1]->pathLength(x);
+	else
+		return 1 + _childNode[0]->pathLength(x);
+}
+
+size_t DecisionTree::parameterSize()
+{
+	if (_compactNodes != nullptr)
+		return _numNodes * sizeof(CompactTreeNode) + (_numThresholds + _numLeafLabels) * sizeof(float);
+	if (_nodes != nullptr)
+		return _numNodes * sizeof(DecisionTreeNode);
+
+	size_t size = sizeof(DecisionTree);
+	for (int i = 0; i < 2; i++)
+	{
+		if (_childNode[i] != nullptr)
+			size += _childNode[i]->parameterSize();
+	}
+	return size;
+}
+
+void DecisionTree::clear()
+{
+	delete _childNode[0];
+	delete _childNode[1];
+	_childNode[0] = nullptr;
+	_childNode[1] = nullptr;
+
+	if (!_mappedParams)
+		delete[] _nodes;
+	_nodes = nullptr;
+	_numNodes = 0;
+	_mappedParams = false;
+
+	delete[] _compactNodes;
+	delete[] _thresholds;
+	delete[] _leafLabels;
+	_compactNodes = nullptr;
+	_thresholds = nullptr;
+	_leafLabels = nullptr;
+	_numThresholds = 0;
+	_numLeafLabels = 0;
 }
\ No newline at end of file
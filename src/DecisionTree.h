@@ -10,9 +10,49 @@ gregjksmith@gmail.com
 
 #pragma once
 #include <WeakLearner.h>
+#include <Binning.h>
+#include <random>
+#include <cfloat>
 
-//number of bins used to compute the attribute histograms.
-#define NUM_BINS 25
+/*
+DecisionTreeNode. Node of a tree stored as an array, the layout of the trees of a binary model.
+The children of a split node are stored next to each other, at 'child' and 'child + 1'. A leaf has child = -1.
+*/
+struct DecisionTreeNode
+{
+	int32_t attribute;
+	float threshold;
+	float label;
+	int32_t child;
+};
+
+/*
+CompactTreeNode. Node of a quantized tree. The thresholds of the splits are remapped to indices into
+a sorted table of the distinct thresholds of the tree, and the leaf labels to indices into a table
+of the distinct labels, which halves the size of a node without changing any split.
+*/
+struct CompactTreeNode
+{
+	uint16_t attribute;
+	uint16_t value;	//index of the threshold of a split node, or of the label of a leaf.
+	int32_t child;	//children at 'child' and 'child + 1', -1 for a leaf.
+};
+
+/*
+TreeGrowthLimits. Limits of the growth of a DecisionTree. A node is a leaf if its split would exceed a
+limit. The defaults do not limit the tree, which is grown until its leaves are pure or can not be split.
+*/
+struct TreeGrowthLimits
+{
+	int maxDepth = 0;	//maximum depth of a leaf, the root has depth 0. 0 for no limit.
+	int maxLeaves = 0;	//maximum number of leaves, 0 for no limit.
+	int minSamplesLeaf = 1;	//minimum number of samples of a leaf.
+	float minWeightLeaf = 0.0f;	//minimum sum of the sample weights of a leaf.
+	float minInformationGain = -FLT_MAX;	//minimum information gain of a split.
+	bool leafWise = false;	//split the leaf with the largest weighted information gain first, instead of depth first.
+};
+
+struct ExactSplitState;
 
 class DecisionTree : public WeakLearner
 {
@@ -22,10 +62,101 @@ public:
 
 	virtual float label(Sample* x);
 	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+	virtual WeakLearner* create();
+
+	/*
+	Sets the number of attributes sampled at random for every split, the split attribute is the best
+	of the sampled attributes. A numAttributes of 0 evaluates every attribute. Sampling decorrelates
+	the trees of a random forest, see Bagging.h, and reduces the cost of a split.
+	*/
+	void setAttributeSampling(int numAttributes);
+
+	/*
+	Seeds the attribute sampling of the next call to train. Trees created by create start with seed 0.
+	*/
+	virtual void setRandomSeed(unsigned int seed);
+
+	/*
+	Sets the growth limits of the next call to train. Depth first, the maximum number of leaves stops
+	the splits once reached, in tree order. Leaf wise, the leaves are split in the order of their
+	information gain times their sample weight, so the leaves are spent on the best splits.
+	*/
+	void setGrowthLimits(const TreeGrowthLimits& limits);
+	TreeGrowthLimits growthLimits();
+
+	/*
+	Enables the exact split search. The threshold of a split is the entropy optimal boundary between two
+	consecutive values of the samples of the node, found by a sweep over the presorted samples of every
+	candidate attribute, see SortedAttributes.h. By default the split attribute is chosen by the binned
+	information gain, and the threshold is the midpoint of the class means.
+	*/
+	void setExactSplits(bool exactSplits);
+
+	/*
+	Bins the attribute values of the histograms at the quantiles of the training set instead of between
+	the minimum and the maximum of every node, with at most 'numBins' bins per attribute, see
+	QuantileSketch.h. The bins follow the distribution of the values, so outliers do not squash the
+	samples into a few bins, and a node does not scan the range of its values. The split of a node is
+	x > edge at the bin edge of the lowest children entropy, instead of the midpoint of the class means.
+	A numBins of 0 restores the bins of every node. The training set is binned once, a byte per value,
+	by createTrainingCache, and the histograms of a node read the bins of its samples.
+	*/
+	void setQuantileBins(int numBins);
+
+	/*
+	Sets the bins of the histograms, e.g. the quantiles of a sample stream which does not fit in memory,
+	see AttributeSketches. The bins are not owned, and must outlive the training. A nullptr removes them.
+	*/
+	void setAttributeBins(AttributeBins* bins);
+
+	/*
+	Enables joint training: the trees of several classes, e.g. of a round of AdaBoost, are trained level by
+	level in lockstep by trainClasses. Each pass over an attribute of the training set accumulates the
+	histograms of the nodes of every tree at the level, so the attribute values are read once for all the
+	classes instead of once per class. The trees are identical to the trees trained one at a time, but the
+	state of every class is held at once. It pays off on wide training sets which do not fit in the cache.
+	Joint training requires the default histogram splits with the bins of every node, grown depth first
+	without a maximum number of leaves, and is disabled otherwise.
+	*/
+	void setJointTraining(bool jointTraining);
+	virtual bool jointTraining();
+	virtual bool trainClasses(std::vector<Sample*>& samples, float** sampleWeights, const int* classIndices, int numClasses, WeakLearner** learners);
+
+	/*
+	Returns the presorted attributes of 'samples' if the exact split search is enabled, the samples
+	binned with the bins set or with their quantile bins if bins are enabled, nullptr else.
+	*/
+	virtual TrainingCache* createTrainingCache(std::vector<Sample*>& samples);
+
+	/*
+	Sets the tree to a copy of an array of 'numNodes' nodes, in the layout of DecisionTreeNode, e.g. a
+	tree grown by GradientBoosting. The labels of the leaves may be any score.
+	*/
+	void setNodes(const DecisionTreeNode* nodes, int numNodes);
+
+	/*
+	Returns the number of nodes of the tree, split nodes and leaves.
+	*/
+	int numNodes();
+
+	/*
+	Returns the number of splits evaluated to label a sample.
+	*/
+	int pathLength(Sample* x);
+
+	/*
+	Stores the tree as an array of DecisionTreeNodes in breadth first order. A tree loaded from a
+	binary model is evaluated in place, without building the node objects.
+	*/
+	virtual void exportBinary(BinaryWriter& writer);
+	virtual bool importBinary(BinaryReader& reader, int n);
+
+	virtual void quantize(QuantizationType type);
+	virtual size_t parameterSize();
 
 protected:
 	virtual void exportInternal(std::string& params);
-	virtual void importInternal(std::string& params);
+	virtual void importInternal(ParamReader& params);
 
 private:
 
@@ -34,13 +165,31 @@ private:
 	float _nodeLabel;	//label of node.
 	DecisionTree* _childNode[2];	//split nodes. If the nodes are null this node is a leaf.
 
+	int _numSampledAttributes;	//attributes sampled for a split, 0 for every attribute.
+	unsigned int _seed;	//seed of the attribute sampling.
+	TreeGrowthLimits _limits;
+	bool _exactSplits;	//split at the entropy optimal threshold of the presorted samples.
+	bool _jointTraining;	//train the trees of several classes in lockstep.
+	int _numQuantileBins;	//bins of the quantiles of the training set, 0 for the bins of every node.
+	AttributeBins* _attributeBins;	//bins set by setAttributeBins, not owned.
+
+	DecisionTreeNode* _nodes;	//node array of a tree loaded from a binary model, or restored from a quantized tree.
+	int _numNodes;
+
+	CompactTreeNode* _compactNodes;	//node array of a quantized tree, _numNodes nodes.
+	float* _thresholds;	//distinct split thresholds of a quantized tree, sorted.
+	float* _leafLabels;	//distinct leaf labels of a quantized tree, sorted.
+	int _numThresholds;
+	int _numLeafLabels;
+
 	double _positiveHistogram[NUM_BINS];
 	double _negativeHistogram[NUM_BINS];
 
 	/*
-	returns true if all samples in a training set are the same class.
+	returns true if all samples in a training set are the same class. The majority class is the class
+	of the larger sample weight.
 	*/
-	bool isSameClass(std::vector<Sample*>& samples, int classIndex, float& majorityClass);
+	bool isSameClass(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, float& majorityClass);
 	
 	/*
 	computes the classification threshold of the samples given an attribute index.
@@ -62,4 +211,72 @@ private:
 	IG(T,a) = H(T) - H(T,a).
 	*/
 	float informationGain(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, int attributeIndex);
+
+	/*
+	Trains the subtree of a node at 'depth' depth first. numLeaves counts the leaves of the tree.
+	BinnedSamples* binnedSamples: bins of the training set, nullptr for the bins of every node.
+	std::vector<int>& indices: index of every sample of the node in the binned training set, empty
+		without binnedSamples.
+	*/
+	void trainNode(std::vector<Sample*>& samples, float* sampleWeights, std::vector<int>& indices, int classIndex, BinnedSamples* binnedSamples, int depth, int& numLeaves);
+
+	/*
+	Trains the tree leaf wise, from a priority queue of the best splits of the leaves.
+	*/
+	void trainLeafWise(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, BinnedSamples* binnedSamples);
+
+	/*
+	Finds the split attribute and threshold of a node, and the information gain of the split, at the
+	bin edges of 'binnedSamples', or with the histograms of the bins of the node if binnedSamples is
+	nullptr. Returns false if the node is a leaf, because its samples are of the same class, the split
+	does not separate the samples, or a growth limit is reached. The label of the node is set to the
+	majority class.
+	*/
+	bool findSplit(std::vector<Sample*>& samples, float* sampleWeights, const int* indices, int classIndex, BinnedSamples* binnedSamples, int depth, std::minstd_rand& random, float& gain);
+
+	/*
+	Finds the split of a node at the bin edge of the lowest children entropy, over the bins of the
+	candidate attributes, and sets the split attribute and threshold. The histograms are accumulated
+	from the bins of the training set at the indices of the node samples. Returns false if no edge
+	leaves the growth limits of minSamplesLeaf and minWeightLeaf to both children.
+	*/
+	bool findBinSplit(std::vector<Sample*>& samples, float* sampleWeights, const int* indices, int classIndex, BinnedSamples* binnedSamples, const int* attributes, int numAttributes, float& gain);
+
+	/*
+	Splits the samples, the sample weights and the indices, if any, of a node by its split, into
+	child 0 (below or equal to the threshold) and child 1.
+	*/
+	void splitSamples(std::vector<Sample*>& samples, float* sampleWeights, std::vector<int>& indices, std::vector<Sample*> childSamples[2], std::vector<float> childSampleWeights[2], std::vector<int> childIndices[2]);
+
+	/*
+	Trains the tree with the exact split search. The nodes are ranges of the presorted attribute lists of
+	ExactSplitState, grown depth first or leaf wise.
+	*/
+	void trainExact(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Finds the exact split of the node of the samples in [begin, end) of the sorted lists. Returns false
+	if the node is a leaf. numLeft is the number of samples at or below the threshold.
+	*/
+	bool findExactSplit(ExactSplitState& state, int begin, int end, int depth, std::minstd_rand& random, float& gain, int& numLeft);
+
+	/*
+	Creates a child node with the training configuration of the node, and the given seed.
+	*/
+	DecisionTree* createChild(unsigned int seed);
+
+	/*
+	Appends the nodes of the tree to 'nodes' in breadth first order.
+	*/
+	void flatten(std::vector<DecisionTreeNode>& nodes);
+
+	/*
+	Appends the text parameters of the subtree at 'index' of the node array.
+	*/
+	void exportNode(std::string& params, const DecisionTreeNode* nodes, int index);
+
+	/*
+	Releases the child nodes and the node arrays.
+	*/
+	void clear();
 };
\ No newline at end of file
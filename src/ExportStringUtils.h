@@ -1,16 +1,130 @@
-#pragma once
-
-#include <string>
-
-#define WEAK_LEARNER_DELIM ','
-#define ENSEMBLE_DELIM ';'
-
-inline std::string getNextParam(std::string& val, const char delim)
-{
-	int offset = 0;
-	int findIndex = val.find_first_of(delim);
-	std::string parsed = val.substr(offset, findIndex);
-
-	val = val.substr(findIndex + 1, val.size() - findIndex);
-	return parsed;
+/*
+ExportStringUtils.h
+Tokenizing of the text model format. Parameters are separated by WEAK_LEARNER_DELIM, the entries
+of an ensemble by ENSEMBLE_DELIM.
+
+ParamReader reads the tokens of a model with a cursor, as views into the model string, and parses
+numbers in place. Importing a model is linear in its size, without intermediate strings.
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdlib>
+
+#define WEAK_LEARNER_DELIM ','
+#define ENSEMBLE_DELIM ';'
+
+/*
+ParamReader. Cursor over the tokens of a text model. The model string is not copied, and must
+outlive the reader.
+*/
+class ParamReader
+{
+public:
+	ParamReader(std::string_view params)
+	{
+		_params = params;
+		_position = 0;
+	}
+
+	/*
+	Returns the next token, up to 'delim' or the end of the model, and moves past the delimiter.
+	*/
+	std::string_view next(const char delim)
+	{
+		size_t end = _params.find(delim, _position);
+		if (end == std::string_view::npos)
+			end = _params.size();
+
+		std::string_view token = _params.substr(_position, end - _position);
+		_position = (end < _params.size()) ? end + 1 : end;
+		return token;
+	}
+
+	/*
+	Returns a reader over the next token, e.g. the parameters of a weak learner in an ensemble.
+	*/
+	ParamReader nextReader(const char delim)
+	{
+		return ParamReader(next(delim));
+	}
+
+	/*
+	Parses the next token as a number. Invalid tokens are parsed as 0, as with atoi and atof.
+	*/
+	int nextInt(const char delim)
+	{
+		return parse<int>(next(delim));
+	}
+
+	float nextFloat(const char delim)
+	{
+		return parse<float>(next(delim));
+	}
+
+	double nextDouble(const char delim)
+	{
+		return parse<double>(next(delim));
+	}
+
+	bool atEnd()
+	{
+		return _position >= _params.size();
+	}
+
+	/*
+	Returns the parameters not read yet, and moves to the end of the model.
+	*/
+	std::string_view rest()
+	{
+		std::string_view rest = _params.substr(_position);
+		_position = _params.size();
+		return rest;
+	}
+
+	/*
+	Returns the number of characters read.
+	*/
+	size_t position()
+	{
+		return _position;
+	}
+
+private:
+	template <class T>
+	static T parse(std::string_view token)
+	{
+		//from_chars does not accept the leading whitespace and plus sign accepted by atof.
+		while (!token.empty() && (token.front() == ' ' || token.front() == '+'))
+			token.remove_prefix(1);
+
+		T value = 0;
+		std::from_chars(token.data(), token.data() + token.size(), value);
+		return value;
+	}
+
+	std::string_view _params;
+	size_t _position;
+};
+
+/*
+Returns the next token of 'val' up to 'delim', and removes it and the delimiter from 'val'.
+Every call copies the rest of the string, use ParamReader to read a complete model.
+*/
+inline std::string getNextParam(std::string& val, const char delim)
+{
+	size_t findIndex = val.find_first_of(delim);
+	if (findIndex == std::string::npos)
+	{
+		std::string parsed;
+		parsed.swap(val);
+		return parsed;
+	}
+
+	std::string parsed = val.substr(0, findIndex);
+	val.erase(0, findIndex + 1);
+	return parsed;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+FastMath.h
+Fast approximations of the transcendental functions in the hot loops of the learners, built on
+the vectorized polynomial approximations of Simd.h. Learners use them when fast math is enabled
+with WeakLearner::setFastMath. With the scalar fallback of Simd.h, the functions are exact.
+
+Error bounds, measured against double precision references:
+fastExp: relative error below 2e-7 for x in [-87, 88]. The argument is clamped to that range.
+fastLog: absolute error below 1e-7 for x in [0.5, 2], relative error below 2e-7 elsewhere,
+	for positive normal x.
+fastSigmoid: absolute error below 1e-7, for every x.
+fastLogSumExp: absolute error below 4e-7 * (1 + |result|).
+*/
+
+#pragma once
+#include <Simd.h>
+
+/*
+Returns the first lane of a vector.
+*/
+inline float simdFirst(FloatVector x)
+{
+	float lanes[SIMD_WIDTH];
+	simdStore(lanes, x);
+	return lanes[0];
+}
+
+/*
+Vectorized sigmoid, 1 / (1 + exp(-x)).
+*/
+inline FloatVector simdSigmoid(FloatVector x)
+{
+	FloatVector one = simdSet(1.0f);
+	return simdDiv(one, simdAdd(one, simdExp(simdSub(simdSet(0.0f), x))));
+}
+
+inline float fastExp(float x)
+{
+	return simdFirst(simdExp(simdSet(x)));
+}
+
+inline float fastLog(float x)
+{
+	return simdFirst(simdLog(simdSet(x)));
+}
+
+inline float fastSigmoid(float x)
+{
+	return simdFirst(simdSigmoid(simdSet(x)));
+}
+
+/*
+Computes y[i] = exp(x[i]) for 'count' values. x and y may be the same array.
+*/
+inline void fastExp(const float* x, float* y, int count)
+{
+	int i = 0;
+	for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+		simdStore(&y[i], simdExp(simdLoad(&x[i])));
+	for (; i < count; i++)
+		y[i] = fastExp(x[i]);
+}
+
+/*
+Computes y[i] = sigmoid(x[i]) for 'count' values. x and y may be the same array.
+*/
+inline void fastSigmoid(const float* x, float* y, int count)
+{
+	int i = 0;
+	for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+		simdStore(&y[i], simdSigmoid(simdLoad(&x[i])));
+	for (; i < count; i++)
+		y[i] = fastSigmoid(x[i]);
+}
+
+/*
+Returns log(sum(exp(x[i]))) of 'count' values, shifted by the maximum value for stability.
+*/
+inline float fastLogSumExp(const float* x, int count)
+{
+	float xMax = x[0];
+	for (int i = 1; i < count; i++)
+		xMax = (x[i] > xMax) ? x[i] : xMax;
+
+	FloatVector shift = simdSet(xMax);
+	FloatVector sum = simdSet(0.0f);
+	int i = 0;
+	for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+		sum = simdAdd(sum, simdExp(simdSub(simdLoad(&x[i]), shift)));
+
+	float lanes[SIMD_WIDTH];
+	simdStore(lanes, sum);
+	float expSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < count; i++)
+		expSum += fastExp(x[i] - xMax);
+	return xMax + fastLog(expSum);
+}
\ No newline at end of file
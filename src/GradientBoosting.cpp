@@ -0,0 +1,474 @@
+#include <GradientBoosting.h>
+#include <QuantileSketch.h>
+#include <algorithm>
+#include <queue>
+
+/*
+Sums of the gradients and of the hessians of the samples in a bin.
+*/
+struct GradientBin
+{
+	double gradient;
+	double hessian;
+};
+
+/*
+Leaf of a tree being grown. The samples of the leaf are a range of the index array, which is
+partitioned in place when the leaf is split.
+*/
+struct GrowingLeaf
+{
+	int node;	//index of the leaf in the node array.
+	int begin;
+	int end;
+	int depth;
+	double gradient;	//gradient sum of the samples.
+	double hessian;	//hessian sum of the samples.
+	std::vector<GradientBin> histogram;	//histograms of every attribute, starting at the bin offset of the attribute.
+	int splitAttribute;
+	int splitBin;	//the bins up to splitBin go to the first child.
+	double gain;	//gain of the best split, 0 if the leaf is not split.
+};
+
+/*
+Accumulates the histograms of the samples indices[begin, end).
+*/
+static void buildHistogram(BinnedSamples& binnedSamples, std::vector<int>& offsets, int* indices, int begin, int end, float* gradients, float* hessians, std::vector<GradientBin>& histogram)
+{
+	GradientBin zero = { 0.0, 0.0 };
+	histogram.assign(offsets.back(), zero);
+
+	for (int a = 0; a < binnedSamples.n(); a++)
+	{
+		const uint8_t* bins = binnedSamples.attribute(a);
+		GradientBin* attributeHistogram = &histogram[offsets[a]];
+		for (int j = begin; j < end; j++)
+		{
+			int i = indices[j];
+			attributeHistogram[bins[i]].gradient += gradients[i];
+			attributeHistogram[bins[i]].hessian += hessians[i];
+		}
+	}
+}
+
+/*
+Sets the gradient and hessian sums of the leaf from the histogram of its first attribute.
+*/
+static void sumHistogram(GrowingLeaf& leaf, std::vector<int>& offsets)
+{
+	leaf.gradient = 0.0;
+	leaf.hessian = 0.0;
+	for (int b = offsets[0]; b < offsets[1]; b++)
+	{
+		leaf.gradient += leaf.histogram[b].gradient;
+		leaf.hessian += leaf.histogram[b].hessian;
+	}
+}
+
+/*
+Finds the split of the leaf with the largest gain,
+gain = (GL^2 / (HL + lambda) + GR^2 / (HR + lambda) - G^2 / (H + lambda)) / 2,
+where both children have a hessian sum of at least minChildWeight.
+*/
+static void findSplit(GrowingLeaf& leaf, AttributeBins& bins, std::vector<int>& offsets, float minChildWeight, float lambda)
+{
+	leaf.gain = 0.0;
+	leaf.splitAttribute = -1;
+	leaf.splitBin = 0;
+
+	double parentScore = leaf.gradient * leaf.gradient / (leaf.hessian + lambda);
+	for (int a = 0; a < bins.n(); a++)
+	{
+		const GradientBin* histogram = &leaf.histogram[offsets[a]];
+		double leftGradient = 0.0;
+		double leftHessian = 0.0;
+		for (int b = 0; b < bins.numBins(a) - 1; b++)
+		{
+			leftGradient += histogram[b].gradient;
+			leftHessian += histogram[b].hessian;
+			if (leftHessian < minChildWeight)
+				continue;
+
+			double rightHessian = leaf.hessian - leftHessian;
+			if (rightHessian < minChildWeight)
+				break;
+
+			double rightGradient = leaf.gradient - leftGradient;
+			double gain = 0.5 * (leftGradient * leftGradient / (leftHessian + lambda) + rightGradient * rightGradient / (rightHessian + lambda) - parentScore);
+			if (gain > leaf.gain)
+			{
+				leaf.gain = gain;
+				leaf.splitAttribute = a;
+				leaf.splitBin = b;
+			}
+		}
+	}
+}
+
+GradientBoosting::GradientBoosting()
+{
+	_numScores = 0;
+	_n = 0;
+	_k = 0;
+	_shrinkage = GB_SHRINKAGE;
+	_maxLeaves = GB_MAX_LEAVES;
+	_minChildWeight = GB_MIN_CHILD_WEIGHT;
+	_maxDepth = 0;
+	_lambda = GB_LAMBDA;
+	_numBins = NUM_BINS;
+	_quantileBins = false;
+}
+
+GradientBoosting::GradientBoosting(std::vector<Sample*>& samples, int numRounds) : GradientBoosting()
+{
+	train(samples, numRounds);
+}
+
+GradientBoosting::~GradientBoosting()
+{
+	clear();
+}
+
+void GradientBoosting::setShrinkage(float shrinkage)
+{
+	_shrinkage = shrinkage;
+}
+
+void GradientBoosting::setTreeLimits(int maxLeaves, float minChildWeight, int maxDepth)
+{
+	_maxLeaves = std::max(maxLeaves, 1);
+	_minChildWeight = minChildWeight;
+	_maxDepth = maxDepth;
+}
+
+void GradientBoosting::setRegularization(float lambda)
+{
+	_lambda = lambda;
+}
+
+void GradientBoosting::setNumBins(int numBins)
+{
+	_numBins = numBins;
+}
+
+void GradientBoosting::setQuantileBins(bool quantileBins)
+{
+	_quantileBins = quantileBins;
+}
+
+void GradientBoosting::train(std::vector<Sample*>& samples, int numRounds)
+{
+	clear();
+	if (samples.size() == 0)
+		return;
+
+	int numSamples = samples.size();
+	_n = samples[0]->n();
+	_k = 0;
+	for (int i = 0; i < numSamples; i++)
+		_k = std::max(_k, samples[i]->y() + 1);
+	_numScores = (_k <= 2) ? 1 : _k;
+
+	//bin the training set once, the bins are shared by every tree.
+	AttributeBins bins = _quantileBins ? AttributeSketches(samples).bins(_numBins) : AttributeBins(samples, _numBins);
+	BinnedSamples binnedSamples(samples, bins);
+
+	//the base scores are the log odds, or the log probabilities, of the class priors.
+	std::vector<int> classCounts(std::max(_k, 2), 0);
+	for (int i = 0; i < numSamples; i++)
+		classCounts[samples[i]->y()]++;
+
+	_baseScores.resize(_numScores);
+	for (int c = 0; c < _numScores; c++)
+	{
+		int classIndex = (_numScores == 1) ? 1 : c;
+		float p = fmin(fmax((float)classCounts[classIndex] / (float)numSamples, 1e-6f), 1.0f - 1e-6f);
+		_baseScores[c] = (_numScores == 1) ? log(p / (1.0f - p)) : log(p);
+	}
+
+	//the scores, gradients and hessians of score c are stored at c * numSamples.
+	float* scores = new float[numSamples * _numScores];
+	float* gradients = new float[numSamples * _numScores];
+	float* hessians = new float[numSamples * _numScores];
+	for (int c = 0; c < _numScores; c++)
+	{
+		for (int i = 0; i < numSamples; i++)
+			scores[c * numSamples + i] = _baseScores[c];
+	}
+
+	float* probabilities = new float[_numScores];
+	for (int round = 0; round < numRounds; round++)
+	{
+		//the gradients of the log loss of the current scores.
+		for (int i = 0; i < numSamples; i++)
+		{
+			int y = samples[i]->y();
+			if (_numScores == 1)
+			{
+				float p = 1.0f / (1.0f + exp(-scores[i]));
+				gradients[i] = p - (y == 1 ? 1.0f : 0.0f);
+				hessians[i] = fmax(p * (1.0f - p), 1e-16f);
+				continue;
+			}
+
+			float maxScore = scores[i];
+			for (int c = 1; c < _numScores; c++)
+				maxScore = fmax(maxScore, scores[c * numSamples + i]);
+
+			float sum = 0.0f;
+			for (int c = 0; c < _numScores; c++)
+			{
+				probabilities[c] = exp(scores[c * numSamples + i] - maxScore);
+				sum += probabilities[c];
+			}
+			for (int c = 0; c < _numScores; c++)
+			{
+				float p = probabilities[c] / sum;
+				gradients[c * numSamples + i] = p - (y == c ? 1.0f : 0.0f);
+				hessians[c * numSamples + i] = fmax(p * (1.0f - p), 1e-16f);
+			}
+		}
+
+		for (int c = 0; c < _numScores; c++)
+			_trees.push_back(growTree(binnedSamples, &gradients[c * numSamples], &hessians[c * numSamples], &scores[c * numSamples]));
+	}
+
+	delete[] probabilities;
+	delete[] scores;
+	delete[] gradients;
+	delete[] hessians;
+}
+
+DecisionTree* GradientBoosting::growTree(BinnedSamples& binnedSamples, float* gradients, float* hessians, float* scores)
+{
+	int numSamples = binnedSamples.numSamples();
+	AttributeBins& bins = binnedSamples.bins();
+
+	//offsets of the histograms of every attribute.
+	std::vector<int> offsets(bins.n() + 1, 0);
+	for (int a = 0; a < bins.n(); a++)
+		offsets[a + 1] = offsets[a] + bins.numBins(a);
+
+	std::vector<int> indices(numSamples);
+	for (int i = 0; i < numSamples; i++)
+		indices[i] = i;
+
+	DecisionTreeNode leafNode = { 0, 0.0f, 0.0f, -1 };
+	std::vector<DecisionTreeNode> nodes;
+	nodes.push_back(leafNode);
+
+	//a leaf is never moved, the leaves are referenced by index.
+	std::vector<GrowingLeaf> leaves;
+	leaves.reserve(2 * _maxLeaves);
+	leaves.push_back(GrowingLeaf());
+	GrowingLeaf& root = leaves[0];
+	root.node = 0;
+	root.begin = 0;
+	root.end = numSamples;
+	root.depth = 0;
+	buildHistogram(binnedSamples, offsets, indices.data(), 0, numSamples, gradients, hessians, root.histogram);
+	sumHistogram(root, offsets);
+	findSplit(root, bins, offsets, _minChildWeight, _lambda);
+
+	//leaves ordered by the gain of their best split.
+	std::priority_queue<std::pair<double, int>> queue;
+	if (root.gain > 0.0)
+		queue.push(std::make_pair(root.gain, 0));
+
+	int numLeaves = 1;
+	while (numLeaves < _maxLeaves && !queue.empty())
+	{
+		int parentIndex = queue.top().second;
+		queue.pop();
+
+		//partition the samples of the leaf by the split.
+		GrowingLeaf& parent = leaves[parentIndex];
+		const uint8_t* attributeBins = binnedSamples.attribute(parent.splitAttribute);
+		int splitBin = parent.splitBin;
+		int middle = std::partition(indices.begin() + parent.begin, indices.begin() + parent.end, [&](int i) { return attributeBins[i] <= splitBin; }) - indices.begin();
+
+		int child = nodes.size();
+		nodes[parent.node].attribute = parent.splitAttribute;
+		nodes[parent.node].threshold = bins.edge(parent.splitAttribute, splitBin);
+		nodes[parent.node].child = child;
+		nodes.push_back(leafNode);
+		nodes.push_back(leafNode);
+
+		GrowingLeaf children[2];
+		for (int i = 0; i < 2; i++)
+		{
+			children[i].node = child + i;
+			children[i].begin = (i == 0) ? parent.begin : middle;
+			children[i].end = (i == 0) ? middle : parent.end;
+			children[i].depth = parent.depth + 1;
+		}
+
+		//scan the smaller child, the histograms of the larger child are those of the parent minus the smaller child.
+		int smaller = (middle - parent.begin <= parent.end - middle) ? 0 : 1;
+		int larger = 1 - smaller;
+		buildHistogram(binnedSamples, offsets, indices.data(), children[smaller].begin, children[smaller].end, gradients, hessians, children[smaller].histogram);
+		children[larger].histogram.swap(parent.histogram);
+		for (int b = 0; b < offsets.back(); b++)
+		{
+			children[larger].histogram[b].gradient -= children[smaller].histogram[b].gradient;
+			children[larger].histogram[b].hessian -= children[smaller].histogram[b].hessian;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			sumHistogram(children[i], offsets);
+			if (_maxDepth <= 0 || children[i].depth < _maxDepth)
+				findSplit(children[i], bins, offsets, _minChildWeight, _lambda);
+			else
+				children[i].gain = 0.0;
+
+			int leafIndex = leaves.size();
+			leaves.push_back(children[i]);
+			if (children[i].gain > 0.0)
+				queue.push(std::make_pair(children[i].gain, leafIndex));
+		}
+		numLeaves++;
+	}
+
+	//the score of a leaf minimizes the second order approximation of the loss.
+	for (int l = 0; l < leaves.size(); l++)
+	{
+		GrowingLeaf& leaf = leaves[l];
+		if (nodes[leaf.node].child >= 0)
+			continue;
+
+		float value = (float)(-leaf.gradient / (leaf.hessian + _lambda)) * _shrinkage;
+		nodes[leaf.node].label = value;
+		for (int j = leaf.begin; j < leaf.end; j++)
+			scores[indices[j]] += value;
+	}
+
+	DecisionTree* tree = new DecisionTree();
+	tree->setNodes(nodes.data(), nodes.size());
+	return tree;
+}
+
+void GradientBoosting::scores(Sample* x, float* scores)
+{
+	for (int c = 0; c < _numScores; c++)
+		scores[c] = _baseScores[c];
+
+	for (int t = 0; t < _trees.size(); t++)
+		scores[t % _numScores] += _trees[t]->label(x);
+}
+
+int GradientBoosting::label(Sample* x, float& confidence)
+{
+	//the scores of most models fit on the stack.
+	float stackScores[GB_STACK_SCORES];
+	std::vector<float> heapScores;
+	float* s = stackScores;
+	if (_numScores > GB_STACK_SCORES)
+	{
+		heapScores.resize(_numScores);
+		s = heapScores.data();
+	}
+	scores(x, s);
+
+	int maxClassIndex = 0;
+	if (_numScores == 1)
+	{
+		float p = 1.0f / (1.0f + exp(-s[0]));
+		maxClassIndex = (p > 0.5f) ? 1 : 0;
+		confidence = (maxClassIndex == 1) ? p : 1.0f - p;
+	}
+	else
+	{
+		for (int c = 1; c < _numScores; c++)
+		{
+			if (s[c] > s[maxClassIndex])
+				maxClassIndex = c;
+		}
+
+		float expSum = 0.0f;
+		for (int c = 0; c < _numScores; c++)
+			expSum += exp(s[c] - s[maxClassIndex]);
+		confidence = 1.0f / expSum;
+	}
+	return maxClassIndex;
+}
+
+float GradientBoosting::error(std::vector<Sample*>& samples)
+{
+	int numNegativeSamples = 0;
+	for (int i = 0; i < samples.size(); i++)
+	{
+		float confidence;
+		if (label(samples[i], confidence) != samples[i]->y())
+			numNegativeSamples++;
+	}
+	return (float)numNegativeSamples / (float)samples.size();
+}
+
+int GradientBoosting::numTrees()
+{
+	return _trees.size();
+}
+
+int GradientBoosting::numNodes()
+{
+	int count = 0;
+	for (int t = 0; t < _trees.size(); t++)
+		count += _trees[t]->numNodes();
+	return count;
+}
+
+/*
+Text parameters: numTrees, n, k, numScores, the base scores, and the parameters of every tree.
+*/
+std::string GradientBoosting::exportParams()
+{
+	std::string params;
+	params += std::to_string(_trees.size()) + ENSEMBLE_DELIM;
+	params += std::to_string(_n) + ENSEMBLE_DELIM;
+	params += std::to_string(_k) + ENSEMBLE_DELIM;
+	params += std::to_string(_numScores) + ENSEMBLE_DELIM;
+
+	for (int c = 0; c < _numScores; c++)
+		params += std::to_string(_baseScores[c]) + ENSEMBLE_DELIM;
+
+	for (int t = 0; t < _trees.size(); t++)
+		params += _trees[t]->exportParams() + ENSEMBLE_DELIM;
+	return params;
+}
+
+void GradientBoosting::importParams(std::string& params)
+{
+	ParamReader reader(params);
+	importParams(reader);
+	params.erase(0, reader.position());
+}
+
+void GradientBoosting::importParams(ParamReader& params)
+{
+	clear();
+	int numTrees = params.nextInt(ENSEMBLE_DELIM);
+	_n = params.nextInt(ENSEMBLE_DELIM);
+	_k = params.nextInt(ENSEMBLE_DELIM);
+	_numScores = params.nextInt(ENSEMBLE_DELIM);
+
+	_baseScores.resize(_numScores);
+	for (int c = 0; c < _numScores; c++)
+		_baseScores[c] = params.nextFloat(ENSEMBLE_DELIM);
+
+	for (int t = 0; t < numTrees; t++)
+	{
+		ParamReader treeParams = params.nextReader(ENSEMBLE_DELIM);
+		DecisionTree* tree = new DecisionTree();
+		tree->importParams(treeParams);
+		_trees.push_back(tree);
+	}
+}
+
+void GradientBoosting::clear()
+{
+	for (int t = 0; t < _trees.size(); t++)
+		delete _trees[t];
+	_trees.clear();
+	_baseScores.clear();
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+/*
+GradientBoosting.h
+Second order gradient boosting of trees. Every round fits a tree to the gradients and the hessians of
+the loss of the current model and adds it, scaled by the shrinkage, to the model. The loss is the log
+loss of a single score for two classes, and the softmax loss of one score, and one tree per round, for
+every class of a multiclass problem.
+
+The attribute values are binned once, with the bins of Binning.h, and the split of a node is found on
+the gradient and hessian histograms of the samples of the node. Trees grow leaf by leaf, splitting the
+leaf with the largest gain first, until the maximum number of leaves or no split satisfies the minimum
+hessian sum of a leaf. The histograms of the larger child of a split are the histograms of the parent
+minus those of the smaller child, so only the smaller child is scanned.
+
+The trees are DecisionTrees of leaf scores, evaluated and stored by the node array code of DecisionTree.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include <Sample.h>
+#include <DecisionTree.h>
+#include <Binning.h>
+
+//default factor of the leaf scores of a tree.
+#define GB_SHRINKAGE 0.1f
+//default maximum number of leaves of a tree.
+#define GB_MAX_LEAVES 31
+//default minimum sum of the hessians of the samples of a leaf.
+#define GB_MIN_CHILD_WEIGHT 1.0f
+//default L2 regularization of the leaf scores.
+#define GB_LAMBDA 1.0f
+
+//number of scores labelled with a stack buffer, models of more classes allocate the scores.
+#define GB_STACK_SCORES 64
+
+class GradientBoosting
+{
+public:
+	/*
+	Creates an empty model, to be configured and trained with train, or loaded with importParams.
+	*/
+	GradientBoosting();
+
+	/*
+	Constructor, trains 'numRounds' rounds with the default configuration.
+	*/
+	GradientBoosting(std::vector<Sample*>& samples, int numRounds);
+	~GradientBoosting();
+
+	/*
+	Sets the factor of the leaf scores of every tree.
+	*/
+	void setShrinkage(float shrinkage);
+
+	/*
+	Sets the growth limits of the trees.
+	int maxLeaves: maximum number of leaves of a tree.
+	float minChildWeight: minimum sum of the hessians of the samples of a leaf.
+	int maxDepth: maximum depth of a leaf, 0 for no limit.
+	*/
+	void setTreeLimits(int maxLeaves, float minChildWeight, int maxDepth = 0);
+
+	/*
+	Sets the L2 regularization of the leaf scores, added to the hessian sum of a leaf.
+	*/
+	void setRegularization(float lambda);
+
+	/*
+	Sets the number of bins of every attribute, at most MAX_BINS.
+	*/
+	void setNumBins(int numBins);
+
+	/*
+	Places the bin edges at the quantiles of every attribute, from the sketches of QuantileSketch.h,
+	instead of at equal widths between the minimum and the maximum.
+	*/
+	void setQuantileBins(bool quantileBins);
+
+	/*
+	Trains a model of 'numRounds' rounds, replacing the current model.
+	*/
+	void train(std::vector<Sample*>& samples, int numRounds);
+
+	/*
+	Returns the most likely label for a sample given the learned parameters.
+	Sample* x: input sample.
+	float& confidence: likelihood of the label is stored here.
+	*/
+	int label(Sample* x, float& confidence);
+
+	/*
+	Computes the classification error of a data set.
+	*/
+	float error(std::vector<Sample*>& samples);
+
+	/*
+	Returns the number of trees, the number of rounds times the number of scores.
+	*/
+	int numTrees();
+
+	/*
+	Returns the number of nodes of every tree.
+	*/
+	int numNodes();
+
+	std::string exportParams();
+
+	/*
+	Loads a model in the text format of exportParams. The model is removed from 'params'.
+	*/
+	void importParams(std::string& params);
+	void importParams(ParamReader& params);
+
+private:
+	/*
+	Computes the scores of a sample, the sums of the base scores and of the leaf scores of the trees.
+	*/
+	void scores(Sample* x, float* scores);
+
+	/*
+	Grows a tree on the gradients and hessians of one score, and adds its leaf scores to the scores
+	of the training samples.
+	*/
+	DecisionTree* growTree(BinnedSamples& binnedSamples, float* gradients, float* hessians, float* scores);
+
+	void clear();
+
+	std::vector<DecisionTree*> _trees;	//tree of score c of round r at index r * _numScores + c.
+	std::vector<float> _baseScores;	//initial score of every score, from the class priors.
+	int _numScores;	//1 for two classes, the number of classes else.
+	int _n;
+	int _k;
+
+	float _shrinkage;
+	int _maxLeaves;
+	float _minChildWeight;
+	int _maxDepth;
+	float _lambda;
+	int _numBins;
+	bool _quantileBins;
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <KernelCache.h>
+#include <algorithm>
+
+KernelCache::KernelCache(std::vector<Sample*>& samples, size_t maxBytes) : _samples(samples)
+{
+	int numSamples = _samples.size();
+	size_t rowBytes = (size_t)numSamples * sizeof(float);
+	_maxRows = (rowBytes > 0) ? (int)std::min(maxBytes / rowBytes, (size_t)numSamples) : 0;
+	_numRows = 0;
+	_numRequests = 0;
+	_numComputed = numSamples;
+
+	_norms = new float[numSamples];
+	for (int i = 0; i < numSamples; i++)
+		_norms[i] = innerProduct(_samples[i], _samples[i]);
+
+	_rows = new std::atomic<float*>[numSamples];
+	for (int i = 0; i < numSamples; i++)
+		_rows[i] = nullptr;
+}
+
+KernelCache::~KernelCache()
+{
+	for (int i = 0; i < _samples.size(); i++)
+		delete[] _rows[i].load();
+	delete[] _rows;
+	delete[] _norms;
+}
+
+float KernelCache::innerProduct(int i, int j)
+{
+	_numRequests++;
+
+	if (i == j)
+		return _norms[i];
+
+	//the Gram matrix is symmetric, use whichever row is already cached.
+	float* r = _rows[j].load(std::memory_order_acquire);
+	if (r != nullptr)
+		return r[i];
+
+	r = row(i);
+	if (r != nullptr)
+		return r[j];
+
+	_numComputed++;
+	return innerProduct(_samples[i], _samples[j]);
+}
+
+float KernelCache::norm(int i)
+{
+	_numRequests++;
+	return _norms[i];
+}
+
+bool KernelCache::matches(std::vector<Sample*>& samples)
+{
+	return samples == _samples;
+}
+
+long long KernelCache::numRequests()
+{
+	return _numRequests;
+}
+
+long long KernelCache::numComputed()
+{
+	return _numComputed;
+}
+
+/*
+Computes the inner product / dot product between two samples x0 and x1.
+*/
+float KernelCache::innerProduct(Sample* x0, Sample* x1)
+{
+	float dp = 0.0f;
+	for (int i = 0; i < x0->n(); i++)
+	{
+		dp += x0->x(i) * x1->x(i);
+	}
+	return dp;
+}
+
+/*
+Returns the cached row i of the Gram matrix, computing it if required.
+Returns nullptr if the row is not cached and the cache is full.
+*/
+float* KernelCache::row(int i)
+{
+	float* r = _rows[i].load(std::memory_order_acquire);
+	if (r != nullptr)
+		return r;
+
+	//reserve a row in the cache.
+	if (_numRows.fetch_add(1) >= _maxRows)
+	{
+		_numRows--;
+		return nullptr;
+	}
+
+	int numSamples = _samples.size();
+	float* computedRow = new float[numSamples];
+	for (int j = 0; j < numSamples; j++)
+		computedRow[j] = (i == j) ? _norms[i] : innerProduct(_samples[i], _samples[j]);
+	_numComputed += numSamples - 1;
+
+	//another trainer may have computed the same row concurrently, keep the first one stored.
+	if (!_rows[i].compare_exchange_strong(r, computedRow, std::memory_order_acq_rel))
+	{
+		delete[] computedRow;
+		_numRows--;
+		return r;
+	}
+	return computedRow;
+}
\ No newline at end of file
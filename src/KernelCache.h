@@ -0,0 +1,74 @@
+/*
+KernelCache.h
+Dataset scoped cache of the inner products between training samples (the Gram matrix).
+The squared norms of every sample are precomputed, and rows of the Gram matrix are computed
+on first use and kept for the lifetime of the cache, up to a memory budget. The entries of the Gram matrix do not
+depend on the class index or the sample weights, so a single cache can be shared by every
+Svm trained on the same sample set.
+
+The cache is thread safe, concurrent trainers may share a single instance.
+*/
+
+#pragma once
+#include <WeakLearner.h>
+#include <atomic>
+
+//default memory of the cached Gram matrix rows, in bytes.
+#define KERNEL_CACHE_BYTES (256 << 20)
+
+class KernelCache : public TrainingCache
+{
+public:
+	/*
+	Constructor:
+	std::vector<Sample*>& samples: training set.
+	size_t maxBytes: maximum memory of the Gram matrix rows held by the cache, a row of N samples
+		takes N * sizeof(float) bytes. Once the limit is reached the remaining inner products are
+		computed directly. Setting maxBytes = 0 caches the norms only.
+	*/
+	KernelCache(std::vector<Sample*>& samples, size_t maxBytes = KERNEL_CACHE_BYTES);
+	virtual ~KernelCache();
+
+	/*
+	Returns the inner product between the samples at index i and index j of the training set.
+	*/
+	float innerProduct(int i, int j);
+
+	/*
+	Returns the inner product of the sample at index i with itself.
+	*/
+	float norm(int i);
+
+	/*
+	Returns true if the cache was created for the training set 'samples'.
+	*/
+	bool matches(std::vector<Sample*>& samples);
+
+	/*
+	Statistics. The number of inner products requested from the cache, and the number of
+	inner products actually computed, including the norms and the cached rows.
+	*/
+	long long numRequests();
+	long long numComputed();
+
+	/*
+	Computes the inner product / dot product between two samples x0 and x1.
+	*/
+	static float innerProduct(Sample* x0, Sample* x1);
+
+private:
+	/*
+	Returns the cached row i of the Gram matrix, computing it if required.
+	Returns nullptr if the row is not cached and the cache is full.
+	*/
+	float* row(int i);
+
+	std::vector<Sample*> _samples;
+	float* _norms;	//inner product of each sample with itself.
+	std::atomic<float*>* _rows;	//cached Gram matrix rows, nullptr if not computed.
+	int _maxRows;	//rows of the memory budget.
+	std::atomic<int> _numRows;
+
+	std::atomic<long long> _numRequests;
+	std::atomic<long long> _numComputed;
+};
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <LogisticLoss.h>
+#include <cmath>
+
+LogisticLoss::LogisticLoss(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, double l2Regularization, int n) : _samples(samples)
+{
+	_sampleWeights = sampleWeights;
+	_classIndex = classIndex;
+	_l2Regularization = l2Regularization;
+	_n = n;
+	_numDataPasses = 0;
+	_allreduce = nullptr;
+	_failed = false;
+
+	_weightSum = 0.0;
+	for (int i = 0; i < _samples.size(); i++)
+		_weightSum += _sampleWeights[i];
+
+	_curvature = new double[_samples.size()];
+	_trialCurvature = new double[_samples.size()];
+	for (int i = 0; i < _samples.size(); i++)
+	{
+		_curvature[i] = 0.0;
+		_trialCurvature[i] = 0.0;
+	}
+}
+
+LogisticLoss::~LogisticLoss()
+{
+	delete[] _curvature;
+	delete[] _trialCurvature;
+}
+
+void LogisticLoss::setAllreduce(Allreduce* allreduce)
+{
+	//the sample weights are normalized by the weight sum of all the shards.
+	_allreduce = allreduce;
+	if (_allreduce != nullptr && !_allreduce->sum(&_weightSum, 1))
+		_failed = true;
+}
+
+int LogisticLoss::size()
+{
+	return _n + 1;
+}
+
+double LogisticLoss::evaluate(double* x, double* gradient)
+{
+	_numDataPasses++;
+
+	for (int j = 0; j <= _n; j++)
+		gradient[j] = 0.0;
+
+	double loss = 0.0;
+	for (int i = 0; i < _samples.size(); i++)
+	{
+		Sample* sample = _samples[i];
+		double s = _sampleWeights[i] / _weightSum;
+		double y = (sample->y() == _classIndex) ? 1.0 : 0.0;
+
+		double z = x[_n];
+		for (int j = 0; j < _n; j++)
+			z += x[j] * sample->x(j);
+
+		//numerically stable log(1 + exp(z)).
+		double softplus = (z > 0.0) ? z + log1p(exp(-z)) : log1p(exp(z));
+		double p = 1.0 / (1.0 + exp(-z));
+		loss += s * (softplus - y * z);
+
+		double d = s * (p - y);
+		for (int j = 0; j < _n; j++)
+			gradient[j] += d * sample->x(j);
+		gradient[_n] += d;
+
+		_trialCurvature[i] = s * p * (1.0 - p);
+	}
+
+	//sum the loss and the gradient of every shard, before the penalty of the weights.
+	if (_allreduce != nullptr)
+	{
+		std::vector<double> sums(_n + 2);
+		sums[0] = loss;
+		for (int j = 0; j <= _n; j++)
+			sums[j + 1] = gradient[j];
+		if (!_allreduce->sum(sums.data(), sums.size()))
+			_failed = true;
+		loss = sums[0];
+		for (int j = 0; j <= _n; j++)
+			gradient[j] = sums[j + 1];
+	}
+
+	//add the L2 penalty, the bias is not penalized.
+	for (int j = 0; j < _n; j++)
+	{
+		loss += 0.5 * _l2Regularization * x[j] * x[j];
+		gradient[j] += _l2Regularization * x[j];
+	}
+	return loss;
+}
+
+void LogisticLoss::acceptPoint()
+{
+	double* curvature = _curvature;
+	_curvature = _trialCurvature;
+	_trialCurvature = curvature;
+}
+
+void LogisticLoss::hessianVector(double* v, double* hv)
+{
+	_numDataPasses++;
+
+	for (int j = 0; j <= _n; j++)
+		hv[j] = 0.0;
+
+	//H = X' * D * X + l2 * I, computed with a single pass over the samples.
+	for (int i = 0; i < _samples.size(); i++)
+	{
+		Sample* sample = _samples[i];
+		double u = v[_n];
+		for (int j = 0; j < _n; j++)
+			u += v[j] * sample->x(j);
+
+		double c = _curvature[i] * u;
+		for (int j = 0; j < _n; j++)
+			hv[j] += c * sample->x(j);
+		hv[_n] += c;
+	}
+
+	if (_allreduce != nullptr && !_allreduce->sum(hv, _n + 1))
+		_failed = true;
+
+	for (int j = 0; j < _n; j++)
+		hv[j] += _l2Regularization * v[j];
+}
+
+bool LogisticLoss::failed()
+{
+	return _failed;
+}
+
+int LogisticLoss::numDataPasses()
+{
+	return _numDataPasses;
+}
\ No newline at end of file
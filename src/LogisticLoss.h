@@ -0,0 +1,68 @@
+/*
+LogisticLoss.h
+Weighted cross entropy loss of a logistic model, as an Objective for the full batch optimizers.
+The parameters are the logistic weights followed by the bias. An L2 penalty on the weights
+keeps the minimum finite when the training set is separable. The sums over the samples may be combined
+over the shards of worker processes with Allreduce.
+
+loss = sum(si * (log(1 + exp(zi)) - yi * zi)) / sum(si) + 0.5 * l2 * |w|^2, zi = w.xi + b
+*/
+
+#pragma once
+#include <Optimizer.h>
+#include <Sample.h>
+#include <Allreduce.h>
+#include <vector>
+
+class LogisticLoss : public Objective
+{
+public:
+	/*
+	Constructor:
+	std::vector<Sample*>& samples: training set.
+	float* sampleWeights: weight of each sample.
+	int classIndex: positive class index, every other class is negative.
+	double l2Regularization: weight of the L2 penalty.
+	int n: number of attributes of a sample, the samples may be an empty shard.
+	*/
+	LogisticLoss(std::vector<Sample*>& samples, float* sampleWeights, int classIndex, double l2Regularization, int n);
+	virtual ~LogisticLoss();
+
+	virtual int size();
+	virtual double evaluate(double* x, double* gradient);
+	virtual void acceptPoint();
+	virtual void hessianVector(double* v, double* hv);
+
+	/*
+	Returns true if a sum over the workers failed. The optimizers then stop.
+	*/
+	virtual bool failed();
+
+	/*
+	Sums the loss, the gradient and the hessian products of the samples over the workers of 'allreduce',
+	each holding a shard of the training set, so that every worker minimizes the loss of the whole
+	training set along the same path. If a worker fails, the objective fails, the loss of the local
+	shard is never minimized instead.
+	*/
+	void setAllreduce(Allreduce* allreduce);
+
+	/*
+	Returns the number of passes over the training set.
+	*/
+	int numDataPasses();
+
+private:
+	std::vector<Sample*>& _samples;
+	float* _sampleWeights;
+	int _classIndex;
+	double _l2Regularization;
+	int _n;	//number of attributes in a sample.
+	double _weightSum;
+
+	double* _curvature;	//per sample hessian weight si * p * (1 - p) at the current point.
+	double* _trialCurvature;	//per sample hessian weight at the last evaluated point.
+
+	int _numDataPasses;
+	Allreduce* _allreduce;
+	bool _failed;	//true if a sum over the workers failed.
+};
\ No newline at end of file
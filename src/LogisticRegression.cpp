@@ -1,164 +1,900 @@
-#include <LogisticRegression.h>
-#include <Accumulator.h>
-
-LogisticRegression::LogisticRegression() : WeakLearner()
-{
-	_w = nullptr;
-	_b = 0.0f;
-}
-
-LogisticRegression::~LogisticRegression()
-{
-	delete[] _w;
-}
-
-float LogisticRegression::label(Sample* x)
-{
-	//ensure the label is between [-1,1].
-	return 2.0f * sigmoid(x) - 1.0f;
-}
-
-void LogisticRegression::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
-{
-	if (samples.size() <= 0)
-		return;
-	
-	int numSamples = samples.size();
-	int vectorSize = samples[0]->n();
-	float batchSize = (float)numSamples;
-
-	//create the weight and bias buffers.
-	if (_w != nullptr)
-		delete[] _w;
-	_w = new float[vectorSize];
-	for (int i = 0; i < vectorSize; i++)
-		_w[i] = 0.0f;
-	_b = 0.0f;
-	_sampleSize = vectorSize;
-
-	//create the weight and bias buffers.
-	Accumulator* weight = new Accumulator[vectorSize];
-	Accumulator bias;
-
-	//create the gradient buffers.
-	Accumulator* weightGradient = new Accumulator[vectorSize];
-	Accumulator biasGradient;
-
-	//create the weight root mean squared buffers.
-	Accumulator* weightRms = new Accumulator[vectorSize];
-	Accumulator biasRms;
-
-	float averageGradient = 0.0f;
-	for (int iter = 0; iter < MAX_EPOCHS; iter++)
-	{
-		Accumulator cost;
-		for (int i = 0; i < vectorSize; i++)
-		{
-			weightGradient[i].clear();
-			weightRms[i].clear();
-		}
-		biasGradient.clear();
-		biasRms.clear();
-
-		Accumulator weightSum;
-		Accumulator dSum;
-
-		for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++)
-		{
-			Sample* sample = samples[sampleIndex];
-			float sig = sigmoid(sample);
-			float y = sigmoidLabel(sample->y(), classIndex);
-
-			//compute the cross entropy loss.
-			cost += -(y * log(sig + 1e-9f) + (1.0f - y) * log(1.0f - sig + 1e-9f));
-			weightSum += sampleWeights[sampleIndex];
-
-			//compute and accumulate the weight gradient of the sample.
-			for (int i = 0; i < vectorSize; i++)
-			{
-				float d = sampleWeights[sampleIndex] * (sig - y) * sample->x(i);
-				dSum += fabs(d);
-				weightGradient[i] += d;
-			}
-			//copmute and accumulate the bias gradient of the sample.
-			float d = sampleWeights[sampleIndex] * (sig - y);
-			biasGradient += d;
-			dSum += fabs(d);
-		}
-
-		dSum = dSum.sum() / (weightSum.sum() * (float)(vectorSize + 1));
-
-		//normalize the gradient.
-		for (int j = 0; j < vectorSize; j++)
-			weightGradient[j] = weightGradient[j].sum() / weightSum.sum();
-		biasGradient = biasGradient.sum() / weightSum.sum();
-
-		//get the running gradient mean square.
-		for (int j = 0; j < vectorSize; j++)
-			weightRms[j] = RUNNING_AVERAGE_WEIGHT * weightRms[j].sum() + (1.0f - RUNNING_AVERAGE_WEIGHT) * pow(weightGradient[j].sum(), 2.0f);	
-		biasRms = RUNNING_AVERAGE_WEIGHT * biasRms.sum() + (1.0f - RUNNING_AVERAGE_WEIGHT) * pow(biasGradient.sum(), 2.0f);
-
-		//update the weights and bias with the adaptive learning rate
-		for (int j = 0; j < vectorSize; j++)
-		{
-			float scale = 1.0f / (sqrt(weightRms[j].sum()) + 1e-5f);
-			weight[j] -= LEARNING_RATE * weightGradient[j].sum() / (sqrt(weightRms[j].sum()) + 1e-5f);
-			_w[j] = weight[j].sum();
-		}
-		bias -= LEARNING_RATE * biasGradient.sum() / (sqrt(biasRms.sum()) + 1e-5f);
-		_b = bias.sum();
-
-		//if the gradient is small enough, the loss is at an optimal value.
-		if (dSum.sum() < GRADIENT_THRESH)
-			break;
-	}
-
-	delete[] weightRms;
-	delete[] weightGradient;
-	delete[] weight;
-}
-
-void LogisticRegression::exportInternal(std::string& params)
-{
-	params += std::to_string(_sampleSize) + WEAK_LEARNER_DELIM;
-
-	for (int i = 0; i < _sampleSize; i++)
-		params += std::to_string(_w[i]) + WEAK_LEARNER_DELIM;
-	
-	params += std::to_string(_b) + WEAK_LEARNER_DELIM;
-}
-void LogisticRegression::importInternal(std::string& params)
-{
-	_sampleSize = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-
-	_w = new float[_sampleSize];
-	for (int i = 0; i < _sampleSize; i++)
-	{
-		_w[i] = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-	}
-	_b = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
-}
-
-float LogisticRegression::sigmoid(Sample* s)
-{
-	float z = 0.0f;
-	for (int i = 0; i < s->n(); i++)
-	{
-		z += s->x(i) * _w[i];
-	}
-	z += _b;
-	return (1.0f / (1.0f + exp(-z)));
-}
-
-void LogisticRegression::clearBuffer(float* buffer, int numSamples)
-{
-	for (int i = 0; i < numSamples; i++)
-		buffer[i] = 0.0f;
-}
-
-float LogisticRegression::sigmoidLabel(int class0, int class1)
-{
-	if (class0 == class1)
-		return 1.0f;
-	return 0.0f;
+#include <LogisticRegression.h>
+#include <LogisticLoss.h>
+#include <Accumulator.h>
+#include <FastMath.h>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <random>
+
+/*
+Access to the parameters of a model shared by the Hogwild threads. The loads and stores are
+relaxed: concurrent updates may overwrite each other, which the solver tolerates.
+*/
+static inline float loadWeight(float& w)
+{
+	return w;
+}
+static inline float loadWeight(std::atomic<float>& w)
+{
+	return w.load(std::memory_order_relaxed);
+}
+static inline void storeWeight(float& w, float value)
+{
+	w = value;
+}
+static inline void storeWeight(std::atomic<float>& w, float value)
+{
+	w.store(value, std::memory_order_relaxed);
+}
+
+/*
+Applies a gradient step computed on a mini batch to 'model', which holds n weights followed by the bias.
+Zero attributes are skipped, and only the parameters with a non zero gradient are written, so threads
+training on sparse samples rarely write the same parameters.
+Returns the mean absolute gradient of the mini batch.
+*/
+template <class Weight>
+static float sparseGradientStep(Weight* model, int n, float** x, float* y, float* weights, int count, float learningRate, float* gradient, bool fastMath)
+{
+	for (int j = 0; j <= n; j++)
+		gradient[j] = 0.0f;
+
+	float weightSum = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		float z = loadWeight(model[n]);
+		for (int j = 0; j < n; j++)
+		{
+			if (x[i][j] != 0.0f)
+				z += x[i][j] * loadWeight(model[j]);
+		}
+		float sig = fastMath ? fastSigmoid(z) : 1.0f / (1.0f + exp(-z));
+
+		float d = weights[i] * (sig - y[i]);
+		for (int j = 0; j < n; j++)
+		{
+			if (x[i][j] != 0.0f)
+				gradient[j] += d * x[i][j];
+		}
+		gradient[n] += d;
+		weightSum += weights[i];
+	}
+
+	if (weightSum <= 0.0f)
+		return 0.0f;
+
+	float gradientSum = 0.0f;
+	for (int j = 0; j <= n; j++)
+	{
+		if (gradient[j] == 0.0f)
+			continue;
+
+		float g = gradient[j] / weightSum;
+		storeWeight(model[j], loadWeight(model[j]) - learningRate * g);
+		gradientSum += fabs(g);
+	}
+	return gradientSum / (float)(n + 1);
+}
+
+LogisticRegression::LogisticRegression() : WeakLearner()
+{
+	_w = nullptr;
+	_b = 0.0f;
+	_sampleSize = 0;
+	_warmStarted = false;
+	_seed = 0;
+	_solver = RMSPROP;
+
+	_batchSize = BATCH_SIZE;
+	_schedule = INVERSE_SCALING;
+	_learningRate = LEARNING_RATE;
+	_learningRateDecay = LEARNING_RATE_DECAY;
+
+	_numThreads = 0;
+	_parameterMixing = false;
+	_allreduce = nullptr;
+	_failed = false;
+}
+
+LogisticRegression::LogisticRegression(Solver solver) : LogisticRegression()
+{
+	_solver = solver;
+}
+
+LogisticRegression::~LogisticRegression()
+{
+	releaseWeights();
+}
+
+float LogisticRegression::label(Sample* x)
+{
+	//ensure the label is between [-1,1].
+	return 2.0f * sigmoid(x) - 1.0f;
+}
+
+void LogisticRegression::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	_failed = false;
+	int vectorSize = (samples.size() > 0) ? samples[0]->n() : 0;
+
+	//a worker with an empty shard still takes part in the sums of a distributed training.
+	if (_allreduce != nullptr && (_solver == LBFGS || _solver == TRUST_REGION_NEWTON))
+	{
+		if (!shardVectorSize(vectorSize))
+		{
+			_failed = true;
+			return;
+		}
+	}
+	if (vectorSize <= 0)
+		return;
+	
+	initWeights(vectorSize);
+
+	if (_solver == RMSPROP)
+		trainRmsProp(samples, sampleWeights, classIndex);
+	else if (_solver == MINI_BATCH_SGD)
+		trainMiniBatch(samples, sampleWeights, classIndex);
+	else if (_solver == HOGWILD_SGD)
+		trainHogwild(samples, sampleWeights, classIndex);
+	else
+		trainSecondOrder(samples, sampleWeights, classIndex);
+}
+
+WeakLearner* LogisticRegression::create()
+{
+	LogisticRegression* logisticRegression = new LogisticRegression(_solver);
+	logisticRegression->setMiniBatch(_batchSize, _schedule, _learningRate, _learningRateDecay);
+	logisticRegression->setThreads(_numThreads, _parameterMixing);
+	logisticRegression->setFastMath(_fastMath);
+	return logisticRegression;
+}
+
+void LogisticRegression::setSolver(Solver solver)
+{
+	_solver = solver;
+}
+
+void LogisticRegression::setMiniBatch(int batchSize, LearningRateSchedule schedule, float learningRate, float decay)
+{
+	_batchSize = batchSize;
+	_schedule = schedule;
+	_learningRate = learningRate;
+	_learningRateDecay = decay;
+}
+
+void LogisticRegression::setThreads(int numThreads, bool parameterMixing)
+{
+	_numThreads = numThreads;
+	_parameterMixing = parameterMixing;
+}
+
+void LogisticRegression::setAllreduce(Allreduce* allreduce)
+{
+	_allreduce = allreduce;
+}
+
+bool LogisticRegression::failed()
+{
+	return _failed;
+}
+
+/*
+Replaces the vector size of the local shard, 0 if it is empty, by the vector size of the shards of
+every worker. Returns false if a worker failed, or the shards have different vector sizes.
+*/
+bool LogisticRegression::shardVectorSize(int& vectorSize)
+{
+	std::vector<std::string> gathered;
+	if (!_allreduce->allgather(std::to_string(vectorSize), gathered))
+		return false;
+
+	vectorSize = 0;
+	for (int r = 0; r < gathered.size(); r++)
+	{
+		int size = atoi(gathered[r].c_str());
+		if (size > 0 && vectorSize > 0 && size != vectorSize)
+			return false;
+		if (size > 0)
+			vectorSize = size;
+	}
+	return true;
+}
+
+/*
+Initializes the weights and bias to zero, unless the learner was warm started.
+*/
+void LogisticRegression::initWeights(int vectorSize)
+{
+	//create the weight and bias buffers. Keep the current weights if the learner was warm started.
+	if (!_warmStarted || _sampleSize != vectorSize || _w == nullptr)
+	{
+		releaseWeights();
+		_w = new float[vectorSize];
+		for (int i = 0; i < vectorSize; i++)
+			_w[i] = 0.0f;
+		_b = 0.0f;
+		_sampleSize = vectorSize;
+	}
+	_warmStarted = false;
+}
+
+/*
+Minimizes the loss with the RmsProp optimizer, starting from the current weights and bias.
+*/
+void LogisticRegression::trainRmsProp(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	int numSamples = samples.size();
+	int vectorSize = _sampleSize;
+
+	//create the weight and bias buffers.
+	Accumulator* weight = new Accumulator[vectorSize];
+	Accumulator bias;
+	for (int i = 0; i < vectorSize; i++)
+		weight[i] = _w[i];
+	bias = _b;
+
+	//create the gradient buffers.
+	AccumulatorArray weightGradient(vectorSize);
+	Accumulator biasGradient;
+	float* gradient = new float[vectorSize];
+
+	//create the weight root mean squared buffers.
+	Accumulator* weightRms = new Accumulator[vectorSize];
+	Accumulator biasRms;
+
+	//the absolute attribute sum of each sample, used for the mean absolute gradient.
+	float* absoluteSums = new float[numSamples];
+	float* absoluteValues = new float[vectorSize];
+	for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++)
+	{
+		Sample* sample = samples[sampleIndex];
+		for (int i = 0; i < vectorSize; i++)
+			absoluteValues[i] = fabs(sample->x(i));
+
+		Accumulator absoluteSum;
+		absoluteSum.add(absoluteValues, vectorSize);
+		absoluteSums[sampleIndex] = absoluteSum.sum();
+	}
+
+	_numIterations = 0;
+	for (int iter = 0; iter < MAX_EPOCHS; iter++)
+	{
+		_numIterations++;
+		Accumulator cost;
+		weightGradient.clear();
+		for (int i = 0; i < vectorSize; i++)
+			weightRms[i].clear();
+		biasGradient.clear();
+		biasRms.clear();
+
+		Accumulator weightSum;
+		Accumulator dSum;
+
+		for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++)
+		{
+			Sample* sample = samples[sampleIndex];
+			float sig = sigmoid(sample);
+			float y = sigmoidLabel(sample->y(), classIndex);
+
+			//compute the cross entropy loss.
+			if (_fastMath)
+				cost += -(y * fastLog(sig + 1e-9f) + (1.0f - y) * fastLog(1.0f - sig + 1e-9f));
+			else
+				cost += -(y * log(sig + 1e-9f) + (1.0f - y) * log(1.0f - sig + 1e-9f));
+			weightSum += sampleWeights[sampleIndex];
+
+			//compute and accumulate the weight gradient of the sample, d * x.
+			float d = sampleWeights[sampleIndex] * (sig - y);
+			weightGradient.add(d, sample->data());
+			dSum += fabs(d) * absoluteSums[sampleIndex];
+
+			//copmute and accumulate the bias gradient of the sample.
+			biasGradient += d;
+			dSum += fabs(d);
+		}
+
+		dSum = dSum.sum() / (weightSum.sum() * (float)(vectorSize + 1));
+
+		//normalize the gradient.
+		for (int j = 0; j < vectorSize; j++)
+			gradient[j] = weightGradient.sum(j) / weightSum.sum();
+		biasGradient = biasGradient.sum() / weightSum.sum();
+
+		//get the running gradient mean square.
+		for (int j = 0; j < vectorSize; j++)
+			weightRms[j] = RUNNING_AVERAGE_WEIGHT * weightRms[j].sum() + (1.0f - RUNNING_AVERAGE_WEIGHT) * pow(gradient[j], 2.0f);	
+		biasRms = RUNNING_AVERAGE_WEIGHT * biasRms.sum() + (1.0f - RUNNING_AVERAGE_WEIGHT) * pow(biasGradient.sum(), 2.0f);
+
+		//update the weights and bias with the adaptive learning rate
+		for (int j = 0; j < vectorSize; j++)
+		{
+			weight[j] -= LEARNING_RATE * gradient[j] / (sqrt(weightRms[j].sum()) + 1e-5f);
+			_w[j] = weight[j].sum();
+		}
+		bias -= LEARNING_RATE * biasGradient.sum() / (sqrt(biasRms.sum()) + 1e-5f);
+		_b = bias.sum();
+
+		//if the gradient is small enough, the loss is at an optimal value.
+		if (dSum.sum() < GRADIENT_THRESH)
+			break;
+	}
+
+	delete[] absoluteValues;
+	delete[] absoluteSums;
+	delete[] weightRms;
+	delete[] gradient;
+	delete[] weight;
+}
+
+/*
+Minimizes the loss with a second order solver, starting from the current weights and bias.
+*/
+void LogisticRegression::trainSecondOrder(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	LogisticLoss loss(samples, sampleWeights, classIndex, L2_REGULARIZATION, _sampleSize);
+	loss.setAllreduce(_allreduce);
+
+	double* x = new double[_sampleSize + 1];
+	for (int i = 0; i < _sampleSize; i++)
+		x[i] = _w[i];
+	x[_sampleSize] = _b;
+
+	if (_solver == LBFGS)
+	{
+		LbfgsOptimizer optimizer;
+		optimizer.minimize(loss, x);
+	}
+	else
+	{
+		TrustRegionNewtonOptimizer optimizer;
+		optimizer.minimize(loss, x);
+	}
+	_numIterations = loss.numDataPasses();
+
+	//if a worker failed, the weights are not those of the whole training set.
+	_failed = loss.failed();
+	if (!_failed)
+	{
+		for (int i = 0; i < _sampleSize; i++)
+			_w[i] = x[i];
+		_b = x[_sampleSize];
+	}
+
+	delete[] x;
+}
+
+/*
+Minimizes the loss with mini batch stochastic gradient descent, starting from the current
+weights and bias. The samples are shuffled at the start of every epoch.
+*/
+void LogisticRegression::trainMiniBatch(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	int numSamples = samples.size();
+	int batchSize = (_batchSize > 0) ? _batchSize : 1;
+
+	int* order = new int[numSamples];
+	for (int i = 0; i < numSamples; i++)
+		order[i] = i;
+
+	float** x = new float*[batchSize];
+	float* y = new float[batchSize];
+	float* weights = new float[batchSize];
+	float* weightGradient = new float[_sampleSize];
+
+	std::minstd_rand random(_seed);
+	int step = 0;
+	_numIterations = 0;
+	for (int epoch = 0; epoch < MAX_EPOCHS; epoch++)
+	{
+		_numIterations++;
+
+		//shuffle the sample order.
+		for (int i = numSamples - 1; i > 0; i--)
+		{
+			int j = random() % (i + 1);
+			int tmp = order[i];
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+
+		Accumulator gradientSum;
+		int numBatches = 0;
+		for (int start = 0; start < numSamples; start += batchSize)
+		{
+			int count = 0;
+			for (int i = start; i < numSamples && count < batchSize; i++, count++)
+			{
+				Sample* sample = samples[order[i]];
+				x[count] = sample->data();
+				y[count] = sigmoidLabel(sample->y(), classIndex);
+				weights[count] = sampleWeights[order[i]];
+			}
+			gradientSum += miniBatchStep(x, y, weights, count, learningRate(step++, epoch), weightGradient);
+			numBatches++;
+		}
+
+		//if the gradient is small enough, the loss is at an optimal value.
+		if (gradientSum.sum() / (float)numBatches < GRADIENT_THRESH)
+			break;
+	}
+
+	delete[] weightGradient;
+	delete[] weights;
+	delete[] y;
+	delete[] x;
+	delete[] order;
+}
+
+/*
+Minimizes the loss with multithreaded mini batch stochastic gradient descent. The shuffled samples are
+split into one contiguous shard per thread. In Hogwild mode every thread updates the shared model without
+locking. With parameter mixing every thread updates its own copy of the model, and the copies are
+averaged, weighted by the sample weight of their shard, at the end of each epoch.
+*/
+void LogisticRegression::trainHogwild(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	int numSamples = samples.size();
+	int n = _sampleSize;
+	int batchSize = (_batchSize > 0) ? _batchSize : 1;
+
+	int numThreads = (_numThreads > 0) ? _numThreads : (int)std::thread::hardware_concurrency();
+	numThreads = std::max(1, std::min(numThreads, numSamples));
+
+	//the shared model, the weights followed by the bias.
+	std::atomic<float>* model = new std::atomic<float>[n + 1];
+	for (int j = 0; j < n; j++)
+		model[j] = _w[j];
+	model[n] = _b;
+
+	//the per thread models used with parameter mixing.
+	float* threadModels = _parameterMixing ? new float[numThreads * (n + 1)] : nullptr;
+	float* shardWeights = new float[numThreads];
+	float* threadGradientSums = new float[numThreads];
+	int* threadBatches = new int[numThreads];
+
+	int* order = new int[numSamples];
+	for (int i = 0; i < numSamples; i++)
+		order[i] = i;
+
+	std::minstd_rand random(_seed);
+	int step = 0;
+	_numIterations = 0;
+	for (int epoch = 0; epoch < MAX_EPOCHS; epoch++)
+	{
+		_numIterations++;
+
+		//shuffle the sample order.
+		for (int i = numSamples - 1; i > 0; i--)
+		{
+			int j = random() % (i + 1);
+			int tmp = order[i];
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+
+		auto worker = [&](int t)
+		{
+			int shardStart = (int)((long long)numSamples * t / numThreads);
+			int shardEnd = (int)((long long)numSamples * (t + 1) / numThreads);
+
+			float** x = new float*[batchSize];
+			float* y = new float[batchSize];
+			float* weights = new float[batchSize];
+			float* gradient = new float[n + 1];
+
+			float* threadModel = nullptr;
+			if (_parameterMixing)
+			{
+				threadModel = &threadModels[t * (n + 1)];
+				for (int j = 0; j <= n; j++)
+					threadModel[j] = model[j].load(std::memory_order_relaxed);
+			}
+
+			float gradientSum = 0.0f;
+			float shardWeight = 0.0f;
+			int batch = 0;
+			for (int start = shardStart; start < shardEnd; start += batchSize, batch++)
+			{
+				int count = 0;
+				for (int i = start; i < shardEnd && count < batchSize; i++, count++)
+				{
+					Sample* sample = samples[order[i]];
+					x[count] = sample->data();
+					y[count] = sigmoidLabel(sample->y(), classIndex);
+					weights[count] = sampleWeights[order[i]];
+					shardWeight += weights[count];
+				}
+
+				//the learning rate follows the schedule of a single thread processing the batches in turn.
+				float rate = learningRate(step + batch * numThreads + t, epoch);
+				if (threadModel != nullptr)
+					gradientSum += sparseGradientStep(threadModel, n, x, y, weights, count, rate, gradient, _fastMath);
+				else
+					gradientSum += sparseGradientStep(model, n, x, y, weights, count, rate, gradient, _fastMath);
+			}
+
+			threadGradientSums[t] = gradientSum;
+			threadBatches[t] = batch;
+			shardWeights[t] = shardWeight;
+
+			delete[] gradient;
+			delete[] weights;
+			delete[] y;
+			delete[] x;
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads; t++)
+			threads.push_back(std::thread(worker, t));
+		worker(0);
+		for (int t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		Accumulator gradientSum;
+		int numBatches = 0;
+		for (int t = 0; t < numThreads; t++)
+		{
+			gradientSum += threadGradientSums[t];
+			numBatches += threadBatches[t];
+		}
+		step += numBatches;
+
+		//average the thread models.
+		if (_parameterMixing)
+		{
+			Accumulator weightSum;
+			for (int t = 0; t < numThreads; t++)
+				weightSum += shardWeights[t];
+
+			for (int j = 0; j <= n; j++)
+			{
+				Accumulator mixed;
+				for (int t = 0; t < numThreads; t++)
+					mixed += shardWeights[t] * threadModels[t * (n + 1) + j];
+				model[j] = (weightSum.sum() > 0.0f) ? mixed.sum() / weightSum.sum() : model[j].load();
+			}
+		}
+
+		//if the gradient is small enough, the loss is at an optimal value.
+		if (gradientSum.sum() / (float)numBatches < GRADIENT_THRESH)
+			break;
+	}
+
+	for (int j = 0; j < n; j++)
+		_w[j] = model[j];
+	_b = model[n];
+
+	delete[] order;
+	delete[] threadBatches;
+	delete[] threadGradientSums;
+	delete[] shardWeights;
+	delete[] threadModels;
+	delete[] model;
+}
+
+/*
+Trains with mini batch stochastic gradient descent over a stream of samples. Two chunk buffers are
+used: the next chunk is read asynchronously while the mini batches of the current chunk are processed.
+*/
+void LogisticRegression::trainStream(SampleReader& reader, int classIndex, int chunkSize)
+{
+	int vectorSize = reader.n();
+	if (vectorSize <= 0)
+		return;
+
+	initWeights(vectorSize);
+
+	int batchSize = (_batchSize > 0) ? _batchSize : 1;
+	float** x = new float*[batchSize];
+	float* y = new float[batchSize];
+	float* weights = new float[batchSize];
+	float* weightGradient = new float[_sampleSize];
+
+	SampleChunk chunks[2];
+
+	int step = 0;
+	_numIterations = 0;
+	for (int epoch = 0; epoch < MAX_EPOCHS; epoch++)
+	{
+		_numIterations++;
+		reader.rewind();
+
+		int current = 0;
+		reader.read(chunks[current], chunkSize);
+
+		Accumulator gradientSum;
+		int numBatches = 0;
+		while (chunks[current].size() > 0)
+		{
+			//read the next chunk while the current chunk is processed.
+			SampleChunk& next = chunks[1 - current];
+			std::future<int> nextRead = std::async(std::launch::async, [&reader, &next, chunkSize]() { return reader.read(next, chunkSize); });
+
+			SampleChunk& chunk = chunks[current];
+			for (int start = 0; start < chunk.size(); start += batchSize)
+			{
+				int count = 0;
+				for (int i = start; i < chunk.size() && count < batchSize; i++, count++)
+				{
+					x[count] = chunk.x(i);
+					y[count] = sigmoidLabel(chunk.y(i), classIndex);
+					weights[count] = chunk.weight(i);
+				}
+				gradientSum += miniBatchStep(x, y, weights, count, learningRate(step++, epoch), weightGradient);
+				numBatches++;
+			}
+
+			nextRead.wait();
+			current = 1 - current;
+		}
+
+		//if the gradient is small enough, the loss is at an optimal value.
+		if (numBatches == 0 || gradientSum.sum() / (float)numBatches < GRADIENT_THRESH)
+			break;
+	}
+
+	delete[] weightGradient;
+	delete[] weights;
+	delete[] y;
+	delete[] x;
+}
+
+/*
+Applies a gradient step computed on a mini batch of 'count' samples.
+Returns the mean absolute gradient of the mini batch.
+*/
+float LogisticRegression::miniBatchStep(float** x, float* y, float* weights, int count, float learningRate, float* weightGradient)
+{
+	clearBuffer(weightGradient, _sampleSize);
+	float biasGradient = 0.0f;
+	float weightSum = 0.0f;
+
+	for (int i = 0; i < count; i++)
+	{
+		float z = _b;
+		for (int j = 0; j < _sampleSize; j++)
+			z += x[i][j] * _w[j];
+		float sig = sigmoid(z);
+
+		float d = weights[i] * (sig - y[i]);
+		for (int j = 0; j < _sampleSize; j++)
+			weightGradient[j] += d * x[i][j];
+		biasGradient += d;
+		weightSum += weights[i];
+	}
+
+	if (weightSum <= 0.0f)
+		return 0.0f;
+
+	float gradientSum = 0.0f;
+	for (int j = 0; j < _sampleSize; j++)
+	{
+		float g = weightGradient[j] / weightSum;
+		_w[j] -= learningRate * g;
+		gradientSum += fabs(g);
+	}
+	float g = biasGradient / weightSum;
+	_b -= learningRate * g;
+	gradientSum += fabs(g);
+
+	return gradientSum / (float)(_sampleSize + 1);
+}
+
+/*
+Returns the learning rate of the mini batch solver.
+*/
+float LogisticRegression::learningRate(int step, int epoch)
+{
+	if (_schedule == INVERSE_SCALING)
+		return _learningRate / (1.0f + _learningRateDecay * (float)step);
+	if (_schedule == EXPONENTIAL)
+		return _learningRate * pow(1.0f - _learningRateDecay, (float)epoch);
+	return _learningRate;
+}
+
+/*
+Starts the next training call from the weights and bias of 'previous'.
+*/
+void LogisticRegression::warmStart(WeakLearner* previous)
+{
+	LogisticRegression* logisticRegression = dynamic_cast<LogisticRegression*>(previous);
+	if (logisticRegression == nullptr || logisticRegression->_w == nullptr)
+		return;
+
+	_sampleSize = logisticRegression->_sampleSize;
+	releaseWeights();
+	_w = new float[_sampleSize];
+	for (int i = 0; i < _sampleSize; i++)
+		_w[i] = logisticRegression->_w[i];
+	_b = logisticRegression->_b;
+	_warmStarted = true;
+}
+
+void LogisticRegression::setRandomSeed(unsigned int seed)
+{
+	_seed = seed;
+}
+
+void LogisticRegression::exportInternal(std::string& params)
+{
+	std::vector<float> buffer;
+	float* w = floatWeights(buffer);
+	params += std::to_string(_sampleSize) + WEAK_LEARNER_DELIM;
+
+	for (int i = 0; i < _sampleSize; i++)
+		params += std::to_string(w[i]) + WEAK_LEARNER_DELIM;
+	
+	params += std::to_string(_b) + WEAK_LEARNER_DELIM;
+}
+void LogisticRegression::importInternal(ParamReader& params)
+{
+	_sampleSize = params.nextInt(WEAK_LEARNER_DELIM);
+
+	releaseWeights();
+	_w = new float[_sampleSize];
+	for (int i = 0; i < _sampleSize; i++)
+	{
+		_w[i] = params.nextFloat(WEAK_LEARNER_DELIM);
+	}
+	_b = params.nextFloat(WEAK_LEARNER_DELIM);
+}
+
+//tag of the binary parameters.
+#define LOGISTIC_REGRESSION_BINARY_TAG 0x4752474c
+
+/*
+Binary parameters: uint32 tag, int32 n, float bias, uint32 reserved, float w[n] (aligned).
+*/
+void LogisticRegression::exportBinary(BinaryWriter& writer)
+{
+	std::vector<float> buffer;
+	writer.write((uint32_t)LOGISTIC_REGRESSION_BINARY_TAG);
+	writer.write((int32_t)_sampleSize);
+	writer.write(_b);
+	writer.write((uint32_t)0);
+	writer.writeArray(floatWeights(buffer), _sampleSize);
+}
+
+bool LogisticRegression::importBinary(BinaryReader& reader, int n)
+{
+	uint32_t tag;
+	int32_t size;
+	float b;
+	uint32_t reserved;
+	if (!reader.read(tag) || tag != LOGISTIC_REGRESSION_BINARY_TAG)
+		return false;
+	if (!reader.read(size) || !reader.read(b) || !reader.read(reserved) || size != n)
+		return false;
+
+	float* w = reader.readArray<float>(n);
+	if (w == nullptr)
+		return false;
+
+	releaseWeights();
+	_w = w;
+	_b = b;
+	_sampleSize = n;
+	_mappedParams = true;
+	return true;
+}
+
+void LogisticRegression::releaseWeights()
+{
+	if (!_mappedParams)
+		delete[] _w;
+	_w = nullptr;
+	_mappedParams = false;
+
+	delete _quantizedW;
+	_quantizedW = nullptr;
+}
+
+float* LogisticRegression::floatWeights(std::vector<float>& buffer)
+{
+	if (_quantizedW == nullptr)
+		return _w;
+
+	buffer.resize(_sampleSize);
+	_quantizedW->dequantize(buffer.data());
+	return buffer.data();
+}
+
+void LogisticRegression::quantize(QuantizationType type)
+{
+	//restore the float weights first.
+	if (_quantizedW != nullptr)
+	{
+		float* w = new float[_sampleSize];
+		_quantizedW->dequantize(w);
+		releaseWeights();
+		_w = w;
+	}
+	if (_w == nullptr || type == QUANTIZE_NONE)
+		return;
+
+	QuantizedArray* quantizedW = new QuantizedArray(_w, _sampleSize, type);
+	releaseWeights();
+	_quantizedW = quantizedW;
+}
+
+size_t LogisticRegression::parameterSize()
+{
+	size_t size = sizeof(_b);
+	if (_quantizedW != nullptr)
+		size += _quantizedW->sizeInBytes();
+	else if (_w != nullptr)
+		size += _sampleSize * sizeof(float);
+	return size;
+}
+
+float LogisticRegression::sigmoid(Sample* s)
+{
+	if (_quantizedW != nullptr)
+		return sigmoid(_quantizedW->dot(s->data()) + _b);
+
+	float z = 0.0f;
+	for (int i = 0; i < s->n(); i++)
+	{
+		z += s->x(i) * _w[i];
+	}
+	z += _b;
+	return sigmoid(z);
+}
+
+float LogisticRegression::sigmoid(float z)
+{
+	if (_fastMath)
+		return fastSigmoid(z);
+	return (1.0f / (1.0f + exp(-z)));
+}
+
+/*
+Computes the logistic inputs of every sample, then the sigmoids of all samples with a single
+vectorized sweep if fast math is enabled.
+*/
+void LogisticRegression::labelBatch(std::vector<Sample*>& samples, float* labels)
+{
+	int numSamples = samples.size();
+	for (int i = 0; i < numSamples; i++)
+	{
+		float* x = samples[i]->data();
+		if (_quantizedW != nullptr)
+		{
+			labels[i] = _quantizedW->dot(x) + _b;
+			continue;
+		}
+
+		float z = 0.0f;
+		for (int j = 0; j < _sampleSize; j++)
+			z += x[j] * _w[j];
+		labels[i] = z + _b;
+	}
+
+	if (_fastMath)
+		fastSigmoid(labels, labels, numSamples);
+	else
+	{
+		for (int i = 0; i < numSamples; i++)
+			labels[i] = 1.0f / (1.0f + exp(-labels[i]));
+	}
+
+	//ensure the label is between [-1,1].
+	for (int i = 0; i < numSamples; i++)
+		labels[i] = 2.0f * labels[i] - 1.0f;
+}
+
+void LogisticRegression::clearBuffer(float* buffer, int numSamples)
+{
+	for (int i = 0; i < numSamples; i++)
+		buffer[i] = 0.0f;
+}
+
+float LogisticRegression::sigmoidLabel(int class0, int class1)
+{
+	if (class0 == class1)
+		return 1.0f;
+	return 0.0f;
 }
\ No newline at end of file
@@ -1,54 +1,231 @@
-/*
-LogisticRegression.h
-trains a logistic regression classifier.
-Estimates the parameters of a logistic model.
-f = sigmoid(sum(wi * xi) + b)
-
-A gradient descent method is used with RmsProp optimizer.
-Where the loss function is the cross entropy.
-
-Greg Smith
-gregjksmith@gmail.com
-*/
-
-#pragma once
-#include <WeakLearner.h>
-#include <cmath>
-
-//base learning rate
-#define LEARNING_RATE 0.1f
-
-//maximum number of learning epochs
-#define MAX_EPOCHS 100
-
-//running average weight, used with the adaptive learning rate.
-#define RUNNING_AVERAGE_WEIGHT 0.9f
-
-//training optimum is considered if the absolute gradient is less
-//than this threshold.
-#define GRADIENT_THRESH 1e-3f
-
-class LogisticRegression : public WeakLearner
-{
-public:
-	LogisticRegression();
-	~LogisticRegression();
-
-	virtual float label(Sample* x);
-
-	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
-
-protected:
-	float sigmoid(Sample* s);
-	float sigmoidLabel(int class0, int class1);
-
-	virtual void exportInternal(std::string& params);
-	virtual void importInternal(std::string& params);
-
-private:
-	void clearBuffer(float* buffer, int numSamples);
-
-	float* _w = nullptr;	//logistic weights.
-	float _b;	//logistic bias.
-	int _sampleSize;
+/*
+LogisticRegression.h
+trains a logistic regression classifier.
+Estimates the parameters of a logistic model.
+f = sigmoid(sum(wi * xi) + b)
+
+A gradient descent method is used with RmsProp optimizer.
+Where the loss function is the cross entropy.
+Alternatively the loss can be minimized with L-BFGS or a trust region Newton method,
+which typically require far fewer passes over the training set.
+
+Greg Smith
+gregjksmith@gmail.com
+*/
+
+#pragma once
+#include <WeakLearner.h>
+#include <SampleStream.h>
+#include <Allreduce.h>
+#include <cmath>
+
+//base learning rate
+#define LEARNING_RATE 0.1f
+
+//maximum number of learning epochs
+#define MAX_EPOCHS 100
+
+//running average weight, used with the adaptive learning rate.
+#define RUNNING_AVERAGE_WEIGHT 0.9f
+
+//training optimum is considered if the absolute gradient is less
+//than this threshold.
+#define GRADIENT_THRESH 1e-3f
+
+//L2 regularization used by the second order solvers. Keeps the optimum finite
+//if the training set is separable.
+#define L2_REGULARIZATION 1e-4f
+
+//default number of samples in a mini batch.
+#define BATCH_SIZE 64
+
+//default decay of the mini batch learning rate schedules.
+#define LEARNING_RATE_DECAY 0.01f
+
+class LogisticRegression : public WeakLearner
+{
+public:
+	/*
+	Optimizer used to minimize the cross entropy loss.
+	RMSPROP: full batch gradient descent with RmsProp adaptive learning rates.
+	LBFGS: limited memory BFGS with a Wolfe line search.
+	TRUST_REGION_NEWTON: trust region Newton method with conjugate gradient steps.
+	MINI_BATCH_SGD: stochastic gradient descent over shuffled mini batches.
+	HOGWILD_SGD: multithreaded mini batch SGD. Every thread processes a disjoint shard of the
+		samples, and updates a shared weight vector without locking (Hogwild).
+	*/
+	enum Solver
+	{
+		RMSPROP,
+		LBFGS,
+		TRUST_REGION_NEWTON,
+		MINI_BATCH_SGD,
+		HOGWILD_SGD
+	};
+
+	/*
+	Learning rate of the mini batch solver after t mini batch steps, or after e epochs.
+	CONSTANT: rate.
+	INVERSE_SCALING: rate / (1 + decay * t).
+	EXPONENTIAL: rate * (1 - decay)^e.
+	*/
+	enum LearningRateSchedule
+	{
+		CONSTANT,
+		INVERSE_SCALING,
+		EXPONENTIAL
+	};
+
+	LogisticRegression();
+	LogisticRegression(Solver solver);
+	~LogisticRegression();
+
+	virtual float label(Sample* x);
+	virtual void labelBatch(std::vector<Sample*>& samples, float* labels);
+
+	virtual void exportBinary(BinaryWriter& writer);
+	virtual bool importBinary(BinaryReader& reader, int n);
+
+	virtual void quantize(QuantizationType type);
+	virtual size_t parameterSize();
+
+	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+	virtual WeakLearner* create();
+
+	/*
+	Starts the next training call from the weights and bias of 'previous'.
+	*/
+	virtual void warmStart(WeakLearner* previous);
+
+	/*
+	Seeds the sample shuffles of the stochastic solvers.
+	*/
+	virtual void setRandomSeed(unsigned int seed);
+
+	/*
+	Sets the optimizer used by train. For LogisticRegression, numIterations returns the number
+	of passes over the training set made by the optimizer.
+	*/
+	void setSolver(Solver solver);
+
+	/*
+	Sets the mini batch size and the learning rate schedule of the MINI_BATCH_SGD solver.
+	*/
+	void setMiniBatch(int batchSize, LearningRateSchedule schedule, float learningRate = LEARNING_RATE, float decay = LEARNING_RATE_DECAY);
+
+	/*
+	Sets the threads used by the HOGWILD_SGD solver. A numThreads of 0 uses every hardware thread.
+	If parameterMixing is true, every thread trains its own copy of the model during an epoch, and
+	the copies are averaged at the end of the epoch. The result is then deterministic, independent
+	of the thread scheduling.
+	*/
+	void setThreads(int numThreads, bool parameterMixing = false);
+
+	/*
+	Trains with mini batch stochastic gradient descent over a stream of samples, such as a sample
+	file too large to be held in memory. The samples are read in chunks of 'chunkSize' samples, and
+	the next chunk is read while the current one is processed. The sample weights are read from the
+	stream. Makes up to MAX_EPOCHS passes over the stream.
+	*/
+	void trainStream(SampleReader& reader, int classIndex, int chunkSize = SAMPLE_CHUNK_SIZE);
+
+	/*
+	Trains on the shard of the worker of 'allreduce'. The loss and the gradients of the LBFGS and
+	TRUST_REGION_NEWTON solvers are summed over the workers, so every worker trains the model of the
+	whole training set, including a worker whose shard is empty. The other solvers train on the shard
+	alone. The allreduce is not copied by create.
+	*/
+	void setAllreduce(Allreduce* allreduce);
+
+	/*
+	Returns true if the last call to train failed because a worker of the allreduce failed. The weights
+	are then left unchanged, the learner does not fall back to the model of its shard.
+	*/
+	bool failed();
+
+protected:
+	float sigmoid(Sample* s);
+	float sigmoid(float z);
+	float sigmoidLabel(int class0, int class1);
+
+	virtual void exportInternal(std::string& params);
+	virtual void importInternal(ParamReader& params);
+
+private:
+	void clearBuffer(float* buffer, int numSamples);
+
+	/*
+	Minimizes the loss with the RmsProp optimizer, starting from the current weights and bias.
+	*/
+	void trainRmsProp(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Minimizes the loss with a second order solver, starting from the current weights and bias.
+	*/
+	void trainSecondOrder(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Minimizes the loss with mini batch stochastic gradient descent, starting from the current
+	weights and bias.
+	*/
+	void trainMiniBatch(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Minimizes the loss with multithreaded mini batch stochastic gradient descent, starting from the
+	current weights and bias.
+	*/
+	void trainHogwild(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Applies a gradient step computed on a mini batch of 'count' samples.
+	float** x: sample attributes. float* y: sigmoid labels (0 or 1). float* weights: sample weights.
+	float* weightGradient: buffer of _sampleSize gradients.
+	Returns the mean absolute gradient of the mini batch.
+	*/
+	float miniBatchStep(float** x, float* y, float* weights, int count, float learningRate, float* weightGradient);
+
+	/*
+	Returns the learning rate of the mini batch solver.
+	*/
+	float learningRate(int step, int epoch);
+
+	/*
+	Initializes the weights and bias to zero, unless the learner was warm started.
+	*/
+	void initWeights(int vectorSize);
+
+	/*
+	Replaces the vector size of the local shard, 0 if it is empty, by the vector size of the shards of
+	every worker. Returns false if a worker failed, or the shards have different vector sizes.
+	*/
+	bool shardVectorSize(int& vectorSize);
+
+	/*
+	Releases the weights, unless they reference a binary model.
+	*/
+	void releaseWeights();
+
+	/*
+	Returns the weights, dequantized into 'buffer' if the weights are quantized.
+	*/
+	float* floatWeights(std::vector<float>& buffer);
+
+	float* _w = nullptr;	//logistic weights.
+	QuantizedArray* _quantizedW = nullptr;	//quantized weights, replacing _w.
+	float _b;	//logistic bias.
+	int _sampleSize;
+	bool _warmStarted;	//true if _w and _b hold the initial solution of the next training call.
+	unsigned int _seed;	//seed of the sample shuffles.
+	Solver _solver;
+
+	int _batchSize;	//mini batch solver settings.
+	LearningRateSchedule _schedule;
+	float _learningRate;
+	float _learningRateDecay;
+
+	int _numThreads;	//parallel solver settings.
+	bool _parameterMixing;
+
+	Allreduce* _allreduce;	//workers of a distributed training, nullptr else.
+	bool _failed;	//true if the last distributed training failed.
 };
\ No newline at end of file
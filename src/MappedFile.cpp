@@ -0,0 +1,90 @@
+#include <MappedFile.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+MappedFile::MappedFile(const std::string& path)
+{
+	_data = nullptr;
+	_size = 0;
+	_mapping = nullptr;
+
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+		return;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+		return;
+
+	_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_data != nullptr)
+		_size = (size_t)size.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data != nullptr)
+		UnmapViewOfFile(_data);
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+}
+
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path)
+{
+	_data = nullptr;
+	_size = 0;
+
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0);
+		if (data != MAP_FAILED)
+		{
+			_data = (const char*)data;
+			_size = (size_t)status.st_size;
+		}
+	}
+
+	//the mapping stays valid after the file is closed.
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data != nullptr)
+		munmap((void*)_data, _size);
+}
+
+#endif
+
+bool MappedFile::isOpen()
+{
+	return _data != nullptr;
+}
+
+const char* MappedFile::data()
+{
+	return _data;
+}
+
+size_t MappedFile::size()
+{
+	return _size;
+}
\ No newline at end of file
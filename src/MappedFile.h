@@ -0,0 +1,38 @@
+/*
+MappedFile.h
+Read only memory mapping of a file. The pages of the file are loaded on first access, so
+opening a large file is fast, and the mapping is shared between processes mapping the same file.
+*/
+
+#pragma once
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	/*
+	Returns true if the file is mapped.
+	*/
+	bool isOpen();
+
+	/*
+	Returns the start of the mapping, aligned to the page size, and its size in bytes.
+	*/
+	const char* data();
+	size_t size();
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* _data;
+	size_t _size;
+
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <MultinomialLogisticRegression.h>
+#include <SoftmaxLoss.h>
+#include <Optimizer.h>
+#include <ExportStringUtils.h>
+#include <cmath>
+
+MultinomialLogisticRegression::MultinomialLogisticRegression()
+{
+	_w = nullptr;
+	_n = 0;
+	_k = 0;
+	_numDataPasses = 0;
+}
+
+MultinomialLogisticRegression::MultinomialLogisticRegression(std::vector<Sample*>& samples, float* sampleWeights)
+{
+	_w = nullptr;
+	_n = 0;
+	_k = 0;
+	_numDataPasses = 0;
+	train(samples, sampleWeights);
+}
+
+MultinomialLogisticRegression::~MultinomialLogisticRegression()
+{
+	delete[] _w;
+}
+
+void MultinomialLogisticRegression::train(std::vector<Sample*>& samples, float* sampleWeights)
+{
+	if (samples.size() <= 0)
+		return;
+
+	_n = samples[0]->n();
+
+	//compute the number of unique classes in the sample set.
+	int maxClassIndex = 0;
+	for (int i = 0; i < samples.size(); i++)
+		maxClassIndex = fmax(maxClassIndex, samples[i]->y());
+	_k = maxClassIndex + 1;
+
+	SoftmaxLoss loss(samples, sampleWeights, _k, L2_REGULARIZATION);
+	int size = loss.size();
+
+	double* x = new double[size];
+	for (int j = 0; j < size; j++)
+		x[j] = 0.0;
+
+	LbfgsOptimizer optimizer;
+	optimizer.minimize(loss, x);
+	_numDataPasses = loss.numDataPasses();
+
+	delete[] _w;
+	_w = new float[size];
+	for (int j = 0; j < size; j++)
+		_w[j] = (float)x[j];
+
+	delete[] x;
+}
+
+float MultinomialLogisticRegression::error(std::vector<Sample*>& samples)
+{
+	int numNegativeSamples = 0;
+	for (int i = 0; i < samples.size(); i++)
+	{
+		float confidence;
+		int n = label(samples[i], confidence);
+		if (n != samples[i]->y())
+			numNegativeSamples++;
+	}
+	return (float)numNegativeSamples / (float)samples.size();
+}
+
+int MultinomialLogisticRegression::label(Sample* x, float& confidence)
+{
+	float* z = new float[_k];
+	margins(x, z);
+
+	int maxClassIndex = 0;
+	for (int c = 1; c < _k; c++)
+	{
+		if (z[c] > z[maxClassIndex])
+			maxClassIndex = c;
+	}
+
+	//softmax probability of the most likely class, shifted by the max margin for stability.
+	float expSum = 0.0f;
+	for (int c = 0; c < _k; c++)
+		expSum += exp(z[c] - z[maxClassIndex]);
+	confidence = 1.0f / expSum;
+
+	delete[] z;
+	return maxClassIndex;
+}
+
+void MultinomialLogisticRegression::margins(Sample* x, float* margins)
+{
+	int m = _n + 1;
+	for (int c = 0; c < _k; c++)
+	{
+		float* wc = &_w[c * m];
+		float z = wc[_n];
+		for (int j = 0; j < _n; j++)
+			z += x->x(j) * wc[j];
+		margins[c] = z;
+	}
+}
+
+int MultinomialLogisticRegression::numClasses()
+{
+	return _k;
+}
+
+int MultinomialLogisticRegression::numDataPasses()
+{
+	return _numDataPasses;
+}
+
+std::string MultinomialLogisticRegression::exportParams()
+{
+	//a single weak learner with a unit ensemble weight per class.
+	std::string params;
+	params += std::to_string(1) + ENSEMBLE_DELIM;
+	params += std::to_string(_n) + ENSEMBLE_DELIM;
+	params += std::to_string(_k) + ENSEMBLE_DELIM;
+
+	int m = _n + 1;
+	for (int c = 0; c < _k; c++)
+	{
+		params += std::to_string(1.0f) + ENSEMBLE_DELIM;
+
+		//LogisticRegression parameters: n, the weights, the bias.
+		params += std::to_string(_n) + WEAK_LEARNER_DELIM;
+		for (int j = 0; j < _n; j++)
+			params += std::to_string(_w[c * m + j]) + WEAK_LEARNER_DELIM;
+		params += std::to_string(_w[c * m + _n]) + WEAK_LEARNER_DELIM;
+		params += ENSEMBLE_DELIM;
+	}
+	return params;
+}
+
+void MultinomialLogisticRegression::importParams(std::string& params)
+{
+	ParamReader reader(params);
+	int numWeakLearners = reader.nextInt(ENSEMBLE_DELIM);
+	_n = reader.nextInt(ENSEMBLE_DELIM);
+	_k = reader.nextInt(ENSEMBLE_DELIM);
+
+	int m = _n + 1;
+	delete[] _w;
+	_w = new float[_k * m];
+
+	for (int c = 0; c < _k; c++)
+	{
+		for (int wl = 0; wl < numWeakLearners; wl++)
+		{
+			reader.next(ENSEMBLE_DELIM);
+			ParamReader weakLearnerParams = reader.nextReader(ENSEMBLE_DELIM);
+			if (wl > 0)
+				continue;
+
+			weakLearnerParams.next(WEAK_LEARNER_DELIM);
+			for (int j = 0; j <= _n; j++)
+				_w[c * m + j] = weakLearnerParams.nextFloat(WEAK_LEARNER_DELIM);
+		}
+	}
+	params.erase(0, reader.position());
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+/*
+MultinomialLogisticRegression.h
+trains a multinomial logistic regression (softmax) classifier over k classes.
+p(c | x) = exp(zc) / sum(exp(zj)), zc = sum(wci * xi) + bc
+
+Unlike AdaBoost<LogisticRegression>, which trains a separate one against many model per class,
+the cross entropy loss of all classes is minimized jointly with L-BFGS. Every pass over the
+training set computes the gradient of every class, so training takes about k times fewer passes.
+
+The model exports to the AdaBoost<LogisticRegression> format, with a single weak learner per
+class holding the class weights. Since the per class margins of the imported model are monotonic
+in zc, it predicts the same labels.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include <Sample.h>
+#include <LogisticRegression.h>
+
+class MultinomialLogisticRegression
+{
+public:
+	MultinomialLogisticRegression();
+
+	/*
+	Constructor:
+	std::vector<Sample*>& samples: training set. The label can be any non-negative integer.
+	float* sampleWeights: weight of each sample, nullptr for uniform weights.
+	*/
+	MultinomialLogisticRegression(std::vector<Sample*>& samples, float* sampleWeights = nullptr);
+	~MultinomialLogisticRegression();
+
+	void train(std::vector<Sample*>& samples, float* sampleWeights = nullptr);
+
+	/*
+	Computes the classification error of a data set.
+	*/
+	float error(std::vector<Sample*>& samples);
+
+	/*
+	Returns the most likely label for a sample given the learned parameters.
+	Sample* x: input sample.
+	float& confidence: probability of the label is stored here.
+	*/
+	int label(Sample* x, float& confidence);
+
+	/*
+	Computes the margin zc of every class for the sample x, stored in 'margins' (k values).
+	*/
+	void margins(Sample* x, float* margins);
+
+	int numClasses();
+
+	/*
+	Returns the number of passes over the training set made by the last training call.
+	*/
+	int numDataPasses();
+
+	/*
+	Exports the model in the AdaBoost<LogisticRegression> format.
+	*/
+	std::string exportParams();
+
+	/*
+	Imports a model in the AdaBoost<LogisticRegression> format. The first weak learner of each
+	class provides the class weights.
+	*/
+	void importParams(std::string& params);
+
+private:
+	float* _w;	//class weights, k x (n + 1), each row followed by the class bias.
+	int _n;
+	int _k;
+	int _numDataPasses;
+};
\ No newline at end of file
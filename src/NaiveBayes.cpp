@@ -1,45 +1,97 @@
 #include <NaiveBayes.h>
 #include <cmath>
+#include <cstring>
+#include <climits>
 #include <vector>
-#include <Accumulator.h>
+#include <algorithm>
+#include <Simd.h>
+
+/*
+Computes the log probabilities of the positive and the negative class given a single attribute,
+from the log densities a and b of the attribute value. The probability of the positive class is
+exp(a) / max(exp(a) + exp(b), MIN_DENSITY), both probabilities are at least MIN_PROBABILITY.
+*/
+static inline void attributeLogProbabilities(double a, double b, double& logPositive, double& logNegative)
+{
+	//log(exp(a) + exp(b)).
+	double logDensity = fmax(a, b) + log1p(exp(-fabs(a - b)));
+	if (logDensity >= log(MIN_DENSITY))
+	{
+		logPositive = a - logDensity;
+		logNegative = b - logDensity;
+	}
+	else
+	{
+		logPositive = a - log(MIN_DENSITY);
+		logNegative = log1p(-exp(logPositive));
+	}
+
+	logPositive = fmax(logPositive, log(MIN_PROBABILITY));
+	logNegative = fmax(logNegative, log(MIN_PROBABILITY));
+}
 
 NaiveBayes::NaiveBayes() : WeakLearner()
 {
 	_n = 0;
 	_mean = nullptr;
 	_var = nullptr;
+	_statistics = nullptr;
+	_numMappedClasses = 0;
+	_mappedWeights = nullptr;
+	_mappedMean = nullptr;
+	_mappedM2 = nullptr;
+	_positiveCenter = nullptr;
+	_positiveScale = nullptr;
+	_negativeCenter = nullptr;
+	_negativeScale = nullptr;
+	for (int c = 0; c < 4; c++)
+		_quantizedCoefficients[c] = nullptr;
 }
 
 NaiveBayes::~NaiveBayes()
 {
-	delete[] _mean;
-	delete[] _var;
+	releaseParams();
+	delete _statistics;
 }
 
 float NaiveBayes::label(Sample* x)
 {
+	//with fast math, use the vectorized approximations of the batch kernel.
+	if (_fastMath)
+	{
+		float* data = x->data();
+		float l;
+		labelBatch(&data, 1, &l);
+		return l;
+	}
+
 	double positiveP = 0.0f;
 	double negativeP = 0.0f;
 
-	//add the log of the probabilities of each sample.
-	for (int i = 0; i < x->n(); i++)
+	//add the log of the probabilities of each sample, a block of attributes at a time.
+	float block[4][COEFFICIENT_BLOCK];
+	float* c[4];
+	for (int begin = 0; begin < _n; begin += COEFFICIENT_BLOCK)
 	{
-		float meanSamplePositive = _mean[i * 2 + 0];
-		float meanSampleNegative = _mean[i * 2 + 1];
-
-		float varSamplePositive = _var[i * 2 + 0];
-		float varSampleNegative = _var[i * 2 + 1];
-
-		double positive = exp(-pow(x->x(i) - meanSamplePositive, 2.0f) / (2.0f * varSamplePositive));
-		double negative = exp(-pow(x->x(i) - meanSampleNegative, 2.0f) / (2.0f * varSampleNegative));
+		int blockSize = std::min(COEFFICIENT_BLOCK, _n - begin);
+		blockCoefficients(begin, blockSize, block, c);
+		for (int i = 0; i < blockSize; i++)
+		{
+			float positive = x->x(begin + i) - c[0][i];
+			float negative = x->x(begin + i) - c[2][i];
 
-		positive /= fmax(positive + negative, 1e-9f);
-		negative = 1.0f - positive;
+			double logPositive, logNegative;
+			attributeLogProbabilities(c[1][i] * positive * positive, c[3][i] * negative * negative, logPositive, logNegative);
 
-		positiveP += log(fmax(positive,1e-12));
-		negativeP += log(fmax(negative, 1e-12));
+			positiveP += logPositive;
+			negativeP += logNegative;
+		}
 	}
+	return label(positiveP, negativeP);
+}
 
+float NaiveBayes::label(double positiveP, double negativeP)
+{
 	double pSum = positiveP + negativeP;
 	positiveP = 1.0f - positiveP / pSum;
 	negativeP = 1.0f - positiveP;
@@ -48,93 +100,550 @@ float NaiveBayes::label(Sample* x)
 	return l;
 }
 
-void NaiveBayes::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+void NaiveBayes::labelBatch(std::vector<Sample*>& samples, float* labels)
 {
-	_n = samples[0]->n();
-	_mean = new float[_n * 2];
-	_var = new float[_n * 2];
+	float** x = new float*[samples.size()];
+	for (int i = 0; i < samples.size(); i++)
+		x[i] = samples[i]->data();
 
-	//iterate through each attribute.
-	for (int j = 0; j < _n; j++)
+	labelBatch(x, samples.size(), labels);
+
+	delete[] x;
+}
+
+/*
+Scores SIMD_WIDTH samples at a time, one sample per vector lane. The log densities are computed
+with vector instructions. With fast math the log probabilities are computed in the vector lanes too,
+otherwise every lane is finished with the exact scalar computation of label(Sample*).
+*/
+void NaiveBayes::labelBatch(float** x, int count, float* labels)
+{
+	FloatVector logMinDensity = simdSet(log(MIN_DENSITY));
+	FloatVector logMinProbability = simdSet(log(MIN_PROBABILITY));
+	FloatVector one = simdSet(1.0f);
+	FloatVector zero = simdSet(0.0f);
+
+	float block[4][COEFFICIENT_BLOCK];
+	float* c[4];
+
+	float a[SIMD_WIDTH];
+	float b[SIMD_WIDTH];
+	for (int start = 0; start < count; start += SIMD_WIDTH)
 	{
-		Accumulator positiveMeanSum;
-		Accumulator negativeMeanSum;
+		//pad the last block with the first sample of the block.
+		int lanes = (count - start < SIMD_WIDTH) ? count - start : SIMD_WIDTH;
+		float* x0 = x[start];
+		float* x1 = x[start + ((lanes > 1) ? 1 : 0)];
+		float* x2 = x[start + ((lanes > 2) ? 2 : 0)];
+		float* x3 = x[start + ((lanes > 3) ? 3 : 0)];
 
-		Accumulator positiveWeightSum;
-		Accumulator negativeWeightSum;
+		FloatVector positiveSum = zero;
+		FloatVector negativeSum = zero;
+		double positiveP[SIMD_WIDTH] = { 0.0, 0.0, 0.0, 0.0 };
+		double negativeP[SIMD_WIDTH] = { 0.0, 0.0, 0.0, 0.0 };
 
-		//iterate through each sample to compute the means.
-		for (int i = 0; i < samples.size(); i++)
+		//the coefficients are read a block of attributes at a time, dequantized on the stack if quantized.
+		for (int begin = 0; begin < _n; begin += COEFFICIENT_BLOCK)
 		{
-			Sample* x = samples[i];
-			//get the attribute sum of positive samples.
-			if (x->y() == classIndex)
+			int blockSize = std::min(COEFFICIENT_BLOCK, _n - begin);
+			blockCoefficients(begin, blockSize, block, c);
+			for (int i = 0; i < blockSize; i++)
 			{
-				positiveMeanSum += sampleWeights[i] * x->x(j);
-				positiveWeightSum += sampleWeights[i];
+				FloatVector xj = simdSet(x0[begin + i], x1[begin + i], x2[begin + i], x3[begin + i]);
+				FloatVector positive = simdSub(xj, simdSet(c[0][i]));
+				FloatVector negative = simdSub(xj, simdSet(c[2][i]));
+				FloatVector logPositiveDensity = simdMul(simdMul(simdSet(c[1][i]), positive), positive);
+				FloatVector logNegativeDensity = simdMul(simdMul(simdSet(c[3][i]), negative), negative);
+
+				if (!_fastMath)
+				{
+					simdStore(a, logPositiveDensity);
+					simdStore(b, logNegativeDensity);
+					for (int lane = 0; lane < lanes; lane++)
+					{
+						double logPositive, logNegative;
+						attributeLogProbabilities(a[lane], b[lane], logPositive, logNegative);
+						positiveP[lane] += logPositive;
+						negativeP[lane] += logNegative;
+					}
+					continue;
+				}
+
+				//log(exp(a) + exp(b)).
+				FloatVector difference = simdAbs(simdSub(logPositiveDensity, logNegativeDensity));
+				FloatVector logDensity = simdAdd(simdMax(logPositiveDensity, logNegativeDensity), simdLog(simdAdd(one, simdExp(simdSub(zero, difference)))));
+				FloatVector logPositive = simdSub(logPositiveDensity, logDensity);
+				FloatVector logNegative = simdSub(logNegativeDensity, logDensity);
+
+				//densities below MIN_DENSITY.
+				FloatVector lowDensity = simdLess(logDensity, logMinDensity);
+				if (simdAny(lowDensity))
+				{
+					FloatVector lowPositive = simdSub(logPositiveDensity, logMinDensity);
+					FloatVector lowNegative = simdLog(simdMax(simdSub(one, simdExp(lowPositive)), simdSet(MIN_PROBABILITY)));
+					logPositive = simdSelect(lowDensity, lowPositive, logPositive);
+					logNegative = simdSelect(lowDensity, lowNegative, logNegative);
+				}
+
+				positiveSum = simdAdd(positiveSum, simdMax(logPositive, logMinProbability));
+				negativeSum = simdAdd(negativeSum, simdMax(logNegative, logMinProbability));
 			}
-			//get the attribute sum of negative samples.
-			else
+		}
+
+		if (_fastMath)
+		{
+			simdStore(a, positiveSum);
+			simdStore(b, negativeSum);
+			for (int lane = 0; lane < lanes; lane++)
 			{
-				negativeMeanSum += sampleWeights[i] * x->x(j);
-				negativeWeightSum += sampleWeights[i];
+				positiveP[lane] = a[lane];
+				negativeP[lane] = b[lane];
 			}
 		}
 
-		//compute the means.
-		positiveMeanSum = positiveMeanSum.sum() / positiveWeightSum.sum();
-		negativeMeanSum = negativeMeanSum.sum() / negativeWeightSum.sum();
+		for (int lane = 0; lane < lanes; lane++)
+			labels[start + lane] = label(positiveP[lane], negativeP[lane]);
+	}
+}
+
+void NaiveBayes::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	//use the shared statistics if the sample weights are constant within the positive and within the
+	//negative samples. Otherwise accumulate the statistics of the weighted samples in a single pass.
+	NaiveBayesStatistics* statistics = dynamic_cast<NaiveBayesStatistics*>(_trainingCache);
+	NaiveBayesStatistics* localStatistics = nullptr;
+	if (statistics == nullptr || !statistics->matches(samples) || !constantClassWeights(samples, sampleWeights, classIndex))
+	{
+		localStatistics = new NaiveBayesStatistics(samples, sampleWeights);
+		statistics = localStatistics;
+	}
+
+	fit(*statistics, classIndex);
 
-		Accumulator positiveVarSum;
-		Accumulator negativeVarSum;
+	delete localStatistics;
+}
+
+void NaiveBayes::partialFit(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	if (samples.size() <= 0)
+		return;
 
-		//iterate through each sample to compute the variances.s
-		for (int i = 0; i < samples.size(); i++)
+	if (partialFitStatistics() == nullptr)
+		_statistics = new NaiveBayesStatistics(0, samples[0]->n());
+	_statistics->add(samples, sampleWeights);
+	fit(*_statistics, classIndex);
+}
+
+void NaiveBayes::partialFit(SampleReader& reader, int classIndex)
+{
+	if (reader.n() <= 0)
+		return;
+
+	if (partialFitStatistics() == nullptr)
+		_statistics = new NaiveBayesStatistics(0, reader.n());
+	_statistics->add(reader);
+	fit(*_statistics, classIndex);
+}
+
+void NaiveBayes::partialFit(NaiveBayesStatistics& statistics, int classIndex)
+{
+	if (partialFitStatistics() == nullptr)
+		_statistics = new NaiveBayesStatistics(0, statistics.n());
+	if (!_statistics->merge(statistics))
+		return;
+	fit(*_statistics, classIndex);
+}
+
+NaiveBayesStatistics* NaiveBayes::statistics()
+{
+	return partialFitStatistics();
+}
+
+NaiveBayesStatistics* NaiveBayes::partialFitStatistics()
+{
+	if (_numMappedClasses > 0)
+	{
+		_statistics = new NaiveBayesStatistics(0, _n);
+		if (!_statistics->importArrays(_numMappedClasses, _mappedWeights, _mappedMean, _mappedM2))
 		{
-			Sample* x = samples[i];
-			//compute the positive attribute variance.
-			if (x->y() == classIndex)
-			{
-				positiveVarSum += sampleWeights[i] * pow(x->x(j) - positiveMeanSum.sum(), 2.0f);
-			}
-			//compute the negative attribute variance.
-			else
-			{
-				negativeVarSum += sampleWeights[i] * pow(x->x(j) - negativeMeanSum.sum(), 2.0f);
-			}
+			delete _statistics;
+			_statistics = nullptr;
 		}
+		_numMappedClasses = 0;
+	}
+	return _statistics;
+}
 
-		//get the variances.
-		positiveVarSum = positiveVarSum.sum() / positiveWeightSum.sum();
-		negativeVarSum = negativeVarSum.sum() / negativeWeightSum.sum();
+void NaiveBayes::fit(NaiveBayesStatistics& statistics, int classIndex)
+{
+	releaseParams();
+	_n = statistics.n();
+	_mean = new float[_n * 2];
+	_var = new float[_n * 2];
 
-		_mean[j * 2 + 0] = positiveMeanSum.sum();
-		_mean[j * 2 + 1] = negativeMeanSum.sum();
+	statistics.oneVsAll(classIndex, _mean, _var);
+	precompute();
+}
 
-		_var[j * 2 + 0] = fmax(positiveVarSum.sum(), 1e-5f);
-		_var[j * 2 + 1] = fmax(negativeVarSum.sum(), 1e-5f);
+/*
+The log density of an attribute value x is -(x - mean)^2 / (2 * var), without the normalization
+of the gaussian, as the label only depends on the ratio of the densities of the two classes.
+*/
+void NaiveBayes::precompute()
+{
+	_positiveCenter = new float[_n];
+	_positiveScale = new float[_n];
+	_negativeCenter = new float[_n];
+	_negativeScale = new float[_n];
+
+	for (int j = 0; j < _n; j++)
+	{
+		_positiveCenter[j] = _mean[j * 2 + 0];
+		_negativeCenter[j] = _mean[j * 2 + 1];
+		_positiveScale[j] = -1.0f / (2.0f * _var[j * 2 + 0]);
+		_negativeScale[j] = -1.0f / (2.0f * _var[j * 2 + 1]);
 	}
 }
 
+/*
+Returns true if every positive sample has the same weight, and every negative sample has the same weight.
+*/
+bool NaiveBayes::constantClassWeights(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
+{
+	float positiveWeight = -1.0f;
+	float negativeWeight = -1.0f;
+	for (int i = 0; i < samples.size(); i++)
+	{
+		float& weight = (samples[i]->y() == classIndex) ? positiveWeight : negativeWeight;
+		if (weight < 0.0f)
+			weight = sampleWeights[i];
+		else if (weight != sampleWeights[i])
+			return false;
+	}
+	return true;
+}
+
+TrainingCache* NaiveBayes::createTrainingCache(std::vector<Sample*>& samples)
+{
+	return new NaiveBayesStatistics(samples);
+}
+
+WeakLearner* NaiveBayes::create()
+{
+	NaiveBayes* naiveBayes = new NaiveBayes();
+	naiveBayes->setFastMath(_fastMath);
+	return naiveBayes;
+}
+
 void NaiveBayes::exportInternal(std::string& params)
 {
+	std::vector<float> buffer;
+	float* mean;
+	float* var;
+	meanVariance(buffer, mean, var);
 	params += std::to_string(_n) + WEAK_LEARNER_DELIM;
 
 	for (int i = 0; i < _n * 2; i++)
-		params += std::to_string(_mean[i]) + WEAK_LEARNER_DELIM;	
+		params += std::to_string(mean[i]) + WEAK_LEARNER_DELIM;	
 
 	for (int i = 0; i < _n * 2; i++)
-		params += std::to_string(_var[i]) + WEAK_LEARNER_DELIM;
+		params += std::to_string(var[i]) + WEAK_LEARNER_DELIM;
+
+	//the statistics of partialFit follow the model, models of earlier versions end before the flag.
+	NaiveBayesStatistics* statistics = partialFitStatistics();
+	params += std::to_string(statistics != nullptr ? 1 : 0) + WEAK_LEARNER_DELIM;
+	if (statistics != nullptr)
+		params += statistics->exportParams();
 }
-void NaiveBayes::importInternal(std::string& params)
+void NaiveBayes::importInternal(ParamReader& params)
 {
-	_n = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+	releaseParams();
+	_n = params.nextInt(WEAK_LEARNER_DELIM);
 	
 	_mean = new float[_n * 2];
 	for (int i = 0; i < _n * 2; i++)
-		_mean[i] = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+		_mean[i] = params.nextFloat(WEAK_LEARNER_DELIM);
 	
 	_var = new float[_n * 2];
 	for (int i = 0; i < _n * 2; i++)
-		_var[i] = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+		_var[i] = params.nextFloat(WEAK_LEARNER_DELIM);
+
+	precompute();
+
+	//corrupt statistics are dropped, the model is still valid.
+	delete _statistics;
+	_statistics = nullptr;
+	_numMappedClasses = 0;
+	if (params.nextInt(WEAK_LEARNER_DELIM) > 0)
+	{
+		std::string statistics(params.rest());
+		_statistics = new NaiveBayesStatistics(0, _n);
+		if (!_statistics->importParams(statistics) || _statistics->n() != _n)
+		{
+			delete _statistics;
+			_statistics = nullptr;
+		}
+	}
+}
+
+//tag of the binary parameters.
+#define NAIVE_BAYES_BINARY_TAG 0x5941424e
+
+/*
+Binary parameters: uint32 tag, int32 n, int32 k, uint32 reserved, followed by the aligned arrays
+mean[2n], var[2n], positiveCenter[n], positiveScale[n], negativeCenter[n], negativeScale[n], and
+the statistics of partialFit of k classes, if any: double weights[k], mean[k n], m2[k n].
+The log density coefficients are stored, such that a loaded model is used without precomputation.
+The statistics are referenced in place, and only copied by the first call to partialFit.
+*/
+void NaiveBayes::exportBinary(BinaryWriter& writer)
+{
+	NaiveBayesStatistics* statistics = partialFitStatistics();
+
+	writer.write((uint32_t)NAIVE_BAYES_BINARY_TAG);
+	writer.write((int32_t)_n);
+	writer.write((int32_t)(statistics != nullptr ? statistics->numClasses() : 0));
+	writer.write((uint32_t)0);
+	std::vector<float> statisticsBuffer;
+	std::vector<float> coefficientBuffer;
+	float* mean;
+	float* var;
+	float* c[4];
+	meanVariance(statisticsBuffer, mean, var);
+	coefficients(coefficientBuffer, c);
+
+	writer.writeArray(mean, _n * 2);
+	writer.writeArray(var, _n * 2);
+	for (int i = 0; i < 4; i++)
+		writer.writeArray(c[i], _n);
+	if (statistics != nullptr)
+		statistics->exportBinary(writer);
+}
+
+bool NaiveBayes::importBinary(BinaryReader& reader, int n)
+{
+	uint32_t tag;
+	int32_t size;
+	int32_t numClasses;
+	uint32_t reserved;
+	if (!reader.read(tag) || tag != NAIVE_BAYES_BINARY_TAG)
+		return false;
+	if (!reader.read(size) || !reader.read(numClasses) || !reader.read(reserved) || size != n)
+		return false;
+	if (numClasses < 0 || (numClasses > 0 && numClasses > INT_MAX / std::max(n, 1)))
+		return false;
+
+	float* mean = reader.readArray<float>(n * 2);
+	float* var = reader.readArray<float>(n * 2);
+	float* positiveCenter = reader.readArray<float>(n);
+	float* positiveScale = reader.readArray<float>(n);
+	float* negativeCenter = reader.readArray<float>(n);
+	float* negativeScale = reader.readArray<float>(n);
+	if (negativeScale == nullptr)
+		return false;
+
+	const double* weights = nullptr;
+	const double* statisticsMean = nullptr;
+	const double* m2 = nullptr;
+	if (numClasses > 0)
+	{
+		weights = reader.readArray<const double>(numClasses);
+		statisticsMean = reader.readArray<const double>(numClasses * n);
+		m2 = reader.readArray<const double>(numClasses * n);
+		if (m2 == nullptr)
+			return false;
+	}
+
+	releaseParams();
+	delete _statistics;
+	_statistics = nullptr;
+	_numMappedClasses = numClasses;
+	_mappedWeights = weights;
+	_mappedMean = statisticsMean;
+	_mappedM2 = m2;
+	_n = n;
+	_mean = mean;
+	_var = var;
+	_positiveCenter = positiveCenter;
+	_positiveScale = positiveScale;
+	_negativeCenter = negativeCenter;
+	_negativeScale = negativeScale;
+	_mappedParams = true;
+	return true;
+}
+
+void NaiveBayes::releaseParams()
+{
+	if (!_mappedParams)
+	{
+		delete[] _mean;
+		delete[] _var;
+		delete[] _positiveCenter;
+		delete[] _positiveScale;
+		delete[] _negativeCenter;
+		delete[] _negativeScale;
+	}
+	_mean = nullptr;
+	_var = nullptr;
+	_positiveCenter = nullptr;
+	_positiveScale = nullptr;
+	_negativeCenter = nullptr;
+	_negativeScale = nullptr;
+	_mappedParams = false;
+
+	for (int c = 0; c < 4; c++)
+	{
+		delete _quantizedCoefficients[c];
+		_quantizedCoefficients[c] = nullptr;
+	}
+}
+
+void NaiveBayes::coefficients(std::vector<float>& buffer, float** coefficients)
+{
+	if (_quantizedCoefficients[0] == nullptr)
+	{
+		coefficients[0] = _positiveCenter;
+		coefficients[1] = _positiveScale;
+		coefficients[2] = _negativeCenter;
+		coefficients[3] = _negativeScale;
+		return;
+	}
+
+	buffer.resize(_n * 4);
+	for (int c = 0; c < 4; c++)
+	{
+		coefficients[c] = &buffer[c * _n];
+		_quantizedCoefficients[c]->dequantize(coefficients[c]);
+	}
+
+	//scale = -(1 / std)^2.
+	for (int j = 0; j < _n; j++)
+	{
+		coefficients[1][j] = -coefficients[1][j] * coefficients[1][j];
+		coefficients[3][j] = -coefficients[3][j] * coefficients[3][j];
+	}
+}
+
+void NaiveBayes::blockCoefficients(int begin, int count, float block[4][COEFFICIENT_BLOCK], float** coefficients)
+{
+	if (_quantizedCoefficients[0] == nullptr)
+	{
+		coefficients[0] = _positiveCenter + begin;
+		coefficients[1] = _positiveScale + begin;
+		coefficients[2] = _negativeCenter + begin;
+		coefficients[3] = _negativeScale + begin;
+		return;
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		coefficients[c] = block[c];
+		_quantizedCoefficients[c]->dequantize(block[c], begin, count);
+	}
+
+	//scale = -(1 / std)^2.
+	for (int j = 0; j < count; j++)
+	{
+		block[1][j] = -block[1][j] * block[1][j];
+		block[3][j] = -block[3][j] * block[3][j];
+	}
+}
+
+void NaiveBayes::meanVariance(std::vector<float>& buffer, float*& mean, float*& var)
+{
+	if (_quantizedCoefficients[0] == nullptr)
+	{
+		mean = _mean;
+		var = _var;
+		return;
+	}
+
+	std::vector<float> coefficientBuffer;
+	float* c[4];
+	coefficients(coefficientBuffer, c);
+
+	buffer.resize(_n * 4);
+	mean = &buffer[0];
+	var = &buffer[_n * 2];
+	for (int j = 0; j < _n; j++)
+	{
+		mean[j * 2 + 0] = c[0][j];
+		mean[j * 2 + 1] = c[2][j];
+		var[j * 2 + 0] = -1.0f / (2.0f * fmin(c[1][j], -MIN_SCALE));
+		var[j * 2 + 1] = -1.0f / (2.0f * fmin(c[3][j], -MIN_SCALE));
+	}
+}
+
+/*
+The centers are quantized directly. The scales -1 / (2 * var) are quantized as inverse standard
+deviations 1 / sqrt(2 * var), which have a smaller range over the attributes, such that an attribute
+with a small variance does not take up the int8 range of every other attribute.
+*/
+void NaiveBayes::quantize(QuantizationType type)
+{
+	//restore the float model first.
+	if (_quantizedCoefficients[0] != nullptr)
+	{
+		std::vector<float> statisticsBuffer;
+		std::vector<float> coefficientBuffer;
+		float* mean;
+		float* var;
+		float* c[4];
+		meanVariance(statisticsBuffer, mean, var);
+		coefficients(coefficientBuffer, c);
+
+		float* arrays[6];
+		arrays[0] = new float[_n * 2];
+		arrays[1] = new float[_n * 2];
+		memcpy(arrays[0], mean, sizeof(float) * _n * 2);
+		memcpy(arrays[1], var, sizeof(float) * _n * 2);
+		for (int i = 0; i < 4; i++)
+		{
+			arrays[i + 2] = new float[_n];
+			memcpy(arrays[i + 2], c[i], sizeof(float) * _n);
+		}
+
+		releaseParams();
+		_mean = arrays[0];
+		_var = arrays[1];
+		_positiveCenter = arrays[2];
+		_positiveScale = arrays[3];
+		_negativeCenter = arrays[4];
+		_negativeScale = arrays[5];
+	}
+	if (_positiveCenter == nullptr || type == QUANTIZE_NONE)
+		return;
+
+	float* positiveStd = new float[_n];
+	float* negativeStd = new float[_n];
+	for (int j = 0; j < _n; j++)
+	{
+		positiveStd[j] = sqrt(-_positiveScale[j]);
+		negativeStd[j] = sqrt(-_negativeScale[j]);
+	}
+
+	QuantizedArray* quantizedCoefficients[4];
+	quantizedCoefficients[0] = new QuantizedArray(_positiveCenter, _n, type);
+	quantizedCoefficients[1] = new QuantizedArray(positiveStd, _n, type);
+	quantizedCoefficients[2] = new QuantizedArray(_negativeCenter, _n, type);
+	quantizedCoefficients[3] = new QuantizedArray(negativeStd, _n, type);
+	delete[] positiveStd;
+	delete[] negativeStd;
+
+	releaseParams();
+	for (int c = 0; c < 4; c++)
+		_quantizedCoefficients[c] = quantizedCoefficients[c];
+}
+
+size_t NaiveBayes::parameterSize()
+{
+	size_t size = 0;
+	if (_quantizedCoefficients[0] != nullptr)
+	{
+		for (int c = 0; c < 4; c++)
+			size += _quantizedCoefficients[c]->sizeInBytes();
+	}
+	else if (_positiveCenter != nullptr)
+		size = _n * 4 * sizeof(float);
+	return size;
 }
\ No newline at end of file
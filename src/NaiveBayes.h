@@ -6,12 +6,30 @@ gaussian distributed. The means and variances of each
 attitube given a label is calculated. The most likely label
 can then be computed given the sample.
 
+The log densities of each attribute are precomputed as quadratics in vertex form,
+log(pdf(x)) = scale * (x - center)^2, stored as separate arrays per class. Inference is a
+multiply add sweep over the attributes, with a single exp and log per attribute, and
+a SIMD kernel scores batches of samples.
+
 Greg Smith
 gregjksmith@gmail.com
 */
 
 #pragma once
 #include <WeakLearner.h>
+#include <NaiveBayesStatistics.h>
+
+//minimum sum of the attribute densities of the positive and the negative class.
+#define MIN_DENSITY 1e-9
+
+//minimum probability of an attribute given a class.
+#define MIN_PROBABILITY 1e-12
+
+//minimum magnitude of a log density scale, when the variances are recovered from quantized coefficients.
+#define MIN_SCALE 1e-12f
+
+//attributes of a block of quantized coefficients, dequantized on the stack while scoring.
+#define COEFFICIENT_BLOCK 64
 
 class NaiveBayes : public WeakLearner
 {
@@ -20,14 +38,123 @@ public:
 
 	virtual ~NaiveBayes();
 	virtual float label(Sample* x);
+
+	/*
+	Computes the labels of every sample with the SIMD kernel.
+	*/
+	virtual void labelBatch(std::vector<Sample*>& samples, float* labels);
+
+	/*
+	Computes the labels of 'count' samples with attributes x[i], stored in 'labels'.
+	*/
+	void labelBatch(float** x, int count, float* labels);
 	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+	virtual WeakLearner* create();
+
+	/*
+	Creates the per class statistics of the training set, shared by the learners of every class.
+	*/
+	virtual TrainingCache* createTrainingCache(std::vector<Sample*>& samples);
+
+	/*
+	Incremental training. Adds the samples to the statistics held by the learner, and updates the
+	one against many model of 'classIndex' from the statistics of every sample added so far.
+	The cost of an update is proportional to the number of new samples.
+	float* sampleWeights: weight of each sample, nullptr for uniform weights.
+	*/
+	void partialFit(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Incremental training on a stream of samples, the sample weights are read from the stream.
+	*/
+	void partialFit(SampleReader& reader, int classIndex);
+
+	/*
+	Incremental training from statistics accumulated elsewhere, e.g. by another thread, on a
+	file shard or by another process. The statistics are merged into the statistics of the learner.
+	*/
+	void partialFit(NaiveBayesStatistics& statistics, int classIndex);
+
+	/*
+	Returns the statistics of every sample added with partialFit, nullptr if none was added.
+	The statistics are exported with the model, a loaded model resumes partialFit.
+	*/
+	NaiveBayesStatistics* statistics();
+
+	virtual void exportBinary(BinaryWriter& writer);
+	virtual bool importBinary(BinaryReader& reader, int n);
+
+	virtual void quantize(QuantizationType type);
+	virtual size_t parameterSize();
 
 protected:
 	virtual void exportInternal(std::string& params);
-	virtual void importInternal(std::string& params);
+	virtual void importInternal(ParamReader& params);
 
 private:
+	bool constantClassWeights(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+
+	/*
+	Returns the statistics of partialFit, copied from the arrays of a binary model on the first call
+	after the model was loaded. Returns nullptr if there are none, or the arrays are invalid.
+	*/
+	NaiveBayesStatistics* partialFitStatistics();
+
+	/*
+	Computes the model of 'classIndex' from the statistics.
+	*/
+	void fit(NaiveBayesStatistics& statistics, int classIndex);
+
+	/*
+	Computes the log density coefficients from the means and variances.
+	*/
+	void precompute();
+
+	/*
+	Releases the model arrays, unless they reference a binary model.
+	*/
+	void releaseParams();
+
+	/*
+	Returns the log density coefficients: positive center, positive scale, negative center and
+	negative scale. If the model is quantized, they are dequantized into 'buffer'.
+	*/
+	void coefficients(std::vector<float>& buffer, float** coefficients);
+
+	/*
+	Returns the log density coefficients of the 'count' attributes from 'begin', at most COEFFICIENT_BLOCK,
+	in the order of coefficients. If the model is quantized, they are dequantized into 'block'.
+	*/
+	void blockCoefficients(int begin, int count, float block[4][COEFFICIENT_BLOCK], float** coefficients);
+
+	/*
+	Returns the means and variances. If the model is quantized, they are computed from the
+	dequantized coefficients into 'buffer'.
+	*/
+	void meanVariance(std::vector<float>& buffer, float*& mean, float*& var);
+
+	/*
+	Computes the label from the summed log probabilities of the positive and negative class.
+	*/
+	float label(double positiveP, double negativeP);
+
 	int _n;	//number of attributes in a sample.
 	float* _mean;	//attribute means for positive and negative samples.
 	float* _var;	//attribute variance for positibe and negative samples.
+	NaiveBayesStatistics* _statistics;	//statistics of the samples added with partialFit.
+
+	//arrays of the statistics of partialFit in a binary model, read on first use, _numMappedClasses classes.
+	int _numMappedClasses;
+	const double* _mappedWeights;
+	const double* _mappedMean;
+	const double* _mappedM2;
+
+	float* _positiveCenter;	//log density coefficients of the positive and negative samples.
+	float* _positiveScale;
+	float* _negativeCenter;
+	float* _negativeScale;
+
+	//quantized coefficients replacing the float arrays: the centers, and the inverse standard
+	//deviations sqrt(-scale), in the order of coefficients.
+	QuantizedArray* _quantizedCoefficients[4];
 };
\ No newline at end of file
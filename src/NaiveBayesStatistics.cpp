@@ -0,0 +1,351 @@
+#include <NaiveBayesStatistics.h>
+#include <ExportStringUtils.h>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+/*
+Returns the string of a value with enough digits to restore it exactly.
+*/
+static std::string exactString(double value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.17g", value);
+	return std::string(buffer);
+}
+
+NaiveBayesStatistics::NaiveBayesStatistics(int numClasses, int n)
+{
+	_k = 0;
+	_n = n;
+	_weights = nullptr;
+	_mean = nullptr;
+	_m2 = nullptr;
+	resize(numClasses);
+}
+
+NaiveBayesStatistics::NaiveBayesStatistics(std::vector<Sample*>& samples, float* sampleWeights)
+{
+	_k = 0;
+	_n = samples[0]->n();
+	_weights = nullptr;
+	_mean = nullptr;
+	_m2 = nullptr;
+
+	int maxClassIndex = 0;
+	for (int i = 0; i < samples.size(); i++)
+		maxClassIndex = fmax(maxClassIndex, samples[i]->y());
+	resize(maxClassIndex + 1);
+
+	add(samples, sampleWeights);
+	if (sampleWeights == nullptr)
+		_samples = samples;
+}
+
+NaiveBayesStatistics::~NaiveBayesStatistics()
+{
+	delete[] _weights;
+	delete[] _mean;
+	delete[] _m2;
+}
+
+void NaiveBayesStatistics::add(float* x, int y, float weight)
+{
+	if (weight <= 0.0f)
+		return;
+	if (y >= _k)
+		resize(y + 1);
+
+	//weighted Welford update of every attribute of the class.
+	_weights[y] += weight;
+	double r = weight / _weights[y];
+	double* mean = &_mean[y * _n];
+	double* m2 = &_m2[y * _n];
+	for (int j = 0; j < _n; j++)
+	{
+		double delta = x[j] - mean[j];
+		mean[j] += r * delta;
+		m2[j] += weight * delta * (x[j] - mean[j]);
+	}
+}
+
+void NaiveBayesStatistics::add(std::vector<Sample*>& samples, float* sampleWeights)
+{
+	for (int i = 0; i < samples.size(); i++)
+	{
+		Sample* sample = samples[i];
+		add(sample->data(), sample->y(), (sampleWeights != nullptr) ? sampleWeights[i] : 1.0f);
+	}
+	_samples.clear();
+}
+
+void NaiveBayesStatistics::add(SampleReader& reader, int chunkSize)
+{
+	if (reader.n() != _n)
+		return;
+
+	SampleChunk chunk;
+	while (reader.read(chunk, chunkSize) > 0)
+	{
+		for (int i = 0; i < chunk.size(); i++)
+			add(chunk.x(i), chunk.y(i), chunk.weight(i));
+	}
+	_samples.clear();
+}
+
+bool NaiveBayesStatistics::merge(NaiveBayesStatistics& other)
+{
+	if (other._n != _n)
+		return false;
+
+	resize(other._k);
+	for (int c = 0; c < other._k; c++)
+	{
+		if (other._weights[c] <= 0.0)
+			continue;
+
+		double weight = _weights[c] + other._weights[c];
+		for (int j = 0; j < _n; j++)
+		{
+			int index = c * _n + j;
+			double delta = other._mean[index] - _mean[index];
+			_mean[index] += delta * other._weights[c] / weight;
+			_m2[index] += other._m2[index] + delta * delta * _weights[c] * other._weights[c] / weight;
+		}
+		_weights[c] = weight;
+	}
+	_samples.clear();
+	return true;
+}
+
+bool NaiveBayesStatistics::allreduce(Allreduce& allreduce)
+{
+	std::vector<std::string> gathered;
+	if (!allreduce.allgather(exportParams(), gathered))
+		return false;
+
+	clear();
+	for (int r = 0; r < gathered.size(); r++)
+	{
+		NaiveBayesStatistics statistics(0, _n);
+		if (!statistics.importParams(gathered[r]) || !merge(statistics))
+			return false;
+	}
+	return true;
+}
+
+void NaiveBayesStatistics::clear()
+{
+	for (int c = 0; c < _k; c++)
+	{
+		_weights[c] = 0.0;
+		for (int j = 0; j < _n; j++)
+		{
+			_mean[c * _n + j] = 0.0;
+			_m2[c * _n + j] = 0.0;
+		}
+	}
+	_samples.clear();
+}
+
+void NaiveBayesStatistics::oneVsAll(int classIndex, float* mean, float* var)
+{
+	for (int j = 0; j < _n; j++)
+	{
+		//positive samples.
+		double positiveMean = 0.0;
+		double positiveVar = 0.0;
+		if (classIndex < _k && _weights[classIndex] > 0.0)
+		{
+			positiveMean = _mean[classIndex * _n + j];
+			positiveVar = _m2[classIndex * _n + j] / _weights[classIndex];
+		}
+
+		//negative samples, merge the statistics of every other class.
+		double negativeWeight = 0.0;
+		double negativeMean = 0.0;
+		double negativeM2 = 0.0;
+		for (int c = 0; c < _k; c++)
+		{
+			if (c == classIndex || _weights[c] <= 0.0)
+				continue;
+
+			double weight = negativeWeight + _weights[c];
+			double delta = _mean[c * _n + j] - negativeMean;
+			negativeMean += delta * _weights[c] / weight;
+			negativeM2 += _m2[c * _n + j] + delta * delta * negativeWeight * _weights[c] / weight;
+			negativeWeight = weight;
+		}
+		double negativeVar = (negativeWeight > 0.0) ? negativeM2 / negativeWeight : 0.0;
+
+		mean[j * 2 + 0] = (float)positiveMean;
+		mean[j * 2 + 1] = (float)negativeMean;
+
+		var[j * 2 + 0] = fmax((float)positiveVar, MIN_VARIANCE);
+		var[j * 2 + 1] = fmax((float)negativeVar, MIN_VARIANCE);
+	}
+}
+
+bool NaiveBayesStatistics::matches(std::vector<Sample*>& samples)
+{
+	return _samples.size() > 0 && samples == _samples;
+}
+
+int NaiveBayesStatistics::numClasses()
+{
+	return _k;
+}
+
+int NaiveBayesStatistics::n()
+{
+	return _n;
+}
+
+double NaiveBayesStatistics::weight(int classIndex)
+{
+	return _weights[classIndex];
+}
+
+double NaiveBayesStatistics::mean(int classIndex, int j)
+{
+	return _mean[classIndex * _n + j];
+}
+
+double NaiveBayesStatistics::variance(int classIndex, int j)
+{
+	if (_weights[classIndex] <= 0.0)
+		return 0.0;
+	return _m2[classIndex * _n + j] / _weights[classIndex];
+}
+
+std::string NaiveBayesStatistics::exportParams()
+{
+	std::string params;
+	params += std::to_string(_k) + WEAK_LEARNER_DELIM;
+	params += std::to_string(_n) + WEAK_LEARNER_DELIM;
+
+	for (int c = 0; c < _k; c++)
+		params += exactString(_weights[c]) + WEAK_LEARNER_DELIM;
+
+	for (int i = 0; i < _k * _n; i++)
+		params += exactString(_mean[i]) + WEAK_LEARNER_DELIM;
+
+	for (int i = 0; i < _k * _n; i++)
+		params += exactString(_m2[i]) + WEAK_LEARNER_DELIM;
+	return params;
+}
+
+bool NaiveBayesStatistics::importParams(std::string& params)
+{
+	ParamReader reader(params);
+	int k = reader.nextInt(WEAK_LEARNER_DELIM);
+	int n = reader.nextInt(WEAK_LEARNER_DELIM);
+
+	//every value takes at least a digit and a delimiter.
+	if (k < 0 || n <= 0 || 2.0 * k * (2.0 * n + 1.0) > (double)params.size())
+		return false;
+
+	//read every value before replacing the statistics. The weights and the squared deviations are not negative.
+	std::vector<double> values(k * (2 * n + 1));
+	for (int i = 0; i < values.size(); i++)
+	{
+		if (reader.atEnd())
+			return false;
+		values[i] = reader.nextDouble(WEAK_LEARNER_DELIM);
+	}
+	for (int c = 0; c < k; c++)
+	{
+		if (!(values[c] >= 0.0))
+			return false;
+	}
+	for (int i = 0; i < k * n; i++)
+	{
+		if (!(values[k + k * n + i] >= 0.0))
+			return false;
+	}
+
+	_n = n;
+	delete[] _weights;
+	delete[] _mean;
+	delete[] _m2;
+	_k = 0;
+	_weights = nullptr;
+	_mean = nullptr;
+	_m2 = nullptr;
+	resize(k);
+
+	for (int c = 0; c < _k; c++)
+		_weights[c] = values[c];
+
+	for (int i = 0; i < _k * _n; i++)
+		_mean[i] = values[_k + i];
+
+	for (int i = 0; i < _k * _n; i++)
+		_m2[i] = values[_k + _k * _n + i];
+	_samples.clear();
+	params.erase(0, reader.position());
+	return true;
+}
+
+void NaiveBayesStatistics::exportBinary(BinaryWriter& writer)
+{
+	writer.writeArray(_weights, _k);
+	writer.writeArray(_mean, _k * _n);
+	writer.writeArray(_m2, _k * _n);
+}
+
+bool NaiveBayesStatistics::importArrays(int numClasses, const double* weights, const double* mean, const double* m2)
+{
+	for (int c = 0; c < numClasses; c++)
+	{
+		if (!(weights[c] >= 0.0))
+			return false;
+	}
+	for (int i = 0; i < numClasses * _n; i++)
+	{
+		if (!(m2[i] >= 0.0))
+			return false;
+	}
+
+	delete[] _weights;
+	delete[] _mean;
+	delete[] _m2;
+	_k = 0;
+	_weights = nullptr;
+	_mean = nullptr;
+	_m2 = nullptr;
+	resize(numClasses);
+
+	std::copy(weights, weights + _k, _weights);
+	std::copy(mean, mean + _k * _n, _mean);
+	std::copy(m2, m2 + _k * _n, _m2);
+	_samples.clear();
+	return true;
+}
+
+void NaiveBayesStatistics::resize(int numClasses)
+{
+	if (numClasses <= _k)
+		return;
+
+	double* weights = new double[numClasses];
+	double* mean = new double[numClasses * _n];
+	double* m2 = new double[numClasses * _n];
+	for (int c = 0; c < numClasses; c++)
+	{
+		weights[c] = (c < _k) ? _weights[c] : 0.0;
+		for (int j = 0; j < _n; j++)
+		{
+			mean[c * _n + j] = (c < _k) ? _mean[c * _n + j] : 0.0;
+			m2[c * _n + j] = (c < _k) ? _m2[c * _n + j] : 0.0;
+		}
+	}
+
+	delete[] _weights;
+	delete[] _mean;
+	delete[] _m2;
+	_weights = weights;
+	_mean = mean;
+	_m2 = m2;
+	_k = numClasses;
+}
\ No newline at end of file
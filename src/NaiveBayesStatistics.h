@@ -0,0 +1,134 @@
+/*
+NaiveBayesStatistics.h
+Sufficient statistics of the NaiveBayes classifier: the weighted mean and variance of every
+attribute, for every class. The statistics are accumulated in a single row by row pass over the
+samples, with weighted Welford updates.
+
+The one against many model of any class is derived from the statistics without another pass,
+the statistics of the negative samples are the merged statistics of every other class.
+The statistics of a class do not change if the weights of its samples are scaled by a constant.
+A single instance computed with uniform weights therefore serves every class whenever the
+weights are constant within the positive and within the negative samples, e.g. the first
+AdaBoost round, and is shared by the learners as a TrainingCache.
+
+Statistics accumulated independently, e.g. by threads, on file shards or on data appended
+to a training set, are combined with merge. The result equals the statistics of a single
+pass over all the samples.
+*/
+
+#pragma once
+#include <WeakLearner.h>
+#include <SampleStream.h>
+#include <Allreduce.h>
+
+//minimum variance of an attribute.
+#define MIN_VARIANCE 1e-5f
+
+class NaiveBayesStatistics : public TrainingCache
+{
+public:
+	/*
+	Constructor, creates empty statistics.
+	int numClasses: initial number of classes, grows with the labels added.
+	int n: number of attributes of a sample.
+	*/
+	NaiveBayesStatistics(int numClasses, int n);
+
+	/*
+	Constructor, accumulates the statistics of a training set.
+	float* sampleWeights: weight of each sample, nullptr for uniform weights.
+	*/
+	NaiveBayesStatistics(std::vector<Sample*>& samples, float* sampleWeights = nullptr);
+	virtual ~NaiveBayesStatistics();
+
+	/*
+	Adds a sample with attributes x, label y and weight 'weight' to the statistics.
+	*/
+	void add(float* x, int y, float weight);
+
+	/*
+	Adds every sample of a training set to the statistics.
+	*/
+	void add(std::vector<Sample*>& samples, float* sampleWeights);
+
+	/*
+	Adds every sample of a stream to the statistics, read in chunks of 'chunkSize' samples.
+	The sample weights are read from the stream.
+	*/
+	void add(SampleReader& reader, int chunkSize = SAMPLE_CHUNK_SIZE);
+
+	/*
+	Combines the statistics of 'other' into these statistics, with the parallel update of
+	Chan et al. Returns false if the number of attributes differs.
+	*/
+	bool merge(NaiveBayesStatistics& other);
+
+	/*
+	Replaces the statistics of every worker of 'allreduce' by the statistics of every worker merged in
+	rank order, the statistics of the whole training set. Returns false if a worker failed, or sent
+	statistics which are corrupt or have another number of attributes.
+	*/
+	bool allreduce(Allreduce& allreduce);
+
+	/*
+	Removes every sample from the statistics.
+	*/
+	void clear();
+
+	/*
+	Computes the one against many model of class 'classIndex'. The mean and variance of
+	attribute j are stored at index j * 2 + 0 for the positive samples, and j * 2 + 1 for
+	the negative samples, 2 * n values each.
+	*/
+	void oneVsAll(int classIndex, float* mean, float* var);
+
+	/*
+	Returns true if the statistics were accumulated from the training set 'samples' with
+	uniform weights.
+	*/
+	bool matches(std::vector<Sample*>& samples);
+
+	/*
+	Getters. The variance is the weighted population variance.
+	*/
+	int numClasses();
+	int n();
+	double weight(int classIndex);
+	double mean(int classIndex, int j);
+	double variance(int classIndex, int j);
+
+	/*
+	Exports and imports the statistics, e.g. to combine statistics computed by separate processes,
+	or to update the statistics with new data later on. The values are stored with full precision.
+	importParams returns false, and keeps the statistics, if the parameters are truncated or invalid.
+	*/
+	std::string exportParams();
+	bool importParams(std::string& params);
+
+	/*
+	Writes the arrays of the statistics to a binary model, aligned: double weights[k], mean[k * n] and
+	m2[k * n], in the order of the classes, the number of classes is stored by the caller.
+	*/
+	void exportBinary(BinaryWriter& writer);
+
+	/*
+	Replaces the statistics by copies of the arrays written by exportBinary, of 'numClasses' classes
+	and the attributes of the statistics. Returns false, and keeps the statistics, if a weight or a
+	squared deviation is negative.
+	*/
+	bool importArrays(int numClasses, const double* weights, const double* mean, const double* m2);
+
+private:
+	/*
+	Grows the statistics to hold 'numClasses' classes.
+	*/
+	void resize(int numClasses);
+
+	int _k;	//number of classes.
+	int _n;	//number of attributes in a sample.
+	double* _weights;	//weight sum of each class.
+	double* _mean;	//attribute means, k x n.
+	double* _m2;	//weighted sums of squared deviations from the mean, k x n.
+
+	std::vector<Sample*> _samples;	//training set of uniformly weighted statistics.
+};
\ No newline at end of file
@@ -0,0 +1,482 @@
+#include <Optimizer.h>
+#include <cmath>
+
+//sufficient decrease and curvature parameters of the strong Wolfe conditions.
+#define WOLFE_C1 1e-4
+#define WOLFE_C2 0.9
+
+static double dot(double* a, double* b, int n)
+{
+	double sum = 0.0;
+	for (int i = 0; i < n; i++)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+static double norm(double* a, int n)
+{
+	return sqrt(dot(a, a, n));
+}
+
+void Objective::acceptPoint()
+{
+}
+
+void Objective::hessianVector(double*, double* hv)
+{
+	for (int i = 0; i < size(); i++)
+		hv[i] = 0.0;
+}
+
+bool Objective::failed()
+{
+	return false;
+}
+
+LbfgsOptimizer::LbfgsOptimizer(int memory, int maxIterations, double gradientTolerance)
+{
+	_memory = memory;
+	_maxIterations = maxIterations;
+	_gradientTolerance = gradientTolerance;
+	_numIterations = 0;
+	_numEvaluations = 0;
+}
+
+LbfgsOptimizer::~LbfgsOptimizer()
+{
+}
+
+double LbfgsOptimizer::minimize(Objective& objective, double* x)
+{
+	int n = objective.size();
+
+	double* g = new double[n];
+	double* d = new double[n];
+	double* xNew = new double[n];
+	double* gNew = new double[n];
+
+	//correction pairs s = x(k+1) - x(k), y = g(k+1) - g(k), stored in a circular buffer.
+	double* s = new double[_memory * n];
+	double* y = new double[_memory * n];
+	double* rho = new double[_memory];
+	double* a = new double[_memory];
+	int historySize = 0;
+	int historyEnd = 0;
+
+	_numIterations = 0;
+	_numEvaluations = 1;
+	double f = objective.evaluate(x, g);
+	objective.acceptPoint();
+	double initialGradientNorm = norm(g, n);
+
+	while (_numIterations < _maxIterations && !objective.failed())
+	{
+		double gradientNorm = norm(g, n);
+		if (gradientNorm <= _gradientTolerance * initialGradientNorm || gradientNorm == 0.0)
+			break;
+
+		_numIterations++;
+
+		//compute the search direction d = -H * g with the two loop recursion.
+		for (int i = 0; i < n; i++)
+			d[i] = -g[i];
+
+		for (int h = 0; h < historySize; h++)
+		{
+			int index = (historyEnd - 1 - h + _memory) % _memory;
+			a[index] = rho[index] * dot(&s[index * n], d, n);
+			for (int i = 0; i < n; i++)
+				d[i] -= a[index] * y[index * n + i];
+		}
+
+		//scale the initial inverse hessian. The first step is scaled to unit length.
+		double gamma = 1.0 / gradientNorm;
+		if (historySize > 0)
+		{
+			int last = (historyEnd - 1 + _memory) % _memory;
+			gamma = dot(&s[last * n], &y[last * n], n) / dot(&y[last * n], &y[last * n], n);
+		}
+		for (int i = 0; i < n; i++)
+			d[i] *= gamma;
+
+		for (int h = historySize - 1; h >= 0; h--)
+		{
+			int index = (historyEnd - 1 - h + _memory) % _memory;
+			double beta = rho[index] * dot(&y[index * n], d, n);
+			for (int i = 0; i < n; i++)
+				d[i] += (a[index] - beta) * s[index * n + i];
+		}
+
+		//if the direction is not a descent direction, restart from steepest descent.
+		if (dot(d, g, n) >= 0.0)
+		{
+			historySize = 0;
+			for (int i = 0; i < n; i++)
+				d[i] = -g[i] / gradientNorm;
+		}
+
+		double step = 1.0;
+		double fNew;
+		if (!lineSearch(objective, x, f, g, d, step, xNew, fNew, gNew))
+			break;
+		objective.acceptPoint();
+
+		//store the correction pair, if it keeps the inverse hessian approximation positive definite.
+		double* sNew = &s[historyEnd * n];
+		double* yNew = &y[historyEnd * n];
+		for (int i = 0; i < n; i++)
+		{
+			sNew[i] = xNew[i] - x[i];
+			yNew[i] = gNew[i] - g[i];
+		}
+		double sy = dot(sNew, yNew, n);
+		if (sy > 1e-10 * dot(yNew, yNew, n))
+		{
+			rho[historyEnd] = 1.0 / sy;
+			historyEnd = (historyEnd + 1) % _memory;
+			if (historySize < _memory)
+				historySize++;
+		}
+
+		double decrease = f - fNew;
+		for (int i = 0; i < n; i++)
+		{
+			x[i] = xNew[i];
+			g[i] = gNew[i];
+		}
+		double fPrevious = f;
+		f = fNew;
+
+		if (decrease <= OPTIMIZER_FUNCTION_TOLERANCE * fmax(fmax(fabs(fPrevious), fabs(f)), 1.0))
+			break;
+	}
+
+	delete[] a;
+	delete[] rho;
+	delete[] y;
+	delete[] s;
+	delete[] gNew;
+	delete[] xNew;
+	delete[] d;
+	delete[] g;
+
+	return f;
+}
+
+int LbfgsOptimizer::numIterations()
+{
+	return _numIterations;
+}
+
+int LbfgsOptimizer::numEvaluations()
+{
+	return _numEvaluations;
+}
+
+/*
+Searches a step length 'step' along the descent direction d satisfying the strong Wolfe conditions.
+The step is bracketed by doubling the initial step, and the bracket is refined by cubic interpolation.
+*/
+bool LbfgsOptimizer::lineSearch(Objective& objective, double* x, double f, double* g, double* d, double& step, double* xNew, double& fNew, double* gNew)
+{
+	int n = objective.size();
+	double dg0 = dot(d, g, n);
+
+	//the bracket [low, high] and the objective values and directional derivatives at its ends.
+	double low = 0.0, fLow = f, dgLow = dg0;
+	double high = 0.0, fHigh = f, dgHigh = dg0;
+	bool bracketed = false;
+
+	double previous = 0.0, fPrevious = f, dgPrevious = dg0;
+	for (int evaluation = 0; evaluation < LINE_SEARCH_MAX_EVALUATIONS; evaluation++)
+	{
+		if (bracketed)
+		{
+			//cubic interpolation of the minimum within the bracket, safeguarded away from the ends.
+			double d1 = dgLow + dgHigh - 3.0 * (fLow - fHigh) / (low - high);
+			double d2Sq = d1 * d1 - dgLow * dgHigh;
+			double trial = 0.5 * (low + high);
+			if (d2Sq >= 0.0)
+			{
+				double d2 = (high > low ? 1.0 : -1.0) * sqrt(d2Sq);
+				trial = high - (high - low) * (dgHigh + d2 - d1) / (dgHigh - dgLow + 2.0 * d2);
+			}
+			double margin = 0.1 * fabs(high - low);
+			if (!(trial > fmin(low, high) + margin && trial < fmax(low, high) - margin))
+				trial = 0.5 * (low + high);
+			step = trial;
+		}
+
+		fNew = evaluateStep(objective, x, d, step, xNew, gNew);
+		if (objective.failed())
+			return false;
+		double dgNew = dot(d, gNew, n);
+
+		if (!bracketed)
+		{
+			if (fNew > f + WOLFE_C1 * step * dg0 || (evaluation > 0 && fNew >= fPrevious))
+			{
+				low = previous; fLow = fPrevious; dgLow = dgPrevious;
+				high = step; fHigh = fNew; dgHigh = dgNew;
+				bracketed = true;
+				continue;
+			}
+			if (fabs(dgNew) <= -WOLFE_C2 * dg0)
+				return true;
+			if (dgNew >= 0.0)
+			{
+				low = step; fLow = fNew; dgLow = dgNew;
+				high = previous; fHigh = fPrevious; dgHigh = dgPrevious;
+				bracketed = true;
+				continue;
+			}
+			previous = step; fPrevious = fNew; dgPrevious = dgNew;
+			step *= 2.0;
+		}
+		else
+		{
+			if (fNew > f + WOLFE_C1 * step * dg0 || fNew >= fLow)
+			{
+				high = step; fHigh = fNew; dgHigh = dgNew;
+			}
+			else
+			{
+				if (fabs(dgNew) <= -WOLFE_C2 * dg0)
+					return true;
+				if (dgNew * (high - low) >= 0.0)
+				{
+					high = low; fHigh = fLow; dgHigh = dgLow;
+				}
+				low = step; fLow = fNew; dgLow = dgNew;
+			}
+		}
+	}
+
+	//the curvature condition was not met, accept the best step with a sufficient decrease.
+	double best = bracketed ? low : previous;
+	if (best <= 0.0)
+		return false;
+	if (best != step)
+	{
+		step = best;
+		fNew = evaluateStep(objective, x, d, step, xNew, gNew);
+		if (objective.failed())
+			return false;
+	}
+	return true;
+}
+
+/*
+Evaluates the objective at x + step * d.
+*/
+double LbfgsOptimizer::evaluateStep(Objective& objective, double* x, double* d, double step, double* xNew, double* gNew)
+{
+	int n = objective.size();
+	for (int i = 0; i < n; i++)
+		xNew[i] = x[i] + step * d[i];
+	_numEvaluations++;
+	return objective.evaluate(xNew, gNew);
+}
+
+//trust region update parameters.
+#define TRUST_REGION_ETA0 1e-4
+#define TRUST_REGION_ETA1 0.25
+#define TRUST_REGION_ETA2 0.75
+#define TRUST_REGION_SIGMA1 0.25
+#define TRUST_REGION_SIGMA2 0.5
+#define TRUST_REGION_SIGMA3 4.0
+
+TrustRegionNewtonOptimizer::TrustRegionNewtonOptimizer(int maxIterations, double gradientTolerance)
+{
+	_maxIterations = maxIterations;
+	_gradientTolerance = gradientTolerance;
+	_numIterations = 0;
+	_numEvaluations = 0;
+	_numHessianProducts = 0;
+}
+
+TrustRegionNewtonOptimizer::~TrustRegionNewtonOptimizer()
+{
+}
+
+double TrustRegionNewtonOptimizer::minimize(Objective& objective, double* x)
+{
+	int n = objective.size();
+
+	double* g = new double[n];
+	double* s = new double[n];
+	double* r = new double[n];
+	double* xNew = new double[n];
+	double* gNew = new double[n];
+
+	_numIterations = 0;
+	_numEvaluations = 1;
+	_numHessianProducts = 0;
+	double f = objective.evaluate(x, g);
+	objective.acceptPoint();
+
+	double initialGradientNorm = norm(g, n);
+	double radius = initialGradientNorm;
+	int numSteps = 0;
+
+	while (_numIterations < _maxIterations && !objective.failed())
+	{
+		double gradientNorm = norm(g, n);
+		if (gradientNorm <= _gradientTolerance * initialGradientNorm || gradientNorm == 0.0)
+			break;
+
+		numSteps++;
+		conjugateGradient(objective, g, radius, s, r);
+		if (objective.failed())
+			break;
+
+		for (int i = 0; i < n; i++)
+			xNew[i] = x[i] + s[i];
+
+		_numEvaluations++;
+		double fNew = objective.evaluate(xNew, gNew);
+		if (objective.failed())
+			break;
+
+		//compare the actual reduction with the reduction predicted by the quadratic model.
+		double gs = dot(g, s, n);
+		double predictedReduction = -0.5 * (gs - dot(s, r, n));
+		double actualReduction = f - fNew;
+
+		double stepNorm = norm(s, n);
+		if (numSteps == 1)
+			radius = fmin(radius, stepNorm);
+
+		//update the trust region radius.
+		double alpha;
+		if (fNew - f - gs <= 0.0)
+			alpha = TRUST_REGION_SIGMA3;
+		else
+			alpha = fmax(TRUST_REGION_SIGMA1, -0.5 * (gs / (fNew - f - gs)));
+
+		if (actualReduction < TRUST_REGION_ETA0 * predictedReduction)
+			radius = fmin(fmax(alpha, TRUST_REGION_SIGMA1) * stepNorm, TRUST_REGION_SIGMA2 * radius);
+		else if (actualReduction < TRUST_REGION_ETA1 * predictedReduction)
+			radius = fmax(TRUST_REGION_SIGMA1 * radius, fmin(alpha * stepNorm, TRUST_REGION_SIGMA2 * radius));
+		else if (actualReduction < TRUST_REGION_ETA2 * predictedReduction)
+			radius = fmax(TRUST_REGION_SIGMA1 * radius, fmin(alpha * stepNorm, TRUST_REGION_SIGMA3 * radius));
+		else
+			radius = fmax(radius, fmin(alpha * stepNorm, TRUST_REGION_SIGMA3 * radius));
+
+		//accept the step if the objective decreased sufficiently.
+		if (actualReduction > TRUST_REGION_ETA0 * predictedReduction)
+		{
+			_numIterations++;
+			objective.acceptPoint();
+			for (int i = 0; i < n; i++)
+			{
+				x[i] = xNew[i];
+				g[i] = gNew[i];
+			}
+			f = fNew;
+		}
+
+		//stop if the model can no longer predict a reduction.
+		if (predictedReduction <= 0.0)
+			break;
+		if (fabs(actualReduction) <= OPTIMIZER_FUNCTION_TOLERANCE * fabs(f) && fabs(predictedReduction) <= OPTIMIZER_FUNCTION_TOLERANCE * fabs(f))
+			break;
+	}
+
+	delete[] gNew;
+	delete[] xNew;
+	delete[] r;
+	delete[] s;
+	delete[] g;
+
+	return f;
+}
+
+int TrustRegionNewtonOptimizer::numIterations()
+{
+	return _numIterations;
+}
+
+int TrustRegionNewtonOptimizer::numEvaluations()
+{
+	return _numEvaluations;
+}
+
+int TrustRegionNewtonOptimizer::numHessianProducts()
+{
+	return _numHessianProducts;
+}
+
+/*
+Approximately minimizes the quadratic model g's + 0.5 s'Hs subject to |s| <= radius, with
+conjugate gradient iterations, at most n as in exact arithmetic the iterations converge in n steps.
+If an iterate leaves the trust region, the step is truncated at the trust region boundary.
+*/
+void TrustRegionNewtonOptimizer::conjugateGradient(Objective& objective, double* g, double radius, double* s, double* r)
+{
+	int n = objective.size();
+	double* d = new double[n];
+	double* hd = new double[n];
+
+	for (int i = 0; i < n; i++)
+	{
+		s[i] = 0.0;
+		r[i] = -g[i];
+		d[i] = r[i];
+	}
+
+	double tolerance = 0.1 * norm(g, n);
+	double rr = dot(r, r, n);
+
+	for (int iteration = 0; iteration < n; iteration++)
+	{
+		if (sqrt(rr) <= tolerance)
+			break;
+
+		_numHessianProducts++;
+		objective.hessianVector(d, hd);
+		if (objective.failed())
+			break;
+
+		double dhd = dot(d, hd, n);
+		double alpha = rr / dhd;
+		for (int i = 0; i < n; i++)
+			s[i] += alpha * d[i];
+
+		if (dhd <= 0.0 || norm(s, n) > radius)
+		{
+			//move back, and follow d to the trust region boundary.
+			for (int i = 0; i < n; i++)
+				s[i] -= alpha * d[i];
+
+			double sd = dot(s, d, n);
+			double ss = dot(s, s, n);
+			double dd = dot(d, d, n);
+			double radiusSq = radius * radius;
+			double rad = sqrt(sd * sd + dd * (radiusSq - ss));
+			if (sd >= 0.0)
+				alpha = (radiusSq - ss) / (sd + rad);
+			else
+				alpha = (rad - sd) / dd;
+
+			for (int i = 0; i < n; i++)
+			{
+				s[i] += alpha * d[i];
+				r[i] -= alpha * hd[i];
+			}
+			break;
+		}
+
+		for (int i = 0; i < n; i++)
+			r[i] -= alpha * hd[i];
+
+		double rrNew = dot(r, r, n);
+		double beta = rrNew / rr;
+		for (int i = 0; i < n; i++)
+			d[i] = r[i] + beta * d[i];
+		rr = rrNew;
+	}
+
+	delete[] hd;
+	delete[] d;
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+Optimizer.h
+Unconstrained minimization of smooth objective functions. Used by learners which minimize
+a full batch loss over the training set, where every evaluation of the objective is a pass
+over the training data.
+
+LbfgsOptimizer: limited memory BFGS. The search direction is computed from the most recent
+gradient differences, the step length with a line search satisfying the strong Wolfe conditions.
+
+TrustRegionNewtonOptimizer: trust region Newton method. Each step approximately minimizes the
+quadratic model of the objective within the trust region, using conjugate gradient iterations
+with hessian vector products.
+*/
+
+#pragma once
+
+//number of correction pairs stored by L-BFGS.
+#define LBFGS_MEMORY 10
+
+//maximum number of optimizer iterations.
+#define OPTIMIZER_MAX_ITERATIONS 100
+
+//the optimum is reached if the gradient norm is less than this fraction of the initial gradient norm.
+#define OPTIMIZER_GRADIENT_TOLERANCE 1e-4
+
+//the optimum is reached if the relative decrease of the objective in an iteration is less than this threshold.
+#define OPTIMIZER_FUNCTION_TOLERANCE 1e-9
+
+//maximum number of objective evaluations in a single line search.
+#define LINE_SEARCH_MAX_EVALUATIONS 20
+
+/*
+Objective. Interface of a function minimized by the optimizers.
+*/
+class Objective
+{
+public:
+	virtual ~Objective() {}
+
+	/*
+	Returns the number of parameters of the function.
+	*/
+	virtual int size() = 0;
+
+	/*
+	Computes the function value at x, and stores the gradient at x in 'gradient'.
+	*/
+	virtual double evaluate(double* x, double* gradient) = 0;
+
+	/*
+	Marks the last evaluated point as the current point of the optimizer. The hessian used
+	by hessianVector is the hessian at the current point.
+	*/
+	virtual void acceptPoint();
+
+	/*
+	Computes the product of the hessian at the current point with the vector v.
+	Only required by the TrustRegionNewtonOptimizer.
+	*/
+	virtual void hessianVector(double* v, double* hv);
+
+	/*
+	Returns true if an evaluation failed, e.g. a worker of a distributed objective failed. The
+	optimizers then stop, and the results of the failed evaluation are not used.
+	*/
+	virtual bool failed();
+};
+
+class LbfgsOptimizer
+{
+public:
+	/*
+	Constructor:
+	int memory: number of correction pairs used to approximate the inverse hessian.
+	int maxIterations: maximum number of iterations.
+	double gradientTolerance: relative gradient norm at which the minimum is reached.
+	*/
+	LbfgsOptimizer(int memory = LBFGS_MEMORY, int maxIterations = OPTIMIZER_MAX_ITERATIONS, double gradientTolerance = OPTIMIZER_GRADIENT_TOLERANCE);
+	~LbfgsOptimizer();
+
+	/*
+	Minimizes the objective starting at x. The minimizer is stored in x.
+	Returns the objective value at the minimizer. If the objective failed, x is the last accepted point.
+	*/
+	double minimize(Objective& objective, double* x);
+
+	/*
+	Returns the number of iterations and objective evaluations of the last minimization.
+	*/
+	int numIterations();
+	int numEvaluations();
+
+private:
+	/*
+	Searches a step length 'step' along the descent direction d satisfying the strong Wolfe conditions.
+	The point, the objective value and the gradient at the accepted step are stored in xNew, fNew and gNew.
+	Returns false if no step satisfying the sufficient decrease condition was found.
+	*/
+	bool lineSearch(Objective& objective, double* x, double f, double* g, double* d, double& step, double* xNew, double& fNew, double* gNew);
+
+	/*
+	Evaluates the objective at x + step * d.
+	*/
+	double evaluateStep(Objective& objective, double* x, double* d, double step, double* xNew, double* gNew);
+
+	int _memory;
+	int _maxIterations;
+	double _gradientTolerance;
+
+	int _numIterations;
+	int _numEvaluations;
+};
+
+class TrustRegionNewtonOptimizer
+{
+public:
+	/*
+	Constructor:
+	int maxIterations: maximum number of newton iterations.
+	double gradientTolerance: relative gradient norm at which the minimum is reached.
+	*/
+	TrustRegionNewtonOptimizer(int maxIterations = OPTIMIZER_MAX_ITERATIONS, double gradientTolerance = OPTIMIZER_GRADIENT_TOLERANCE);
+	~TrustRegionNewtonOptimizer();
+
+	/*
+	Minimizes the objective starting at x. The minimizer is stored in x.
+	Returns the objective value at the minimizer. If the objective failed, x is the last accepted point.
+	*/
+	double minimize(Objective& objective, double* x);
+
+	/*
+	Returns the number of newton iterations, objective evaluations and hessian vector products
+	of the last minimization.
+	*/
+	int numIterations();
+	int numEvaluations();
+	int numHessianProducts();
+
+private:
+	/*
+	Approximately minimizes the quadratic model g's + 0.5 s'Hs subject to |s| <= radius, with
+	conjugate gradient iterations. The step is stored in s, the residual -g - Hs in r.
+	*/
+	void conjugateGradient(Objective& objective, double* g, double radius, double* s, double* r);
+
+	int _maxIterations;
+	double _gradientTolerance;
+
+	int _numIterations;
+	int _numEvaluations;
+	int _numHessianProducts;
+};
\ No newline at end of file
@@ -0,0 +1,469 @@
+#include <OutOfCoreTree.h>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+/*
+Header of a binned sample file.
+*/
+struct BinnedFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t n;
+	int32_t reserved;
+	int64_t numSamples;
+};
+
+/*
+Returns the size in bytes of a binned record with n attributes.
+*/
+static size_t binnedRecordSize(int n)
+{
+	return sizeof(int32_t) + sizeof(float) + n;
+}
+
+bool writeBinnedSampleFile(const std::string& path, SampleReader& reader, AttributeBins& bins, int chunkSize)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	int n = reader.n();
+	if (!file.is_open() || n == 0 || bins.n() != n)
+		return false;
+
+	BinnedFileHeader header;
+	header.magic = BINNED_FILE_MAGIC;
+	header.version = BINNED_FILE_VERSION;
+	header.n = n;
+	header.reserved = 0;
+	header.numSamples = reader.numSamples();
+	file.write((const char*)&header, sizeof(header));
+
+	for (int a = 0; a < n; a++)
+	{
+		int32_t numEdges = bins.numBins(a) - 1;
+		file.write((const char*)&numEdges, sizeof(int32_t));
+		for (int b = 0; b < numEdges; b++)
+		{
+			float edge = bins.edge(a, b);
+			file.write((const char*)&edge, sizeof(float));
+		}
+	}
+
+	reader.rewind();
+	SampleChunk chunk;
+	size_t size = binnedRecordSize(n);
+	std::vector<char> buffer;
+	long long numSamples = 0;
+	int count;
+	while ((count = reader.read(chunk, chunkSize)) > 0)
+	{
+		buffer.resize(size * count);
+		for (int i = 0; i < count; i++)
+		{
+			char* record = &buffer[size * i];
+			int32_t y = chunk.y(i);
+			float weight = chunk.weight(i);
+			memcpy(record, &y, sizeof(int32_t));
+			memcpy(record + sizeof(int32_t), &weight, sizeof(float));
+
+			const float* x = chunk.x(i);
+			uint8_t* sampleBins = (uint8_t*)(record + sizeof(int32_t) + sizeof(float));
+			for (int a = 0; a < n; a++)
+				sampleBins[a] = bins.bin(a, x[a]);
+		}
+		file.write(buffer.data(), buffer.size());
+		numSamples += count;
+	}
+	return file.good() && numSamples == header.numSamples;
+}
+
+BinnedSampleReader::BinnedSampleReader(const std::string& path)
+{
+	_n = 0;
+	_numSamples = 0;
+	_position = 0;
+	_recordsOffset = 0;
+
+	_file.open(path, std::ios::in | std::ios::binary);
+	BinnedFileHeader header;
+	if (!_file.read((char*)&header, sizeof(header)))
+		return;
+	if (header.magic != BINNED_FILE_MAGIC || header.version != BINNED_FILE_VERSION || header.n <= 0)
+		return;
+
+	_bins.resize(header.n);
+	for (int a = 0; a < header.n; a++)
+	{
+		int32_t numEdges;
+		if (!_file.read((char*)&numEdges, sizeof(int32_t)) || numEdges < 0 || numEdges > MAX_BINS - 1)
+			return;
+		std::vector<float> edges(numEdges);
+		if (!_file.read((char*)edges.data(), sizeof(float) * numEdges))
+			return;
+		_bins.setEdges(a, edges);
+	}
+
+	_n = header.n;
+	_numSamples = header.numSamples;
+	_recordsOffset = _file.tellg();
+}
+
+BinnedSampleReader::~BinnedSampleReader()
+{
+}
+
+int BinnedSampleReader::n()
+{
+	return _n;
+}
+
+long long BinnedSampleReader::numSamples()
+{
+	return _numSamples;
+}
+
+AttributeBins& BinnedSampleReader::bins()
+{
+	return _bins;
+}
+
+int BinnedSampleReader::read(int maxSamples, int32_t* y, float* weights, uint8_t* sampleBins)
+{
+	if (_n == 0 || _position >= _numSamples)
+		return 0;
+
+	int count = (int)std::min((long long)maxSamples, _numSamples - _position);
+	size_t size = binnedRecordSize(_n);
+	_buffer.resize(size * count);
+	if (!_file.read(_buffer.data(), _buffer.size()))
+		count = _file.gcount() / size;
+
+	for (int i = 0; i < count; i++)
+	{
+		const char* record = &_buffer[size * i];
+		memcpy(&y[i], record, sizeof(int32_t));
+		memcpy(&weights[i], record + sizeof(int32_t), sizeof(float));
+		memcpy(&sampleBins[(size_t)i * _n], record + sizeof(int32_t) + sizeof(float), _n);
+	}
+	_position += count;
+	return count;
+}
+
+void BinnedSampleReader::rewind()
+{
+	_file.clear();
+	_file.seekg(_recordsOffset, std::ios::beg);
+	_position = 0;
+}
+
+/*
+Entropy of a binary distribution with a probability p of the positive class.
+*/
+static double binaryEntropy(double p)
+{
+	if (p <= 0.0 || p >= 1.0)
+		return 0.0;
+	return -p * log2(p) - (1.0 - p) * log2(1.0 - p);
+}
+
+OutOfCoreTree::OutOfCoreTree(const std::string& path, const std::string& nodePath) : _reader(path)
+{
+	_nodePath = nodePath;
+	_chunkSize = SAMPLE_CHUNK_SIZE;
+	_histogramBytes = OUT_OF_CORE_HISTOGRAM_BYTES;
+	_numPasses = 0;
+	_allreduce = nullptr;
+
+	_histogramSize = 0;
+	for (int a = 0; a < _reader.n(); a++)
+	{
+		_offsets.push_back(_histogramSize);
+		_histogramSize += _reader.bins().numBins(a);
+	}
+}
+
+OutOfCoreTree::~OutOfCoreTree()
+{
+}
+
+void OutOfCoreTree::setGrowthLimits(const TreeGrowthLimits& limits)
+{
+	_limits = limits;
+}
+
+void OutOfCoreTree::setChunkSize(int chunkSize)
+{
+	_chunkSize = std::max(chunkSize, 1);
+}
+
+void OutOfCoreTree::setHistogramBytes(size_t histogramBytes)
+{
+	_histogramBytes = histogramBytes;
+}
+
+void OutOfCoreTree::setAllreduce(Allreduce* allreduce)
+{
+	_allreduce = allreduce;
+}
+
+int OutOfCoreTree::numPasses()
+{
+	return _numPasses;
+}
+
+long long OutOfCoreTree::numSamples()
+{
+	return _reader.numSamples();
+}
+
+bool OutOfCoreTree::train(int classIndex, DecisionTree& tree)
+{
+	//a shard may be empty, the workers train on the histograms of every shard.
+	_numPasses = 0;
+	if (_reader.n() == 0 || (_allreduce == nullptr && _reader.numSamples() == 0))
+		return false;
+
+	DecisionTreeNode root = { 0, 0.0f, -1.0f, -1 };
+	_nodes.assign(1, root);
+	_splitBins.assign(1, -1);
+
+	//the nodes of the level, every level is split on the histograms of a single pass if they fit.
+	std::vector<int> level(1, 0);
+	int slotsPerPass = (int)std::max((size_t)1, _histogramBytes / (sizeof(BinSums) * _histogramSize));
+	int depth = 0;
+	int numLeaves = 1;
+	while (!level.empty())
+	{
+		std::vector<LevelSplit> splits;
+		for (int begin = 0; begin < level.size(); begin += slotsPerPass)
+		{
+			//the samples of the nodes split at the previous level are moved to the children once per level.
+			int end = std::min(begin + slotsPerPass, (int)level.size());
+			if (!accumulate(classIndex, level, begin, end, depth > 0 && begin == 0))
+				return false;
+
+			for (int s = 0; s < end - begin; s++)
+			{
+				_nodes[level[begin + s]].label = (_sums[s].positiveWeight > _sums[s].negativeWeight) ? 1.0f : -1.0f;
+
+				LevelSplit split;
+				if (findSplit(&_histograms[(size_t)s * _histogramSize], _sums[s], depth, split))
+				{
+					split.node = level[begin + s];
+					splits.push_back(split);
+				}
+			}
+		}
+
+		//keep the splits of the largest gains if the level exceeds the maximum number of leaves.
+		if (_limits.maxLeaves > 0 && numLeaves + (int)splits.size() > _limits.maxLeaves)
+		{
+			std::stable_sort(splits.begin(), splits.end(), [](const LevelSplit& a, const LevelSplit& b) {
+				return a.gain * a.weight > b.gain * b.weight;
+			});
+			splits.resize(std::max(_limits.maxLeaves - numLeaves, 0));
+			std::sort(splits.begin(), splits.end(), [](const LevelSplit& a, const LevelSplit& b) {
+				return a.node < b.node;
+			});
+		}
+
+		std::vector<int> nextLevel;
+		for (int i = 0; i < splits.size(); i++)
+		{
+			LevelSplit& split = splits[i];
+			int child = _nodes.size();
+			_nodes[split.node].attribute = split.attribute;
+			_nodes[split.node].threshold = _reader.bins().edge(split.attribute, split.bin);
+			_nodes[split.node].child = child;
+			_splitBins[split.node] = split.bin;
+
+			for (int c = 0; c < 2; c++)
+			{
+				const BinSums& sums = split.children[c];
+				DecisionTreeNode node = { 0, 0.0f, (sums.positiveWeight > sums.negativeWeight) ? 1.0f : -1.0f, -1 };
+				_nodes.push_back(node);
+				_splitBins.push_back(-1);
+				if (splittable(sums, depth + 1))
+					nextLevel.push_back(child + c);
+			}
+			numLeaves++;
+		}
+
+		level.swap(nextLevel);
+		depth++;
+	}
+
+	tree.setNodes(_nodes.data(), _nodes.size());
+	return true;
+}
+
+bool OutOfCoreTree::accumulate(int classIndex, const std::vector<int>& level, int begin, int end, bool route)
+{
+	int numSlots = end - begin;
+	BinSums zero = { 0.0, 0.0, 0.0, 0.0 };
+	_slots.assign(_nodes.size(), -1);
+	for (int s = 0; s < numSlots; s++)
+		_slots[level[begin + s]] = s;
+	_histograms.assign((size_t)numSlots * _histogramSize, zero);
+	_sums.assign(numSlots, zero);
+
+	//the first pass creates the node file, every sample is at the root.
+	bool create = _numPasses == 0;
+	std::fstream nodeFile;
+	if (create)
+		nodeFile.open(_nodePath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	else
+		nodeFile.open(_nodePath, std::ios::in | std::ios::out | std::ios::binary);
+	if (!nodeFile.is_open())
+		return false;
+
+	int n = _reader.n();
+	std::vector<int32_t> y(_chunkSize);
+	std::vector<float> weights(_chunkSize);
+	std::vector<uint8_t> bins((size_t)_chunkSize * n);
+	std::vector<int32_t> nodes(_chunkSize, 0);
+
+	_reader.rewind();
+	long long position = 0;
+	int count;
+	while ((count = _reader.read(_chunkSize, y.data(), weights.data(), bins.data())) > 0)
+	{
+		std::streamoff offset = (std::streamoff)position * sizeof(int32_t);
+		if (!create)
+		{
+			nodeFile.seekg(offset, std::ios::beg);
+			if (!nodeFile.read((char*)nodes.data(), sizeof(int32_t) * count))
+				return false;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const uint8_t* sampleBins = &bins[(size_t)i * n];
+			int node = nodes[i];
+			if (route && _nodes[node].child >= 0)
+			{
+				node = _nodes[node].child + (sampleBins[_nodes[node].attribute] > _splitBins[node] ? 1 : 0);
+				nodes[i] = node;
+			}
+
+			int slot = _slots[node];
+			if (slot < 0)
+				continue;
+
+			//add the sample to the bin of every attribute.
+			BinSums* histogram = &_histograms[(size_t)slot * _histogramSize];
+			float weight = weights[i];
+			if (y[i] == classIndex)
+			{
+				for (int a = 0; a < n; a++)
+				{
+					BinSums& sums = histogram[_offsets[a] + sampleBins[a]];
+					sums.positiveWeight += weight;
+					sums.positiveCount++;
+				}
+				_sums[slot].positiveWeight += weight;
+				_sums[slot].positiveCount++;
+			}
+			else
+			{
+				for (int a = 0; a < n; a++)
+				{
+					BinSums& sums = histogram[_offsets[a] + sampleBins[a]];
+					sums.negativeWeight += weight;
+					sums.negativeCount++;
+				}
+				_sums[slot].negativeWeight += weight;
+				_sums[slot].negativeCount++;
+			}
+		}
+
+		if (create || route)
+		{
+			nodeFile.seekp(offset, std::ios::beg);
+			nodeFile.write((const char*)nodes.data(), sizeof(int32_t) * count);
+		}
+		position += count;
+	}
+
+	_numPasses++;
+	if (!nodeFile.good() || position != _reader.numSamples())
+		return false;
+
+	//every field of the sums is a double.
+	if (_allreduce != nullptr)
+		return _allreduce->sum((double*)_histograms.data(), _histograms.size() * 4) && _allreduce->sum((double*)_sums.data(), _sums.size() * 4);
+	return true;
+}
+
+bool OutOfCoreTree::splittable(const BinSums& sums, int depth)
+{
+	if (sums.positiveCount == 0 || sums.negativeCount == 0)
+		return false;
+	if (_limits.maxDepth > 0 && depth >= _limits.maxDepth)
+		return false;
+	return sums.positiveCount + sums.negativeCount >= 2 * _limits.minSamplesLeaf;
+}
+
+bool OutOfCoreTree::findSplit(const BinSums* histograms, const BinSums& sums, int depth, LevelSplit& split)
+{
+	if (!splittable(sums, depth))
+		return false;
+
+	double weightSum = sums.positiveWeight + sums.negativeWeight;
+	double count = sums.positiveCount + sums.negativeCount;
+	if (weightSum <= 0.0)
+		return false;
+
+	//sweep the bins of every attribute, the children entropy of a bin edge follows from the prefix sums.
+	int minSamplesLeaf = std::max(_limits.minSamplesLeaf, 1);
+	double minChildEntropy = DBL_MAX;
+	for (int a = 0; a < _reader.n(); a++)
+	{
+		const BinSums* histogram = &histograms[_offsets[a]];
+		BinSums left = { 0.0, 0.0, 0.0, 0.0 };
+		for (int b = 0; b < _reader.bins().numBins(a) - 1; b++)
+		{
+			left.positiveWeight += histogram[b].positiveWeight;
+			left.negativeWeight += histogram[b].negativeWeight;
+			left.positiveCount += histogram[b].positiveCount;
+			left.negativeCount += histogram[b].negativeCount;
+
+			double leftCount = left.positiveCount + left.negativeCount;
+			if (leftCount < minSamplesLeaf || count - leftCount < minSamplesLeaf)
+				continue;
+
+			double leftWeight = left.positiveWeight + left.negativeWeight;
+			double rightWeight = weightSum - leftWeight;
+			if (leftWeight < _limits.minWeightLeaf || rightWeight < _limits.minWeightLeaf)
+				continue;
+
+			double childEntropy = 0.0;
+			if (leftWeight > 0.0)
+				childEntropy += leftWeight * binaryEntropy(left.positiveWeight / leftWeight);
+			if (rightWeight > 0.0)
+				childEntropy += rightWeight * binaryEntropy((sums.positiveWeight - left.positiveWeight) / rightWeight);
+
+			if (childEntropy < minChildEntropy)
+			{
+				minChildEntropy = childEntropy;
+				split.attribute = a;
+				split.bin = b;
+				split.children[0] = left;
+			}
+		}
+	}
+
+	if (minChildEntropy == DBL_MAX)
+		return false;
+
+	split.gain = (float)(binaryEntropy(sums.positiveWeight / weightSum) - minChildEntropy / weightSum);
+	if (split.gain < _limits.minInformationGain)
+		return false;
+
+	split.weight = weightSum;
+	split.children[1].positiveWeight = sums.positiveWeight - split.children[0].positiveWeight;
+	split.children[1].negativeWeight = sums.negativeWeight - split.children[0].negativeWeight;
+	split.children[1].positiveCount = sums.positiveCount - split.children[0].positiveCount;
+	split.children[1].negativeCount = sums.negativeCount - split.children[0].negativeCount;
+	return true;
+}
\ No newline at end of file
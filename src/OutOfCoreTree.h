@@ -0,0 +1,191 @@
+/*
+OutOfCoreTree.h
+Training of decision trees on binned sample files which do not fit in memory. The tree is grown level
+by level: every level streams the binned file once, in chunks, and accumulates the histograms of every
+node of the level at the same time. The node of every sample is kept in a node file of one int32 per
+sample, read and written in lockstep with the chunks of the binned file, so the memory used is bounded
+by the chunks and the histograms, independent of the number of samples.
+
+Binned sample file layout, all values little endian:
+	header: uint32 magic, uint32 version, int32 n, int32 reserved, int64 numSamples.
+	bins: for every attribute, int32 numEdges, float edges[numEdges], the edges of AttributeBins.
+	records: int32 y, float weight, uint8 bin[n].
+
+The bins of a sample file are computed in one pass, e.g. from the quantile sketches of QuantileSketch.h,
+and the binned file is written in a second pass by writeBinnedSampleFile.
+
+A training set may also be split into shards of binned files with the same bins, each trained on by a
+worker process. The histograms of every level are then summed over the workers by Allreduce.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+#include <SampleStream.h>
+#include <Binning.h>
+#include <DecisionTree.h>
+#include <Allreduce.h>
+
+#define BINNED_FILE_MAGIC 0x4d534e42
+#define BINNED_FILE_VERSION 1
+
+//default memory of the histograms of a level, in bytes. Larger levels take several passes.
+#define OUT_OF_CORE_HISTOGRAM_BYTES (256 << 20)
+
+/*
+Writes the samples of a stream to a binned sample file, with the bins of every attribute.
+Returns false if the file could not be written.
+*/
+bool writeBinnedSampleFile(const std::string& path, SampleReader& reader, AttributeBins& bins, int chunkSize = SAMPLE_CHUNK_SIZE);
+
+/*
+BinnedSampleReader. Reads a binned sample file in chunks.
+*/
+class BinnedSampleReader
+{
+public:
+	BinnedSampleReader(const std::string& path);
+	~BinnedSampleReader();
+
+	/*
+	Returns the number of attributes of each sample, 0 if the file is not valid.
+	*/
+	int n();
+	long long numSamples();
+
+	/*
+	Returns the bins of the file.
+	*/
+	AttributeBins& bins();
+
+	/*
+	Reads the next samples of the file, at most 'maxSamples', into the labels, the weights and the bins
+	of the samples, stored sample by sample. Returns the number of samples read, 0 at the end of the file.
+	*/
+	int read(int maxSamples, int32_t* y, float* weights, uint8_t* sampleBins);
+
+	/*
+	Restarts the stream at the first sample.
+	*/
+	void rewind();
+
+private:
+	std::ifstream _file;
+	int _n;
+	long long _numSamples;
+	long long _position;	//index of the next sample read.
+	std::streamoff _recordsOffset;	//offset of the first record.
+	std::vector<char> _buffer;
+	AttributeBins _bins;
+};
+
+class OutOfCoreTree
+{
+public:
+	/*
+	Trains on the binned sample file at 'path'. The node of every sample is stored in a file at
+	'nodePath', which is overwritten.
+	*/
+	OutOfCoreTree(const std::string& path, const std::string& nodePath);
+	~OutOfCoreTree();
+
+	/*
+	Sets the growth limits of the trees. The trees always grow level by level, leafWise is ignored, and
+	maxLeaves keeps the splits of the largest gains of the last level.
+	*/
+	void setGrowthLimits(const TreeGrowthLimits& limits);
+
+	/*
+	Sets the number of samples of a chunk, and the memory of the histograms of a level, in bytes.
+	*/
+	void setChunkSize(int chunkSize);
+	void setHistogramBytes(size_t histogramBytes);
+
+	/*
+	Trains on the shard of the worker of 'allreduce', one of the shards of a training set binned with the
+	same bins. The histograms of every level are summed over the workers, so every worker grows the tree
+	of the whole training set. Every worker must call train with the same settings. nullptr trains on
+	the file alone.
+	*/
+	void setAllreduce(Allreduce* allreduce);
+
+	/*
+	Trains a tree of class 'classIndex' on the samples of the file, weighted by their weights in the file,
+	and stores it in 'tree'. The splits are x > edge, at the bin edges of the file. Returns false if the
+	files could not be read or written, or a worker failed.
+	*/
+	bool train(int classIndex, DecisionTree& tree);
+
+	/*
+	Returns the number of passes over the binned file of the last call to train.
+	*/
+	int numPasses();
+
+	/*
+	Returns the number of samples of the binned file, 0 if it is not valid.
+	*/
+	long long numSamples();
+
+private:
+	/*
+	Sums of the samples of a node in a bin. Every field is a double, so that the histograms are summed
+	by Allreduce as an array of doubles. The counts are exact up to 2^53.
+	*/
+	struct BinSums
+	{
+		double positiveWeight;
+		double negativeWeight;
+		double positiveCount;
+		double negativeCount;
+	};
+
+	/*
+	Split of a node found on its histograms.
+	*/
+	struct LevelSplit
+	{
+		int node;
+		int attribute;
+		int bin;
+		float gain;
+		double weight;
+		BinSums children[2];
+	};
+
+	/*
+	Streams the binned file once, moving every sample of a node split at the previous level to its child
+	if 'route', and accumulates the histograms of the nodes of the level in [begin, end), summed over
+	the workers if distributed.
+	*/
+	bool accumulate(int classIndex, const std::vector<int>& level, int begin, int end, bool route);
+
+	/*
+	Finds the best split of the histograms of a node, on the bin edges. Returns false if the node is a leaf.
+	*/
+	bool findSplit(const BinSums* histograms, const BinSums& sums, int depth, LevelSplit& split);
+
+	/*
+	Returns true if a node of the sums may be split at 'depth'.
+	*/
+	bool splittable(const BinSums& sums, int depth);
+
+	BinnedSampleReader _reader;
+	std::string _nodePath;
+	TreeGrowthLimits _limits;
+	int _chunkSize;
+	size_t _histogramBytes;
+	int _numPasses;
+	Allreduce* _allreduce;
+
+	std::vector<int> _offsets;	//offset of the bins of every attribute in a histogram.
+	int _histogramSize;	//number of bins of all the attributes.
+
+	//tree state of the current call to train.
+	std::vector<DecisionTreeNode> _nodes;
+	std::vector<int> _splitBins;	//bin of the split of every split node, a sample goes to child + 1 above it.
+	std::vector<int> _slots;	//histogram slot of every node of the level in the current pass, -1 else.
+	std::vector<BinSums> _histograms;
+	std::vector<BinSums> _sums;	//sums of every node of the level in the current pass.
+};
\ No newline at end of file
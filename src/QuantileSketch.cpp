@@ -0,0 +1,241 @@
+#include <QuantileSketch.h>
+#include <ThreadPool.h>
+#include <algorithm>
+
+QuantileSketch::QuantileSketch(int k, unsigned int seed) : _random(seed)
+{
+	_k = std::max(k, 8);
+	clear();
+}
+
+void QuantileSketch::clear()
+{
+	_levels.clear();
+	resizeLevels(1);
+	_size = 0;
+	_count = 0;
+}
+
+void QuantileSketch::resizeLevels(int numLevels)
+{
+	_levels.resize(numLevels);
+	_capacities.resize(numLevels);
+	_capacity = 0;
+	for (int h = 0; h < numLevels; h++)
+	{
+		int depth = numLevels - 1 - h;
+		_capacities[h] = std::max(2, (int)ceil(_k * pow(2.0 / 3.0, depth)));
+		_capacity += _capacities[h];
+	}
+}
+
+void QuantileSketch::add(float x)
+{
+	if (x != x)
+		return;
+
+	_levels[0].push_back(x);
+	_size++;
+	_count++;
+	if (_size >= _capacity)
+		compress();
+}
+
+void QuantileSketch::compress()
+{
+	while (_size >= _capacity)
+	{
+		//compact the lowest level at its capacity.
+		int h = 0;
+		while (_levels[h].size() < _capacities[h])
+			h++;
+		if (h + 1 == _levels.size())
+			resizeLevels(_levels.size() + 1);
+
+		std::vector<float>& level = _levels[h];
+		std::vector<float>& nextLevel = _levels[h + 1];
+		std::sort(level.begin(), level.end());
+
+		//an odd value out, the largest, stays in the level.
+		int numCompacted = level.size() & ~1;
+		int offset = _random() & 1;
+		for (int i = offset; i < numCompacted; i += 2)
+			nextLevel.push_back(level[i]);
+
+		if (numCompacted < level.size())
+		{
+			float last = level.back();
+			level.clear();
+			level.push_back(last);
+		}
+		else
+			level.clear();
+		_size -= numCompacted / 2;
+	}
+}
+
+bool QuantileSketch::merge(const QuantileSketch& other)
+{
+	if (other._k != _k)
+		return false;
+
+	if (other._levels.size() > _levels.size())
+		resizeLevels(other._levels.size());
+	for (int h = 0; h < other._levels.size(); h++)
+		_levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+
+	_size += other._size;
+	_count += other._count;
+	compress();
+	return true;
+}
+
+void QuantileSketch::sortedValues(std::vector<std::pair<float, long long>>& values)
+{
+	values.clear();
+	values.reserve(_size);
+	for (int h = 0; h < _levels.size(); h++)
+	{
+		for (int i = 0; i < _levels[h].size(); i++)
+			values.push_back(std::make_pair(_levels[h][i], 1LL << h));
+	}
+	std::sort(values.begin(), values.end());
+}
+
+float QuantileSketch::quantile(double rank)
+{
+	std::vector<std::pair<float, long long>> values;
+	sortedValues(values);
+	if (values.size() == 0)
+		return 0.0f;
+
+	long long totalWeight = 0;
+	for (int i = 0; i < values.size(); i++)
+		totalWeight += values[i].second;
+
+	double target = rank * (double)totalWeight;
+	long long weight = 0;
+	for (int i = 0; i < values.size(); i++)
+	{
+		weight += values[i].second;
+		if ((double)weight >= target)
+			return values[i].first;
+	}
+	return values.back().first;
+}
+
+std::vector<float> QuantileSketch::quantiles(int numQuantiles)
+{
+	std::vector<float> result;
+	std::vector<std::pair<float, long long>> values;
+	sortedValues(values);
+	if (values.size() == 0)
+		return result;
+
+	long long totalWeight = 0;
+	for (int i = 0; i < values.size(); i++)
+		totalWeight += values[i].second;
+
+	//a single pass over the sorted values, the ranks are increasing.
+	int i = 0;
+	long long weight = values[0].second;
+	for (int q = 1; q < numQuantiles; q++)
+	{
+		double target = (double)q / (double)numQuantiles * (double)totalWeight;
+		while ((double)weight < target && i + 1 < values.size())
+			weight += values[++i].second;
+		result.push_back(values[i].first);
+	}
+	return result;
+}
+
+AttributeSketches::AttributeSketches(int n, int k, unsigned int seed)
+{
+	for (int a = 0; a < n; a++)
+		_sketches.push_back(QuantileSketch(k, seed + a));
+}
+
+AttributeSketches::AttributeSketches(std::vector<Sample*>& samples, int k, int numThreads)
+{
+	int n = (samples.size() > 0) ? samples[0]->n() : 0;
+	for (int a = 0; a < n; a++)
+		_sketches.push_back(QuantileSketch(k, a));
+
+	int numChunks = (samples.size() + SKETCH_CHUNK_SIZE - 1) / SKETCH_CHUNK_SIZE;
+	if (numChunks <= 1)
+	{
+		add(samples, 0, samples.size());
+		return;
+	}
+
+	//the sketches of chunk c are seeded from c, the merge order is the chunk order.
+	std::vector<AttributeSketches*> chunkSketches(numChunks, nullptr);
+	ThreadPool threadPool(numThreads);
+	threadPool.parallelFor(numChunks, [&](int c)
+	{
+		AttributeSketches* sketches = new AttributeSketches(n, k, (unsigned int)c * n);
+		sketches->add(samples, c * SKETCH_CHUNK_SIZE, std::min((int)samples.size(), (c + 1) * SKETCH_CHUNK_SIZE));
+		chunkSketches[c] = sketches;
+	});
+
+	for (int c = 0; c < numChunks; c++)
+	{
+		merge(*chunkSketches[c]);
+		delete chunkSketches[c];
+	}
+}
+
+void AttributeSketches::add(const float* x)
+{
+	for (int a = 0; a < _sketches.size(); a++)
+		_sketches[a].add(x[a]);
+}
+
+void AttributeSketches::add(std::vector<Sample*>& samples, int begin, int end)
+{
+	for (int a = 0; a < _sketches.size(); a++)
+	{
+		QuantileSketch& sketch = _sketches[a];
+		for (int i = begin; i < end; i++)
+			sketch.add(samples[i]->x(a));
+	}
+}
+
+void AttributeSketches::add(SampleReader& reader, int chunkSize)
+{
+	SampleChunk chunk;
+	chunk.reserve(reader.n(), chunkSize);
+	while (reader.read(chunk, chunkSize) > 0)
+	{
+		for (int i = 0; i < chunk.size(); i++)
+			add(chunk.x(i));
+	}
+}
+
+bool AttributeSketches::merge(AttributeSketches& other)
+{
+	if (other.n() != n())
+		return false;
+
+	for (int a = 0; a < _sketches.size(); a++)
+	{
+		if (!_sketches[a].merge(other._sketches[a]))
+			return false;
+	}
+	return true;
+}
+
+AttributeBins AttributeSketches::bins(int numBins)
+{
+	numBins = std::max(1, std::min(numBins, MAX_BINS));
+
+	AttributeBins attributeBins;
+	attributeBins.resize(n());
+	for (int a = 0; a < n(); a++)
+	{
+		//the upper edge of bin b is the quantile (b + 1) / numBins.
+		std::vector<float> edges = _sketches[a].quantiles(numBins);
+		attributeBins.setEdges(a, edges);
+	}
+	return attributeBins;
+}
\ No newline at end of file
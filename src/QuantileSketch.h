@@ -0,0 +1,154 @@
+/*
+QuantileSketch.h
+Streaming quantile sketch of the KLL algorithm (Karnin, Lang and Liberty). The sketch holds a bounded
+number of values in levels, a value of level h standing for 2^h values of the stream. When the sketch is
+full, the lowest full level is sorted and every other value, from a random offset, moves up a level.
+The capacities of the levels decrease geometrically from the top, so the sketch holds O(k) values, and
+the rank error of a quantile is O(1 / k) of the number of values with high probability.
+
+Sketches of separate parts of a stream, e.g. chunks sketched by threads, or shards read by separate
+processes, are combined with merge, with the same error bound as a single sketch of the whole stream.
+The random offsets are drawn from a generator seeded by the constructor, so a sketch is reproducible.
+
+AttributeSketches holds a sketch per attribute of a training set, and computes the AttributeBins of the
+quantiles of every attribute: bins with equal numbers of values, which follow the distribution of the
+values instead of their range.
+*/
+
+#pragma once
+#include <vector>
+#include <random>
+#include <Binning.h>
+#include <SampleStream.h>
+
+//default size parameter k of a sketch, the capacity of its top level.
+#define KLL_K 200
+
+//number of samples sketched by a task when a training set is sketched in parallel.
+#define SKETCH_CHUNK_SIZE 65536
+
+class QuantileSketch
+{
+public:
+	QuantileSketch(int k = KLL_K, unsigned int seed = 0);
+
+	/*
+	Adds a value to the sketch. NaN values are ignored.
+	*/
+	void add(float x);
+
+	/*
+	Adds the values of 'other' to the sketch. Returns false if the sketches have different sizes k.
+	*/
+	bool merge(const QuantileSketch& other);
+
+	/*
+	Returns the value of rank 'rank' in [0, 1], the smallest value of the sketch which is larger than or
+	equal to a fraction 'rank' of the values. Returns 0 for an empty sketch.
+	*/
+	float quantile(double rank);
+
+	/*
+	Returns the values of the ranks i / numQuantiles, for i in [1, numQuantiles - 1], in increasing order.
+	*/
+	std::vector<float> quantiles(int numQuantiles);
+
+	/*
+	Returns the number of values added to the sketch.
+	*/
+	long long count()
+	{
+		return _count;
+	}
+
+	/*
+	Returns the number of values held by the sketch.
+	*/
+	int size()
+	{
+		return _size;
+	}
+
+	void clear();
+
+private:
+	/*
+	Resizes the sketch to 'numLevels' levels, and computes the capacity of every level, k (2/3)^d for
+	a level at depth d below the top level, at least 2. The capacities only change with the levels.
+	*/
+	void resizeLevels(int numLevels);
+
+	/*
+	Compacts the lowest full levels until the sketch is below its capacity.
+	*/
+	void compress();
+
+	/*
+	Returns the values of the sketch in increasing order, with the weight 2^h of their level.
+	*/
+	void sortedValues(std::vector<std::pair<float, long long>>& values);
+
+	std::vector<std::vector<float>> _levels;	//values of each level, a value of level h has weight 2^h.
+	std::vector<int> _capacities;	//capacity of each level.
+	int _capacity;	//sum of the capacities of the levels.
+	int _k;
+	int _size;	//number of values held by the levels.
+	long long _count;	//number of values added.
+	std::minstd_rand _random;
+};
+
+class AttributeSketches
+{
+public:
+	/*
+	Creates empty sketches for 'n' attributes.
+	*/
+	AttributeSketches(int n, int k = KLL_K, unsigned int seed = 0);
+
+	/*
+	Sketches the attributes of a training set. The training set is split into chunks of SKETCH_CHUNK_SIZE
+	samples, sketched on 'numThreads' threads (0 for every hardware thread) and merged in order, so the
+	sketches do not depend on the number of threads.
+	*/
+	AttributeSketches(std::vector<Sample*>& samples, int k = KLL_K, int numThreads = 1);
+
+	/*
+	Adds the attributes of a sample.
+	*/
+	void add(const float* x);
+
+	/*
+	Adds the attributes of the samples in [begin, end) of a training set.
+	*/
+	void add(std::vector<Sample*>& samples, int begin, int end);
+
+	/*
+	Adds the attributes of every sample of a stream, read in chunks of 'chunkSize' samples, e.g. of a
+	sample file which does not fit in memory.
+	*/
+	void add(SampleReader& reader, int chunkSize = SAMPLE_CHUNK_SIZE);
+
+	/*
+	Adds the sketches of 'other'. Returns false if the number of attributes or the sketch sizes differ.
+	*/
+	bool merge(AttributeSketches& other);
+
+	/*
+	Returns the bins of the quantiles of every attribute, at most 'numBins' bins per attribute. Bins of
+	repeated values are merged, so an attribute with few distinct values has fewer bins.
+	*/
+	AttributeBins bins(int numBins);
+
+	QuantileSketch& sketch(int attribute)
+	{
+		return _sketches[attribute];
+	}
+
+	int n()
+	{
+		return _sketches.size();
+	}
+
+private:
+	std::vector<QuantileSketch> _sketches;
+};
\ No newline at end of file
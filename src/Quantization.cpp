@@ -0,0 +1,164 @@
+#include <Quantization.h>
+#include <Simd.h>
+#include <cmath>
+#include <cstring>
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	//NaN.
+	if (magnitude > 0x7f800000)
+		return sign | 0x7e00;
+
+	//saturate to the largest half, 65504.
+	if (magnitude >= 0x477ff000)
+		return sign | 0x7bff;
+
+	//subnormal half, round the value scaled by 2^24 to an integer.
+	if (magnitude < 0x38800000)
+	{
+		float f;
+		memcpy(&f, &magnitude, sizeof(f));
+		return sign | (uint16_t)lrintf(f * 16777216.0f);
+	}
+
+	//normal half, round the mantissa to 10 bits, to even.
+	uint32_t rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+	return sign | (uint16_t)((rounded - 0x38000000) >> 13);
+}
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+
+	//rebias the exponent from 15 to 127.
+	uint32_t bits = ((uint32_t)(value & 0x7fff) << 13) + (112 << 23);
+	float f;
+
+	//subnormal half, normalized by a subtraction of normal floats.
+	if ((value & 0x7c00) == 0)
+	{
+		bits += 1 << 23;
+		memcpy(&f, &bits, sizeof(f));
+		f -= 6.103515625e-05f;	//2^-14
+		memcpy(&bits, &f, sizeof(bits));
+	}
+
+	bits |= sign;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+QuantizedArray::QuantizedArray(const float* values, int count, QuantizationType type)
+{
+	_type = type;
+	_count = count;
+	_scale = 1.0f;
+	_int8 = nullptr;
+	_half = nullptr;
+
+	int paddedCount = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	if (type == QUANTIZE_INT8)
+	{
+		float maxValue = 0.0f;
+		for (int i = 0; i < count; i++)
+			maxValue = fmax(maxValue, fabs(values[i]));
+		if (maxValue > 0.0f)
+			_scale = maxValue / 127.0f;
+
+		_int8 = new int8_t[paddedCount];
+		for (int i = 0; i < paddedCount; i++)
+			_int8[i] = (i < count) ? (int8_t)lrintf(values[i] / _scale) : 0;
+	}
+	else
+	{
+		_type = QUANTIZE_FP16;
+		_half = new uint16_t[paddedCount];
+		for (int i = 0; i < paddedCount; i++)
+			_half[i] = (i < count) ? floatToHalf(values[i]) : 0;
+	}
+}
+
+QuantizedArray::~QuantizedArray()
+{
+	delete[] _int8;
+	delete[] _half;
+}
+
+float QuantizedArray::value(int index)
+{
+	if (_type == QUANTIZE_INT8)
+		return _int8[index] * _scale;
+	return halfToFloat(_half[index]);
+}
+
+void QuantizedArray::dequantize(float* values)
+{
+	dequantize(values, 0, _count);
+}
+
+void QuantizedArray::dequantize(float* values, int begin, int count)
+{
+	int vectorCount = (begin % SIMD_WIDTH == 0) ? count / SIMD_WIDTH * SIMD_WIDTH : 0;
+	if (_type == QUANTIZE_INT8)
+	{
+		FloatVector scale = simdSet(_scale);
+		for (int i = 0; i < vectorCount; i += SIMD_WIDTH)
+			simdStore(&values[i], simdMul(simdLoadInt8(&_int8[begin + i]), scale));
+	}
+	else
+	{
+		for (int i = 0; i < vectorCount; i += SIMD_WIDTH)
+			simdStore(&values[i], simdLoadHalf(&_half[begin + i]));
+	}
+
+	for (int i = vectorCount; i < count; i++)
+		values[i] = value(begin + i);
+}
+
+/*
+The quantized values are converted to floats in the vector registers, 4 at a time. The int8
+values are summed unscaled, and the sum is scaled once.
+*/
+float QuantizedArray::dot(const float* x)
+{
+	int vectorCount = _count / SIMD_WIDTH * SIMD_WIDTH;
+	FloatVector sum = simdSet(0.0f);
+	float tail = 0.0f;
+	if (_type == QUANTIZE_INT8)
+	{
+		for (int i = 0; i < vectorCount; i += SIMD_WIDTH)
+			sum = simdMulAdd(simdLoadInt8(&_int8[i]), simdLoad(&x[i]), sum);
+		for (int i = vectorCount; i < _count; i++)
+			tail += _int8[i] * x[i];
+		return (simdSum(sum) + tail) * _scale;
+	}
+
+	for (int i = 0; i < vectorCount; i += SIMD_WIDTH)
+		sum = simdMulAdd(simdLoadHalf(&_half[i]), simdLoad(&x[i]), sum);
+	for (int i = vectorCount; i < _count; i++)
+		tail += halfToFloat(_half[i]) * x[i];
+	return simdSum(sum) + tail;
+}
+
+int QuantizedArray::size()
+{
+	return _count;
+}
+
+QuantizationType QuantizedArray::type()
+{
+	return _type;
+}
+
+size_t QuantizedArray::sizeInBytes()
+{
+	int paddedCount = (_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	if (_type == QUANTIZE_INT8)
+		return paddedCount * sizeof(int8_t) + sizeof(_scale);
+	return paddedCount * sizeof(uint16_t);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+Quantization.h
+Post training quantization of the parameters used for inference. A quantized array stores its
+values as half precision floats, or as 8 bit integers with a scale factor, q = round(v / scale),
+scale = max(|v|) / 127. Inference kernels read the quantized values directly, a model takes a half
+or a quarter of the memory of its float parameters, so that many models stay cache resident.
+
+Worst case errors of a value v of an array with maximum magnitude m:
+	QUANTIZE_FP16: relative error 2^-11 for |v| >= 6.1e-5, values above 65504 saturate.
+	QUANTIZE_INT8: absolute error m / 254.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+
+enum QuantizationType
+{
+	QUANTIZE_NONE,	//float parameters.
+	QUANTIZE_FP16,	//half precision floats.
+	QUANTIZE_INT8	//8 bit integers with a scale factor per array.
+};
+
+/*
+Converts a float to the nearest half precision float, rounding to even.
+*/
+uint16_t floatToHalf(float value);
+
+/*
+Converts a half precision float to a float. Infinities and NaNs are not preserved.
+*/
+float halfToFloat(uint16_t value);
+
+/*
+QuantizedArray. Array of quantized values.
+*/
+class QuantizedArray
+{
+public:
+	/*
+	Constructor:
+	const float* values: values quantized, 'count' values.
+	QuantizationType type: QUANTIZE_FP16 or QUANTIZE_INT8.
+	*/
+	QuantizedArray(const float* values, int count, QuantizationType type);
+	~QuantizedArray();
+
+	/*
+	Returns the dequantized value at 'index'.
+	*/
+	float value(int index);
+
+	/*
+	Stores the dequantized values in 'values'.
+	*/
+	void dequantize(float* values);
+
+	/*
+	Stores the 'count' dequantized values from index 'begin' in 'values', e.g. a block of the values
+	dequantized into a stack buffer. A begin which is a multiple of SIMD_WIDTH uses the SIMD kernels.
+	*/
+	void dequantize(float* values, int begin, int count);
+
+	/*
+	Returns the inner product of the dequantized values with x, computed with the SIMD kernels.
+	*/
+	float dot(const float* x);
+
+	int size();
+	QuantizationType type();
+
+	/*
+	Returns the size in bytes of the quantized values and the scale factor.
+	*/
+	size_t sizeInBytes();
+
+private:
+	QuantizedArray(const QuantizedArray&);
+	QuantizedArray& operator=(const QuantizedArray&);
+
+	QuantizationType _type;
+	int _count;
+	float _scale;	//scale factor of the 8 bit integers.
+	int8_t* _int8;	//values, padded with zeros to a multiple of SIMD_WIDTH.
+	uint16_t* _half;
+};
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <SampleStream.h>
+#include <cstring>
+#include <algorithm>
+
+/*
+Header of a sample file.
+*/
+struct SampleFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t n;
+	int32_t reserved;
+	int64_t numSamples;
+};
+
+/*
+Returns the size in bytes of a sample record with n attributes.
+*/
+static size_t recordSize(int n)
+{
+	return sizeof(int32_t) + sizeof(float) + sizeof(float) * n;
+}
+
+/*
+Copies the record at 'record' into the chunk.
+*/
+static void addRecord(SampleChunk& chunk, const char* record, float* x)
+{
+	int32_t y;
+	float weight;
+	memcpy(&y, record, sizeof(int32_t));
+	memcpy(&weight, record + sizeof(int32_t), sizeof(float));
+	memcpy(x, record + sizeof(int32_t) + sizeof(float), sizeof(float) * chunk.n());
+	chunk.add(x, y, weight);
+}
+
+SampleChunk::SampleChunk()
+{
+	_x = nullptr;
+	_y = nullptr;
+	_weights = nullptr;
+	_n = 0;
+	_size = 0;
+	_capacity = 0;
+}
+
+SampleChunk::~SampleChunk()
+{
+	delete[] _x;
+	delete[] _y;
+	delete[] _weights;
+}
+
+void SampleChunk::reserve(int n, int capacity)
+{
+	if (n != _n || capacity > _capacity)
+	{
+		delete[] _x;
+		delete[] _y;
+		delete[] _weights;
+		_x = new float[(size_t)n * capacity];
+		_y = new int[capacity];
+		_weights = new float[capacity];
+		_n = n;
+		_capacity = capacity;
+	}
+	_size = 0;
+}
+
+bool SampleChunk::add(float* x, int y, float weight)
+{
+	if (_size >= _capacity)
+		return false;
+
+	float* dst = &_x[(size_t)_size * _n];
+	if (dst != x)
+		memcpy(dst, x, sizeof(float) * _n);
+	_y[_size] = y;
+	_weights[_size] = weight;
+	_size++;
+	return true;
+}
+
+void SampleChunk::clear()
+{
+	_size = 0;
+}
+
+FileSampleReader::FileSampleReader(const std::string& path)
+{
+	_n = 0;
+	_numSamples = 0;
+	_position = 0;
+
+	_file.open(path, std::ios::in | std::ios::binary);
+	SampleFileHeader header;
+	if (!_file.read((char*)&header, sizeof(header)))
+		return;
+	if (header.magic != SAMPLE_FILE_MAGIC || header.version != SAMPLE_FILE_VERSION || header.n <= 0)
+		return;
+
+	_n = header.n;
+	_numSamples = header.numSamples;
+}
+
+FileSampleReader::~FileSampleReader()
+{
+}
+
+int FileSampleReader::n()
+{
+	return _n;
+}
+
+long long FileSampleReader::numSamples()
+{
+	return _numSamples;
+}
+
+int FileSampleReader::read(SampleChunk& chunk, int maxSamples)
+{
+	chunk.reserve(_n, maxSamples);
+	if (_n == 0 || _position >= _numSamples)
+		return 0;
+
+	int count = (int)std::min((long long)maxSamples, _numSamples - _position);
+	size_t size = recordSize(_n);
+	_buffer.resize(size * count);
+	if (!_file.read(_buffer.data(), _buffer.size()))
+		count = _file.gcount() / size;
+
+	for (int i = 0; i < count; i++)
+	{
+		//decode the record directly into the chunk buffer.
+		float* x = chunk.x(i);
+		addRecord(chunk, &_buffer[size * i], x);
+	}
+	_position += count;
+	return count;
+}
+
+void FileSampleReader::rewind()
+{
+	_file.clear();
+	_file.seekg(sizeof(SampleFileHeader), std::ios::beg);
+	_position = 0;
+}
+
+MemorySampleReader::MemorySampleReader(const char* data, size_t size)
+{
+	_data = data;
+	_n = 0;
+	_numSamples = 0;
+	_position = 0;
+
+	SampleFileHeader header;
+	if (data == nullptr || size < sizeof(header))
+		return;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != SAMPLE_FILE_MAGIC || header.version != SAMPLE_FILE_VERSION || header.n <= 0)
+		return;
+
+	//only expose the complete records of the region.
+	_n = header.n;
+	_numSamples = std::min((long long)header.numSamples, (long long)((size - sizeof(header)) / recordSize(_n)));
+}
+
+MemorySampleReader::~MemorySampleReader()
+{
+}
+
+int MemorySampleReader::n()
+{
+	return _n;
+}
+
+long long MemorySampleReader::numSamples()
+{
+	return _numSamples;
+}
+
+int MemorySampleReader::read(SampleChunk& chunk, int maxSamples)
+{
+	chunk.reserve(_n, maxSamples);
+	if (_n == 0 || _position >= _numSamples)
+		return 0;
+
+	int count = (int)std::min((long long)maxSamples, _numSamples - _position);
+	size_t size = recordSize(_n);
+	const char* record = _data + sizeof(SampleFileHeader) + size * _position;
+	for (int i = 0; i < count; i++)
+		addRecord(chunk, record + size * i, chunk.x(i));
+
+	_position += count;
+	return count;
+}
+
+void MemorySampleReader::rewind()
+{
+	_position = 0;
+}
+
+/*
+Writes the samples and their weights to a sample file. If sampleWeights is nullptr, every sample
+has a weight of 1. Returns false if the file could not be written.
+*/
+bool writeSampleFile(const std::string& path, std::vector<Sample*>& samples, float* sampleWeights)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open() || samples.size() == 0)
+		return false;
+
+	SampleFileHeader header;
+	header.magic = SAMPLE_FILE_MAGIC;
+	header.version = SAMPLE_FILE_VERSION;
+	header.n = samples[0]->n();
+	header.reserved = 0;
+	header.numSamples = samples.size();
+	file.write((const char*)&header, sizeof(header));
+
+	for (int i = 0; i < samples.size(); i++)
+	{
+		int32_t y = samples[i]->y();
+		float weight = (sampleWeights != nullptr) ? sampleWeights[i] : 1.0f;
+		file.write((const char*)&y, sizeof(int32_t));
+		file.write((const char*)&weight, sizeof(float));
+		file.write((const char*)samples[i]->data(), sizeof(float) * header.n);
+	}
+	return file.good();
+}
\ No newline at end of file
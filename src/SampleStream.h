@@ -0,0 +1,157 @@
+/*
+SampleStream.h
+Chunked access to training sets which are stored in a binary sample file, or in a memory region
+holding the same layout (e.g. a memory mapped sample file). Allows training with a bounded amount
+of memory, independent of the size of the training set.
+
+Sample file layout, all values little endian:
+	header: uint32 magic, uint32 version, int32 n, int32 reserved, int64 numSamples.
+	records: int32 y, float weight, float x[n].
+*/
+
+#pragma once
+#include <Sample.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+#define SAMPLE_FILE_MAGIC 0x4c504d53
+#define SAMPLE_FILE_VERSION 1
+
+//default number of samples read in a single chunk.
+#define SAMPLE_CHUNK_SIZE 4096
+
+/*
+SampleChunk. Contiguous buffer holding a chunk of samples read from a stream.
+*/
+class SampleChunk
+{
+public:
+	SampleChunk();
+	~SampleChunk();
+
+	/*
+	Allocates the buffers for 'capacity' samples of 'n' attributes, and clears the chunk.
+	*/
+	void reserve(int n, int capacity);
+
+	/*
+	Appends a sample to the chunk. Returns false if the chunk is full.
+	*/
+	bool add(float* x, int y, float weight);
+
+	void clear();
+
+	/*
+	Getters.
+	*/
+	float* x(int i)
+	{
+		return &_x[(size_t)i * _n];
+	}
+	int y(int i)
+	{
+		return _y[i];
+	}
+	float weight(int i)
+	{
+		return _weights[i];
+	}
+	int size()
+	{
+		return _size;
+	}
+	int n()
+	{
+		return _n;
+	}
+
+private:
+	float* _x;	//sample attributes, stored row by row.
+	int* _y;
+	float* _weights;
+	int _n;
+	int _size;
+	int _capacity;
+};
+
+/*
+SampleReader. Base class of the sample streams.
+*/
+class SampleReader
+{
+public:
+	virtual ~SampleReader() {}
+
+	/*
+	Returns the number of attributes of each sample, 0 if the stream is not valid.
+	*/
+	virtual int n() = 0;
+
+	/*
+	Returns the total number of samples in the stream.
+	*/
+	virtual long long numSamples() = 0;
+
+	/*
+	Reads the next samples of the stream into 'chunk', at most 'maxSamples'.
+	Returns the number of samples read, 0 at the end of the stream.
+	*/
+	virtual int read(SampleChunk& chunk, int maxSamples) = 0;
+
+	/*
+	Restarts the stream at the first sample.
+	*/
+	virtual void rewind() = 0;
+};
+
+/*
+FileSampleReader. Reads a sample file in chunks.
+*/
+class FileSampleReader : public SampleReader
+{
+public:
+	FileSampleReader(const std::string& path);
+	virtual ~FileSampleReader();
+
+	virtual int n();
+	virtual long long numSamples();
+	virtual int read(SampleChunk& chunk, int maxSamples);
+	virtual void rewind();
+
+private:
+	std::ifstream _file;
+	int _n;
+	long long _numSamples;
+	long long _position;	//index of the next sample read.
+	std::vector<char> _buffer;
+};
+
+/*
+MemorySampleReader. Reads the samples of a memory region holding a sample file, e.g. a memory
+mapped file. The region is not owned, and must outlive the reader.
+*/
+class MemorySampleReader : public SampleReader
+{
+public:
+	MemorySampleReader(const char* data, size_t size);
+	virtual ~MemorySampleReader();
+
+	virtual int n();
+	virtual long long numSamples();
+	virtual int read(SampleChunk& chunk, int maxSamples);
+	virtual void rewind();
+
+private:
+	const char* _data;
+	int _n;
+	long long _numSamples;
+	long long _position;	//index of the next sample read.
+};
+
+/*
+Writes the samples and their weights to a sample file. If sampleWeights is nullptr, every sample
+has a weight of 1. Returns false if the file could not be written.
+*/
+bool writeSampleFile(const std::string& path, std::vector<Sample*>& samples, float* sampleWeights);
\ No newline at end of file
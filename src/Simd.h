@@ -0,0 +1,326 @@
+/*
+Simd.h
+Minimal wrapper over 4 wide single precision vector instructions, used by the batch inference
+kernels. SSE2 is used when available (every x64 target), otherwise a portable scalar fallback
+with the same interface. Quantized parameters are loaded with simdLoadInt8 and simdLoadHalf.
+
+simdExp and simdLog are fast polynomial approximations (Cephes), with a relative error of a few
+units in the last place of a float over the full range. The scalar fallback uses the standard
+library functions.
+*/
+
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+//number of floats in a vector.
+#define SIMD_WIDTH 4
+
+#ifdef SIMD_SSE2
+
+typedef __m128 FloatVector;
+
+inline FloatVector simdLoad(const float* x)
+{
+	return _mm_loadu_ps(x);
+}
+inline void simdStore(float* x, FloatVector v)
+{
+	_mm_storeu_ps(x, v);
+}
+inline FloatVector simdSet(float x)
+{
+	return _mm_set1_ps(x);
+}
+inline FloatVector simdSet(float x0, float x1, float x2, float x3)
+{
+	return _mm_setr_ps(x0, x1, x2, x3);
+}
+inline FloatVector simdAdd(FloatVector a, FloatVector b)
+{
+	return _mm_add_ps(a, b);
+}
+inline FloatVector simdSub(FloatVector a, FloatVector b)
+{
+	return _mm_sub_ps(a, b);
+}
+inline FloatVector simdMul(FloatVector a, FloatVector b)
+{
+	return _mm_mul_ps(a, b);
+}
+inline FloatVector simdDiv(FloatVector a, FloatVector b)
+{
+	return _mm_div_ps(a, b);
+}
+/*
+Returns a * b + c.
+*/
+inline FloatVector simdMulAdd(FloatVector a, FloatVector b, FloatVector c)
+{
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+inline FloatVector simdMax(FloatVector a, FloatVector b)
+{
+	return _mm_max_ps(a, b);
+}
+inline FloatVector simdMin(FloatVector a, FloatVector b)
+{
+	return _mm_min_ps(a, b);
+}
+inline FloatVector simdAbs(FloatVector a)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+/*
+Comparison, every lane of the result is all ones if a < b, zero else.
+*/
+inline FloatVector simdLess(FloatVector a, FloatVector b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+/*
+Returns true if any lane of a comparison result is set.
+*/
+inline bool simdAny(FloatVector mask)
+{
+	return _mm_movemask_ps(mask) != 0;
+}
+/*
+Returns the lanes of a where the mask is set, the lanes of b else.
+*/
+inline FloatVector simdSelect(FloatVector mask, FloatVector a, FloatVector b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/*
+Returns the sum of the lanes.
+*/
+inline float simdSum(FloatVector a)
+{
+	__m128 b = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	b = _mm_add_ss(b, _mm_shuffle_ps(b, b, 1));
+	return _mm_cvtss_f32(b);
+}
+
+/*
+Loads 4 signed bytes, converted to floats.
+*/
+inline FloatVector simdLoadInt8(const int8_t* x)
+{
+	int32_t bytes;
+	memcpy(&bytes, x, sizeof(bytes));
+	__m128i v = _mm_cvtsi32_si128(bytes);
+	v = _mm_unpacklo_epi8(v, v);
+	v = _mm_unpacklo_epi16(v, v);
+	return _mm_cvtepi32_ps(_mm_srai_epi32(v, 24));
+}
+
+/*
+Loads 4 half precision floats, converted to single precision. Infinities and NaNs are not preserved.
+*/
+inline FloatVector simdLoadHalf(const uint16_t* x)
+{
+	__m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)x), _mm_setzero_si128());
+	__m128i sign = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x8000)), 16);
+	__m128i magnitude = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x7fff)), 13);
+
+	//rebias the exponent from 15 to 127. Subnormals are normalized by a float subtraction, the
+	//operands are normal floats, which avoids the slow path of denormal arithmetic.
+	__m128i normal = _mm_add_epi32(magnitude, _mm_set1_epi32(112 << 23));
+	__m128 subnormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(normal, _mm_set1_epi32(1 << 23))), _mm_set1_ps(6.103515625e-05f));
+	__m128 isSubnormal = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(magnitude, _mm_set1_epi32(0x0f800000)), _mm_setzero_si128()));
+	__m128 f = _mm_or_ps(_mm_and_ps(isSubnormal, subnormal), _mm_andnot_ps(isSubnormal, _mm_castsi128_ps(normal)));
+	return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+inline FloatVector simdExp(FloatVector x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+
+	//x = n * ln(2) + r, |r| <= ln(2) / 2.
+	__m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+	__m128 fn = _mm_cvtepi32_ps(n);
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+	__m128 p = _mm_set1_ps(1.9875691500e-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+	p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), _mm_add_ps(r, _mm_set1_ps(1.0f)));
+
+	//scale by 2^n.
+	__m128i e = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(e));
+}
+
+/*
+Natural logarithm of positive, normal x.
+*/
+inline FloatVector simdLog(FloatVector x)
+{
+	//x = m * 2^e, sqrt(0.5) <= m < sqrt(2).
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126));
+	__m128 m = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff))), _mm_set1_ps(0.5f));
+	__m128 fe = _mm_cvtepi32_ps(e);
+
+	__m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+	fe = _mm_sub_ps(fe, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+	m = _mm_add_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_and_ps(small, m));
+
+	__m128 z = _mm_mul_ps(m, m);
+	__m128 p = _mm_set1_ps(7.0376836292e-2f);
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.1514610310e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.1676998740e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.2420140846e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.4249322787e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.6668057665e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.0000714765e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-2.4999993993e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.3333331174e-1f));
+	p = _mm_mul_ps(_mm_mul_ps(p, m), z);
+
+	p = _mm_add_ps(p, _mm_mul_ps(fe, _mm_set1_ps(-2.12194440e-4f)));
+	p = _mm_sub_ps(p, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	return _mm_add_ps(_mm_add_ps(m, p), _mm_mul_ps(fe, _mm_set1_ps(0.693359375f)));
+}
+
+#else
+
+struct FloatVector
+{
+	float v[SIMD_WIDTH];
+};
+
+inline FloatVector simdLoad(const float* x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = x[i];
+	return r;
+}
+inline void simdStore(float* x, FloatVector a)
+{
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		x[i] = a.v[i];
+}
+inline FloatVector simdSet(float x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = x;
+	return r;
+}
+inline FloatVector simdSet(float x0, float x1, float x2, float x3)
+{
+	FloatVector r;
+	r.v[0] = x0;
+	r.v[1] = x1;
+	r.v[2] = x2;
+	r.v[3] = x3;
+	return r;
+}
+
+#define SIMD_LANEWISE(name, expression) \
+	inline FloatVector name(FloatVector a, FloatVector b) \
+	{ \
+		FloatVector r; \
+		for (int i = 0; i < SIMD_WIDTH; i++) \
+			r.v[i] = expression; \
+		return r; \
+	}
+
+SIMD_LANEWISE(simdAdd, a.v[i] + b.v[i])
+SIMD_LANEWISE(simdSub, a.v[i] - b.v[i])
+SIMD_LANEWISE(simdMul, a.v[i] * b.v[i])
+SIMD_LANEWISE(simdDiv, a.v[i] / b.v[i])
+SIMD_LANEWISE(simdMax, (a.v[i] > b.v[i]) ? a.v[i] : b.v[i])
+SIMD_LANEWISE(simdMin, (a.v[i] < b.v[i]) ? a.v[i] : b.v[i])
+SIMD_LANEWISE(simdLess, (a.v[i] < b.v[i]) ? 1.0f : 0.0f)
+
+#undef SIMD_LANEWISE
+
+inline FloatVector simdMulAdd(FloatVector a, FloatVector b, FloatVector c)
+{
+	return simdAdd(simdMul(a, b), c);
+}
+inline FloatVector simdAbs(FloatVector a)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = fabs(a.v[i]);
+	return r;
+}
+inline bool simdAny(FloatVector mask)
+{
+	for (int i = 0; i < SIMD_WIDTH; i++)
+	{
+		if (mask.v[i] != 0.0f)
+			return true;
+	}
+	return false;
+}
+inline FloatVector simdSelect(FloatVector mask, FloatVector a, FloatVector b)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = (mask.v[i] != 0.0f) ? a.v[i] : b.v[i];
+	return r;
+}
+inline float simdSum(FloatVector a)
+{
+	return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]);
+}
+inline FloatVector simdLoadInt8(const int8_t* x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = (float)x[i];
+	return r;
+}
+inline FloatVector simdLoadHalf(const uint16_t* x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+	{
+		uint32_t sign = (uint32_t)(x[i] & 0x8000) << 16;
+		uint32_t bits = ((uint32_t)(x[i] & 0x7fff) << 13) + (112 << 23);
+		float f;
+		if ((x[i] & 0x7c00) == 0)
+		{
+			bits += 1 << 23;
+			memcpy(&f, &bits, sizeof(f));
+			f -= 6.103515625e-05f;	//2^-14
+			memcpy(&bits, &f, sizeof(f));
+		}
+		bits |= sign;
+		memcpy(&r.v[i], &bits, sizeof(bits));
+	}
+	return r;
+}
+inline FloatVector simdExp(FloatVector x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = exp(x.v[i]);
+	return r;
+}
+inline FloatVector simdLog(FloatVector x)
+{
+	FloatVector r;
+	for (int i = 0; i < SIMD_WIDTH; i++)
+		r.v[i] = log(x.v[i]);
+	return r;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <SoftmaxLoss.h>
+#include <cmath>
+
+SoftmaxLoss::SoftmaxLoss(std::vector<Sample*>& samples, float* sampleWeights, int numClasses, double l2Regularization) : _samples(samples)
+{
+	_sampleWeights = sampleWeights;
+	_k = numClasses;
+	_n = _samples[0]->n();
+	_m = _n + 1;
+	_l2Regularization = l2Regularization;
+	_numDataPasses = 0;
+
+	_weightSum = 0.0;
+	for (int i = 0; i < _samples.size(); i++)
+		_weightSum += (_sampleWeights != nullptr) ? _sampleWeights[i] : 1.0;
+
+	_x = new double[SOFTMAX_BLOCK_SIZE * _m];
+	_z = new double[SOFTMAX_BLOCK_SIZE * _k];
+	_wt = new double[_m * _k];
+}
+
+SoftmaxLoss::~SoftmaxLoss()
+{
+	delete[] _x;
+	delete[] _z;
+	delete[] _wt;
+}
+
+int SoftmaxLoss::size()
+{
+	return _k * _m;
+}
+
+double SoftmaxLoss::evaluate(double* x, double* gradient)
+{
+	_numDataPasses++;
+
+	for (int j = 0; j < _k * _m; j++)
+		gradient[j] = 0.0;
+
+	double loss = 0.0;
+	int numSamples = _samples.size();
+	for (int start = 0; start < numSamples; start += SOFTMAX_BLOCK_SIZE)
+	{
+		int count = (numSamples - start < SOFTMAX_BLOCK_SIZE) ? numSamples - start : SOFTMAX_BLOCK_SIZE;
+
+		//gather the block, followed by a 1 for the bias.
+		for (int i = 0; i < count; i++)
+		{
+			Sample* sample = _samples[start + i];
+			double* xi = &_x[i * _m];
+			for (int j = 0; j < _n; j++)
+				xi[j] = sample->x(j);
+			xi[_n] = 1.0;
+		}
+
+		blockScores(x, count);
+
+		//replace the scores with the loss derivatives s * (p - y).
+		for (int i = 0; i < count; i++)
+		{
+			double* zi = &_z[i * _k];
+			int y = _samples[start + i]->y();
+			double s = ((_sampleWeights != nullptr) ? _sampleWeights[start + i] : 1.0) / _weightSum;
+
+			//numerically stable log(sum(exp(z))).
+			double zy = zi[y];
+			double zMax = zi[0];
+			for (int c = 1; c < _k; c++)
+				zMax = fmax(zMax, zi[c]);
+
+			double expSum = 0.0;
+			for (int c = 0; c < _k; c++)
+			{
+				zi[c] = exp(zi[c] - zMax);
+				expSum += zi[c];
+			}
+			loss += s * (zMax + log(expSum) - zy);
+
+			for (int c = 0; c < _k; c++)
+				zi[c] = s * (zi[c] / expSum - ((c == y) ? 1.0 : 0.0));
+		}
+
+		blockGradient(gradient, count);
+	}
+
+	//add the L2 penalty, the biases are not penalized.
+	for (int c = 0; c < _k; c++)
+	{
+		for (int j = 0; j < _n; j++)
+		{
+			double w = x[c * _m + j];
+			loss += 0.5 * _l2Regularization * w * w;
+			gradient[c * _m + j] += _l2Regularization * w;
+		}
+	}
+	return loss;
+}
+
+void SoftmaxLoss::blockScores(double* w, int count)
+{
+	//transpose the weights, so that the scores of a sample are accumulated with contiguous
+	//updates over the classes, z[i] += x[i][j] * w'[j].
+	for (int c = 0; c < _k; c++)
+	{
+		for (int j = 0; j < _m; j++)
+			_wt[j * _k + c] = w[c * _m + j];
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		double* xi = &_x[i * _m];
+		double* zi = &_z[i * _k];
+		for (int c = 0; c < _k; c++)
+			zi[c] = 0.0;
+
+		for (int j = 0; j < _m; j++)
+		{
+			double xij = xi[j];
+			double* wj = &_wt[j * _k];
+			for (int c = 0; c < _k; c++)
+				zi[c] += xij * wj[c];
+		}
+	}
+}
+
+void SoftmaxLoss::blockGradient(double* gradient, int count)
+{
+	//the gradient row of a class stays in cache while the block is accumulated into it.
+	for (int c = 0; c < _k; c++)
+	{
+		double* gc = &gradient[c * _m];
+		for (int i = 0; i < count; i++)
+		{
+			double d = _z[i * _k + c];
+			double* xi = &_x[i * _m];
+			for (int j = 0; j < _m; j++)
+				gc[j] += d * xi[j];
+		}
+	}
+}
+
+int SoftmaxLoss::numDataPasses()
+{
+	return _numDataPasses;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+SoftmaxLoss.h
+Weighted cross entropy loss of a multinomial logistic (softmax) model over k classes, as an
+Objective for the full batch optimizers. The loss and the gradient of every class are computed
+in a single pass over the training set.
+
+The parameters are a k x (n + 1) matrix, stored row by row, where row c holds the weights of
+class c followed by its bias. An L2 penalty on the weights keeps the minimum finite when the
+training set is separable.
+
+loss = sum(si * (log(sum(exp(zic))) - ziyi)) / sum(si) + 0.5 * l2 * |W|^2, zic = wc.xi + bc
+*/
+
+#pragma once
+#include <Optimizer.h>
+#include <Sample.h>
+#include <vector>
+
+//number of samples processed together by the matrix kernels.
+#define SOFTMAX_BLOCK_SIZE 64
+
+class SoftmaxLoss : public Objective
+{
+public:
+	/*
+	Constructor:
+	std::vector<Sample*>& samples: training set, with labels in [0, numClasses).
+	float* sampleWeights: weight of each sample, nullptr for uniform weights.
+	int numClasses: number of classes k.
+	double l2Regularization: weight of the L2 penalty.
+	*/
+	SoftmaxLoss(std::vector<Sample*>& samples, float* sampleWeights, int numClasses, double l2Regularization);
+	virtual ~SoftmaxLoss();
+
+	virtual int size();
+	virtual double evaluate(double* x, double* gradient);
+
+	/*
+	Returns the number of passes over the training set.
+	*/
+	int numDataPasses();
+
+private:
+	/*
+	Computes the class scores of a block of 'count' samples, z = X * W', where X holds the samples
+	of the block row by row, each followed by a 1 for the bias.
+	*/
+	void blockScores(double* w, int count);
+
+	/*
+	Accumulates the gradient of a block of samples, g += D' * X, where D holds the derivatives of
+	the loss with respect to the class scores.
+	*/
+	void blockGradient(double* gradient, int count);
+
+	std::vector<Sample*>& _samples;
+	float* _sampleWeights;
+	int _k;	//number of classes.
+	int _n;	//number of attributes in a sample.
+	int _m;	//number of parameters of a class, n + 1.
+	double _l2Regularization;
+	double _weightSum;
+
+	double* _x;	//samples of the current block, SOFTMAX_BLOCK_SIZE x m.
+	double* _z;	//class scores, then loss derivatives, of the current block, SOFTMAX_BLOCK_SIZE x k.
+	double* _wt;	//transposed parameters, m x k.
+
+	int _numDataPasses;
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include <SortedAttributes.h>
+#include <algorithm>
+
+SortedAttributes::SortedAttributes(std::vector<Sample*>& samples)
+{
+	_numSamples = samples.size();
+	_n = (_numSamples > 0) ? samples[0]->n() : 0;
+	_indices = new int32_t[(size_t)_n * _numSamples];
+	_values = new float[(size_t)_n * _numSamples];
+	_samples = samples;
+
+	for (int a = 0; a < _n; a++)
+	{
+		int32_t* indices = &_indices[(size_t)a * _numSamples];
+		float* values = &_values[(size_t)a * _numSamples];
+		for (int i = 0; i < _numSamples; i++)
+			indices[i] = i;
+
+		std::sort(indices, indices + _numSamples, [&](int32_t i, int32_t j)
+		{
+			float xi = samples[i]->x(a);
+			float xj = samples[j]->x(a);
+			return xi < xj || (xi == xj && i < j);
+		});
+
+		for (int i = 0; i < _numSamples; i++)
+			values[i] = samples[indices[i]]->x(a);
+	}
+}
+
+SortedAttributes::~SortedAttributes()
+{
+	delete[] _indices;
+	delete[] _values;
+}
+
+bool SortedAttributes::matches(std::vector<Sample*>& samples)
+{
+	return samples == _samples;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+SortedAttributes.h
+Dataset scoped cache of the sample order of every attribute, the presorted attribute lists of SLIQ and
+SPRINT. The samples of each attribute are sorted once by value, with the sample index and the value
+stored side by side, so the exact split search of DecisionTree sweeps the sorted values of a node in a
+single pass. Partitioning a node keeps each list sorted, so no node sorts its samples again.
+
+The order does not depend on the class index or the sample weights, so a single instance serves every
+DecisionTree trained on the same sample set, e.g. every class and round of an AdaBoost model.
+*/
+
+#pragma once
+#include <WeakLearner.h>
+#include <vector>
+#include <stdint.h>
+
+class SortedAttributes : public TrainingCache
+{
+public:
+	SortedAttributes(std::vector<Sample*>& samples);
+	virtual ~SortedAttributes();
+
+	/*
+	Returns the indices of the samples for an attribute, in increasing order of the attribute value.
+	Samples of equal value are in increasing index order.
+	*/
+	const int32_t* indices(int attribute)
+	{
+		return &_indices[(size_t)attribute * _numSamples];
+	}
+
+	/*
+	Returns the sorted values of an attribute, the value of sample indices(attribute)[j] at j.
+	*/
+	const float* values(int attribute)
+	{
+		return &_values[(size_t)attribute * _numSamples];
+	}
+
+	/*
+	Returns true if the order was computed for the training set 'samples'.
+	*/
+	bool matches(std::vector<Sample*>& samples);
+
+	int numSamples()
+	{
+		return _numSamples;
+	}
+
+	int n()
+	{
+		return _n;
+	}
+
+private:
+	int32_t* _indices;	//sorted sample indices of every attribute, n x numSamples.
+	float* _values;	//sorted values of every attribute, n x numSamples.
+	int _numSamples;
+	int _n;
+
+	std::vector<Sample*> _samples;
+};
\ No newline at end of file
@@ -1,27 +1,44 @@
-#include <svm.h>
+#include <Svm.h>
+#include <KernelCache.h>
+#include <random>
 
 Svm::Svm() : WeakLearner()
 {
 	_w = nullptr;
 	_b = 0.0f;
 	_n = 0;
+	_quantizedW = nullptr;
+	_alpha = nullptr;
+	_numAlpha = 0;
+	_warmStarted = false;
+	_seed = 0;
 }
 
 Svm::~Svm()
 {
-	delete[] _w;
+	releaseWeights();
+	delete[] _alpha;
 }
 
 void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex)
 {
 	int numSamples = samples.size();
 
+	//use the shared kernel cache if one was created for the training set. Otherwise
+	//only precompute the sample norms.
+	KernelCache* kernelCache = dynamic_cast<KernelCache*>(_trainingCache);
+	KernelCache* localKernelCache = nullptr;
+	if (kernelCache == nullptr || !kernelCache->matches(samples))
+	{
+		localKernelCache = new KernelCache(samples, 0);
+		kernelCache = localKernelCache;
+	}
+
 	//get the number of vector samples.
 	_n = samples[0]->n();
 
 	//init the plane normal.
-	if (_w != nullptr)
-		delete[] _w;
+	releaseWeights();
 
 	_w = new float[_n];
 	for (int n = 0; n < _n; n++)
@@ -29,18 +46,62 @@ void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIn
 		_w[n] = 0.0f;
 	}
 
-	//init the plane offset
-	_b = 0.0f;
+	//init the multipliers. If the learner was warm started, start from the previous multipliers
+	//rescaled to the bounds given by the new sample weights, and the previous plane offset.
+	if (!_warmStarted || _numAlpha != numSamples)
+	{
+		delete[] _alpha;
+		_alpha = new float[numSamples];
+		_numAlpha = numSamples;
+		for (int i = 0; i < numSamples; i++)
+			_alpha[i] = 0.0f;
 
-	float* alpha = new float[numSamples];
+		//init the plane offset
+		_b = 0.0f;
+	}
+	else
+	{
+		for (int i = 0; i < numSamples; i++)
+			_alpha[i] = fmin(fmax(_alpha[i], 0.0f), 1.0f) * C * sampleWeights[i] * (float)numSamples;
 
-	for (int i = 0; i < numSamples; i++)
-		alpha[i] = 0.0f;
+		//the pairwise updates keep the sum of alpha * y, restore it to 0 by shrinking the multipliers
+		//of the label of the larger sum, which keeps them within their bounds.
+		double positiveSum = 0.0;
+		double negativeSum = 0.0;
+		for (int i = 0; i < numSamples; i++)
+		{
+			if (binaryLabel(samples[i]->y(), classIndex) > 0)
+				positiveSum += _alpha[i];
+			else
+				negativeSum += _alpha[i];
+		}
+		for (int i = 0; i < numSamples; i++)
+		{
+			if (binaryLabel(samples[i]->y(), classIndex) > 0 && positiveSum > negativeSum)
+				_alpha[i] = (float)(_alpha[i] * negativeSum / positiveSum);
+			else if (binaryLabel(samples[i]->y(), classIndex) < 0 && negativeSum > positiveSum)
+				_alpha[i] = (float)(_alpha[i] * positiveSum / negativeSum);
+		}
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			for (int vIndex = 0; vIndex < _n; vIndex++)
+			{
+				_w[vIndex] += _alpha[i] * (float)binaryLabel(samples[i]->y(), classIndex) * samples[i]->x(vIndex);
+			}
+		}
+	}
+	_warmStarted = false;
+
+	float* alpha = _alpha;
+	std::minstd_rand random(_seed);
 
 	int numPasses = 0;
+	_numIterations = 0;
 	//iterate until the training weights are unchanged for a certain number of iterations.
 	while (numPasses < MAX_PASSES)
 	{
+		_numIterations++;
 		bool alphaModified = false;
 		for (int i = 0; i < numSamples; i++)
 		{
@@ -65,7 +126,7 @@ void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIn
 				int j;
 				while (true)
 				{
-					j = rand() % numSamples;
+					j = random() % numSamples;
 					if (i != j)
 						break;
 				}
@@ -77,23 +138,30 @@ void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIn
 				float a1Old = a1;
 				float a2Old = a2;
 
+				//the boundary hyperparameter of the second sample.
+				float slackToleranceJ = C * sampleWeights[j] * (float)numSamples;
+
 				//compute the optimal parameters.
 				float L, H;
 				if (binaryLabel(xi->y(), classIndex) * binaryLabel(xj->y(), classIndex) < 0.0f)
 				{
 					L = fmax(0.0f, a2Old - a1Old);
-					H = fmin(slackTolerance, slackTolerance + a2Old - a1Old);
+					H = fmin(slackToleranceJ, slackTolerance + a2Old - a1Old);
 				}
 				else
 				{
 					L = fmax(0.0f, a1Old + a2Old - slackTolerance);
-					H = fmin(slackTolerance, a1Old + a2Old);
+					H = fmin(slackToleranceJ, a1Old + a2Old);
 				}
 
 				float e1 = g1 - (float)binaryLabel(xi->y(), classIndex);
 				float e2 = g2 - (float)binaryLabel(xj->y(), classIndex);
 
-				float n = 2.0f * innerProduct(xi, xj) - innerProduct(xi, xi) - innerProduct(xj, xj);
+				float kij = kernelCache->innerProduct(i, j);
+				float kii = kernelCache->norm(i);
+				float kjj = kernelCache->norm(j);
+
+				float n = 2.0f * kij - kii - kjj;
 				if (n == 0.0f)
 					break;
 
@@ -102,33 +170,31 @@ void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIn
 				a2 = fmin(a2, H);
 				a2 = fmax(a2, L);
 
+				//the pair can not make progress, move on to the next sample.
+				if (fabs(a2 - a2Old) < 1e-5f)
+					continue;
+
 				a1 = a1Old + (binaryLabel(xi->y(), classIndex) * binaryLabel(xj->y(), classIndex)) * (a2Old - a2);
+				a1 = fmin(fmax(a1, 0.0f), slackTolerance);
 
 				alpha[i] = a1;
 				alpha[j] = a2;
 
-				//compute w
+				//update the hyperplane normal by the changes of the two multipliers.
+				float di = binaryLabel(xi->y(), classIndex) * (a1 - a1Old);
+				float dj = binaryLabel(xj->y(), classIndex) * (a2 - a2Old);
 				for (int vIndex = 0; vIndex < _n; vIndex++)
-					_w[vIndex] = 0.0f;
-
-				//recompute the hyperplane normal.
-				for (int i = 0; i < numSamples; i++)
-				{
-					for (int vIndex = 0; vIndex < _n; vIndex++)
-					{
-						_w[vIndex] += alpha[i] * (float)binaryLabel(samples[i]->y(), classIndex) * samples[i]->x(vIndex);
-					}
-				}
+					_w[vIndex] += di * xi->x(vIndex) + dj * xj->x(vIndex);
 
 				//recompute the hyperplane bias.
-				float b1 = _b - e1 - binaryLabel(xi->y(), classIndex) * (a1 - a1Old) * innerProduct(xi, xi) - binaryLabel(xj->y(), classIndex) * (a2 - a2Old) * innerProduct(xi, xj);
-				float b2 = _b - e2 - binaryLabel(xi->y(), classIndex) + (a1 - a1Old) * innerProduct(xi, xj) - binaryLabel(xj->y(), classIndex) * (a2 * a2Old) * innerProduct(xj, xj);
+				float b1 = _b - e1 - binaryLabel(xi->y(), classIndex) * (a1 - a1Old) * kii - binaryLabel(xj->y(), classIndex) * (a2 - a2Old) * kij;
+				float b2 = _b - e2 - binaryLabel(xi->y(), classIndex) * (a1 - a1Old) * kij - binaryLabel(xj->y(), classIndex) * (a2 - a2Old) * kjj;
 
 				if (a1 > 0.0f && a1 < slackTolerance)
 				{
 					_b = b1;
 				}
-				else if (a2 > 0.0f && a2 < slackTolerance)
+				else if (a2 > 0.0f && a2 < slackToleranceJ)
 				{
 					_b = b2;
 				}
@@ -147,24 +213,62 @@ void Svm::train(std::vector<Sample*>& samples, float* sampleWeights, int classIn
 			numPasses = 0;
 	}
 	
-	delete[] alpha;
+	//store the multipliers relative to their bounds, the bounds of the next round differ. The
+	//multiplier of a sample of weight 0 is bound to 0.
+	for (int i = 0; i < numSamples; i++)
+	{
+		float bound = C * sampleWeights[i] * (float)numSamples;
+		_alpha[i] = (bound > 0.0f) ? _alpha[i] / bound : 0.0f;
+	}
+
+	delete localKernelCache;
 }
 
 /*
-Computes the inner product / dot product between two samples x0 and x1.
+Starts the next training call from the multipliers and plane offset of 'previous'.
 */
-float Svm::innerProduct(Sample* x0, Sample* x1)
+void Svm::warmStart(WeakLearner* previous)
 {
-	float dp = 0.0f;
-	for (int i = 0; i < x0->n(); i++)
-	{
-		dp += x0->x(i) * x1->x(i);
-	}
-	return dp;
+	Svm* svm = dynamic_cast<Svm*>(previous);
+	if (svm == nullptr || svm->_alpha == nullptr)
+		return;
+
+	delete[] _alpha;
+	_numAlpha = svm->_numAlpha;
+	_alpha = new float[_numAlpha];
+	for (int i = 0; i < _numAlpha; i++)
+		_alpha[i] = svm->_alpha[i];
+	_b = svm->_b;
+	_warmStarted = true;
+}
+
+void Svm::releaseWarmStart()
+{
+	delete[] _alpha;
+	_alpha = nullptr;
+	_numAlpha = 0;
+}
+
+void Svm::setRandomSeed(unsigned int seed)
+{
+	_seed = seed;
+}
+
+WeakLearner* Svm::create()
+{
+	return new Svm();
+}
+
+TrainingCache* Svm::createTrainingCache(std::vector<Sample*>& samples)
+{
+	return new KernelCache(samples);
 }
 
 float Svm::label(Sample* x)
 {
+	if (_quantizedW != nullptr)
+		return _quantizedW->dot(x->data()) + _b;
+
 	float sum = 0.0f;
 	for (int i = 0; i < _n; i++)
 	{
@@ -176,22 +280,113 @@ float Svm::label(Sample* x)
 
 void Svm::exportInternal(std::string& params)
 {
+	std::vector<float> buffer;
+	float* w = floatWeights(buffer);
 	params += std::to_string(_n) + WEAK_LEARNER_DELIM;
 
 	for (int i = 0; i < _n; i++)
 	{
-		params += std::to_string(_w[i]) + WEAK_LEARNER_DELIM;
+		params += std::to_string(w[i]) + WEAK_LEARNER_DELIM;
 	}
 	params += std::to_string(_b) + WEAK_LEARNER_DELIM;
 }
-void Svm::importInternal(std::string& params)
+void Svm::importInternal(ParamReader& params)
 {
-	_n = atoi(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+	_n = params.nextInt(WEAK_LEARNER_DELIM);
 
+	releaseWeights();
 	_w = new float[_n];
 	for (int i = 0; i < _n; i++)
 	{
-		_w[i] = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+		_w[i] = params.nextFloat(WEAK_LEARNER_DELIM);
 	}
-	_b = atof(getNextParam(params, WEAK_LEARNER_DELIM).c_str());
+	_b = params.nextFloat(WEAK_LEARNER_DELIM);
+}
+
+//tag of the binary parameters.
+#define SVM_BINARY_TAG 0x204d5653
+
+/*
+Binary parameters: uint32 tag, int32 n, float b, uint32 reserved, float w[n] (aligned).
+*/
+void Svm::exportBinary(BinaryWriter& writer)
+{
+	std::vector<float> buffer;
+	writer.write((uint32_t)SVM_BINARY_TAG);
+	writer.write((int32_t)_n);
+	writer.write(_b);
+	writer.write((uint32_t)0);
+	writer.writeArray(floatWeights(buffer), _n);
+}
+
+bool Svm::importBinary(BinaryReader& reader, int n)
+{
+	uint32_t tag;
+	int32_t size;
+	float b;
+	uint32_t reserved;
+	if (!reader.read(tag) || tag != SVM_BINARY_TAG)
+		return false;
+	if (!reader.read(size) || !reader.read(b) || !reader.read(reserved) || size != n)
+		return false;
+
+	float* w = reader.readArray<float>(n);
+	if (w == nullptr)
+		return false;
+
+	releaseWeights();
+	_w = w;
+	_b = b;
+	_n = n;
+	_mappedParams = true;
+	return true;
+}
+
+void Svm::releaseWeights()
+{
+	if (!_mappedParams)
+		delete[] _w;
+	_w = nullptr;
+	_mappedParams = false;
+
+	delete _quantizedW;
+	_quantizedW = nullptr;
+}
+
+float* Svm::floatWeights(std::vector<float>& buffer)
+{
+	if (_quantizedW == nullptr)
+		return _w;
+
+	buffer.resize(_n);
+	_quantizedW->dequantize(buffer.data());
+	return buffer.data();
+}
+
+void Svm::quantize(QuantizationType type)
+{
+	//restore the float plane normal first.
+	if (_quantizedW != nullptr)
+	{
+		float* w = new float[_n];
+		_quantizedW->dequantize(w);
+		releaseWeights();
+		_w = w;
+	}
+	if (_w == nullptr || type == QUANTIZE_NONE)
+		return;
+
+	QuantizedArray* quantizedW = new QuantizedArray(_w, _n, type);
+	releaseWeights();
+	_quantizedW = quantizedW;
+}
+
+size_t Svm::parameterSize()
+{
+	size_t size = sizeof(_b);
+	if (_quantizedW != nullptr)
+		size += _quantizedW->sizeInBytes();
+	else if (_w != nullptr)
+		size += _n * sizeof(float);
+	return size;
 }
\ No newline at end of file
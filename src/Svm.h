@@ -1,43 +1,81 @@
-/*
-Support Vector Machine.
-Solves for a separating hyperplane between samples of two classes.
-SVM is solved using the sequential minization optimization (smo) algorithm.
-
-Greg Smith
-gregjksmith@gmail.com
-*/
-
-#pragma once
-#include <WeakLearner.h>
-
-//equality tolerance, two samples are considered equal if ther vary by EQUALITY_TOLERANCE
-#define EQUALITY_TOLERANCE 0.01f
-
-//SVM hyperparameter, which allows for soft boundaries.
-#define C 0.05f
-
-//number of non-changing iterations, until the algorithm stops.
-#define MAX_PASSES 10
-
-class Svm : public WeakLearner
-{
-public:
-	Svm();
-	virtual ~Svm();
-	virtual float label(Sample* x);
-	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
-
-protected:
-	virtual void exportInternal(std::string& params);
-	virtual void importInternal(std::string& params);
-
-private:
-	float* _w; //hyperplane normal	
-	float _b; //hyperplane bias
-	int _n; //vector size of each training sample.
-
-	/*
-	Computes the inner product / dot product between two samples x0 and x1. 
-	*/
-	float innerProduct(Sample* x0, Sample* x1);
+/*
+Support Vector Machine.
+Solves for a separating hyperplane between samples of two classes.
+SVM is solved using the sequential minization optimization (smo) algorithm.
+
+Greg Smith
+gregjksmith@gmail.com
+*/
+
+#pragma once
+#include <WeakLearner.h>
+
+//equality tolerance, two samples are considered equal if ther vary by EQUALITY_TOLERANCE
+#define EQUALITY_TOLERANCE 0.01f
+
+//SVM hyperparameter, which allows for soft boundaries.
+#define C 0.05f
+
+//number of non-changing iterations, until the algorithm stops.
+#define MAX_PASSES 10
+
+class Svm : public WeakLearner
+{
+public:
+	Svm();
+	virtual ~Svm();
+	virtual float label(Sample* x);
+	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex);
+	virtual WeakLearner* create();
+
+	/*
+	Creates a KernelCache of the training set, shared by every Svm trained on 'samples'.
+	*/
+	virtual TrainingCache* createTrainingCache(std::vector<Sample*>& samples);
+
+	/*
+	Starts the next training call from the multipliers and plane offset of 'previous'.
+	*/
+	virtual void warmStart(WeakLearner* previous);
+
+	/*
+	Releases the multipliers kept to warm start the next round.
+	*/
+	virtual void releaseWarmStart();
+
+	/*
+	Seeds the choice of the second multiplier of every SMO step.
+	*/
+	virtual void setRandomSeed(unsigned int seed);
+
+	virtual void exportBinary(BinaryWriter& writer);
+	virtual bool importBinary(BinaryReader& reader, int n);
+
+	virtual void quantize(QuantizationType type);
+	virtual size_t parameterSize();
+
+protected:
+	virtual void exportInternal(std::string& params);
+	virtual void importInternal(ParamReader& params);
+
+private:
+	/*
+	Releases the plane normal, unless it references a binary model.
+	*/
+	void releaseWeights();
+
+	/*
+	Returns the plane normal, dequantized into 'buffer' if it is quantized.
+	*/
+	float* floatWeights(std::vector<float>& buffer);
+
+	float* _w; //hyperplane normal	
+	float _b; //hyperplane bias
+	int _n; //vector size of each training sample.
+	QuantizedArray* _quantizedW;	//quantized plane normal, replacing _w.
+
+	float* _alpha; //lagrange multipliers relative to their bounds, kept to warm start the next round.
+	int _numAlpha; //number of lagrange multipliers.
+	bool _warmStarted; //true if _alpha and _b hold the initial solution of the next training call.
+	unsigned int _seed; //seed of the choice of the second multiplier.
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <ThreadPool.h>
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads)
+{
+	_task = nullptr;
+	_count = 0;
+	_next = 0;
+	_numRunning = 0;
+	_loop = 0;
+	_stop = false;
+
+	if (numThreads <= 0)
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	for (int t = 0; t < numThreads; t++)
+		_threads.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_start.notify_all();
+
+	for (int t = 0; t < _threads.size(); t++)
+		_threads[t].join();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_task = &task;
+	_count = count;
+	_next = 0;
+	_loop++;
+	_start.notify_all();
+
+	_done.wait(lock, [this]() { return _next >= _count && _numRunning == 0; });
+	_task = nullptr;
+}
+
+int ThreadPool::numThreads()
+{
+	return _threads.size();
+}
+
+void ThreadPool::work()
+{
+	long long loop = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_start.wait(lock, [&]() { return _stop || _loop != loop; });
+		if (_stop)
+			return;
+		loop = _loop;
+
+		//run the iterations of the loop, the lock is released while an iteration executes.
+		while (_next < _count)
+		{
+			int i = _next++;
+			_numRunning++;
+			lock.unlock();
+			(*_task)(i);
+			lock.lock();
+			_numRunning--;
+		}
+
+		if (_numRunning == 0)
+			_done.notify_all();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+ThreadPool.h
+Fixed set of worker threads which execute the iterations of parallel loops. The threads are started
+once and wait between loops, so that many short loops, e.g. one per training call, do not pay for
+creating threads.
+*/
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	/*
+	Starts 'numThreads' worker threads. A numThreads of 0 uses every hardware thread.
+	*/
+	ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	/*
+	Calls task(i) for every i in [0, count) on the worker threads, and returns when every call has
+	returned. The iterations are handed out one at a time, in order, to the next idle thread, so
+	iterations of uneven cost are balanced. The calls must not call parallelFor of the same pool.
+	*/
+	void parallelFor(int count, const std::function<void(int)>& task);
+
+	int numThreads();
+
+private:
+	/*
+	Loop of a worker thread: waits for a parallel loop, and runs its iterations until none is left.
+	*/
+	void work();
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _start;	//signals a new loop, or the shutdown.
+	std::condition_variable _done;	//signals the end of the last iteration of a loop.
+
+	const std::function<void(int)>* _task;	//task of the current loop.
+	int _count;	//number of iterations of the current loop.
+	int _next;	//next iteration handed out.
+	int _numRunning;	//number of iterations being executed.
+	long long _loop;	//number of loops started, a worker waits for the next one.
+	bool _stop;
+};
\ No newline at end of file
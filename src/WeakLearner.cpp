@@ -1,90 +1,198 @@
-/*
-WeakLearner.cpp
-Base abstact class which provides an interface for training a set of samples,
-computing the estimated label given a sample and computing the training error given a
-training set.
-
-All supervised classification algorithms derive from this class.
-
-Greg Smith
-gregjksmith@gmail.com
-*/
-
-#include <WeakLearner.h>
-
-WeakLearner::WeakLearner()
-{
-}
-
-WeakLearner::~WeakLearner()
-{
-
-}
-
-/*
-Trains a supervised learning algorithm given a set of samples and a set class.
-Training is performed one agains many, where the sample is considered positive (+1)
-if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
-
-std::vector<Sample*> samples: input training set;
-int classIndex: positive class Index.
-*/
-void WeakLearner::train(std::vector<Sample*>& samples, int classIndex)
-{
-	//no sample weighting is specified. Call the training algoirithm
-	//using uniform sampling.
-	int sampleSize = samples.size();
-	float* w = new float[sampleSize];
-	for (int i = 0; i < sampleSize; i++)
-	{
-		w[i] = 1.0f / (float)sampleSize;
-	}
-	train(samples, w, classIndex);
-
-	delete[] w;
-}
-
-/*
-Trains a supervised learning algorithm given a set of samples and a set class.
-Training is performed one agains many, where the sample is considered positive (+1)
-if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
-
-std::vector<Sample*> samples: input training set;
-int classIndex: positive class Index.
-float* sampleWeights: provides a mechansism to weight samples during samples. Utilized with AdaBoost.
-*/
-float WeakLearner::error(std::vector<Sample*>& samples, int classIndex)
-{
-	int numErrors = 0;
-	for (int i = 0; i < samples.size(); i++)
-	{
-		Sample* x = samples[i];
-		float l = label(x);
-		if (l * binaryLabel(x->y(), classIndex) <= 0.0f)
-			numErrors++;
-	}
-	return (float)numErrors / (float)samples.size();
-}
-
-/*
-Returns 1.0 if the two class indices match, -1.0 else.
-*/
-float WeakLearner::binaryLabel(int class0, int class1)
-{
-	if (class0 == class1)
-		return 1.0f;
-	return -1.0f;
-}
-
-std::string WeakLearner::exportParams()
-{
-	std::string params;
-	exportInternal(params);
-
-	return params;
-}
-
-void WeakLearner::importParams(std::string& params)
-{
-	importInternal(params);
+/*
+WeakLearner.cpp
+Base abstact class which provides an interface for training a set of samples,
+computing the estimated label given a sample and computing the training error given a
+training set.
+
+All supervised classification algorithms derive from this class.
+
+Greg Smith
+gregjksmith@gmail.com
+*/
+
+#include <WeakLearner.h>
+
+WeakLearner::WeakLearner()
+{
+	_trainingCache = nullptr;
+	_numIterations = 0;
+	_fastMath = false;
+	_mappedParams = false;
+}
+
+WeakLearner::~WeakLearner()
+{
+
+}
+
+void WeakLearner::labelBatch(std::vector<Sample*>& samples, float* labels)
+{
+	for (int i = 0; i < samples.size(); i++)
+		labels[i] = label(samples[i]);
+}
+
+/*
+Trains a supervised learning algorithm given a set of samples and a set class.
+Training is performed one agains many, where the sample is considered positive (+1)
+if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
+
+std::vector<Sample*> samples: input training set;
+int classIndex: positive class Index.
+*/
+void WeakLearner::train(std::vector<Sample*>& samples, int classIndex)
+{
+	//no sample weighting is specified. Call the training algoirithm
+	//using uniform sampling.
+	int sampleSize = samples.size();
+	float* w = new float[sampleSize];
+	for (int i = 0; i < sampleSize; i++)
+	{
+		w[i] = 1.0f / (float)sampleSize;
+	}
+	train(samples, w, classIndex);
+
+	delete[] w;
+}
+
+/*
+Trains a supervised learning algorithm given a set of samples and a set class.
+Training is performed one agains many, where the sample is considered positive (+1)
+if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
+
+std::vector<Sample*> samples: input training set;
+int classIndex: positive class Index.
+float* sampleWeights: provides a mechansism to weight samples during samples. Utilized with AdaBoost.
+*/
+float WeakLearner::error(std::vector<Sample*>& samples, int classIndex)
+{
+	int numErrors = 0;
+	for (int i = 0; i < samples.size(); i++)
+	{
+		Sample* x = samples[i];
+		float l = label(x);
+		if (l * binaryLabel(x->y(), classIndex) <= 0.0f)
+			numErrors++;
+	}
+	return (float)numErrors / (float)samples.size();
+}
+
+/*
+Creates the dataset scoped cache used by the learner when training on 'samples'.
+The base learner does not use a cache.
+*/
+TrainingCache* WeakLearner::createTrainingCache(std::vector<Sample*>&)
+{
+	return nullptr;
+}
+
+void WeakLearner::setTrainingCache(TrainingCache* cache)
+{
+	_trainingCache = cache;
+}
+
+/*
+Seeds the next call to train with the solution of a previously trained learner.
+The base learner has no solver state, the warm start is ignored.
+*/
+void WeakLearner::warmStart(WeakLearner*)
+{
+}
+
+void WeakLearner::releaseWarmStart()
+{
+}
+
+void WeakLearner::setRandomSeed(unsigned int)
+{
+}
+
+bool WeakLearner::jointTraining()
+{
+	return false;
+}
+
+bool WeakLearner::trainClasses(std::vector<Sample*>&, float**, const int*, int, WeakLearner**)
+{
+	return false;
+}
+
+int WeakLearner::numIterations()
+{
+	return _numIterations;
+}
+
+void WeakLearner::setFastMath(bool fastMath)
+{
+	_fastMath = fastMath;
+}
+
+bool WeakLearner::fastMath()
+{
+	return _fastMath;
+}
+
+/*
+Returns 1.0 if the two class indices match, -1.0 else.
+*/
+float WeakLearner::binaryLabel(int class0, int class1)
+{
+	if (class0 == class1)
+		return 1.0f;
+	return -1.0f;
+}
+
+void WeakLearner::quantize(QuantizationType)
+{
+}
+
+size_t WeakLearner::parameterSize()
+{
+	return 0;
+}
+
+std::string WeakLearner::exportParams()
+{
+	std::string params;
+	exportInternal(params);
+
+	return params;
+}
+
+void WeakLearner::importParams(std::string& params)
+{
+	ParamReader reader(params);
+	importInternal(reader);
+	params.erase(0, reader.position());
+}
+
+void WeakLearner::importParams(ParamReader& params)
+{
+	importInternal(params);
+}
+
+//tag of the text parameters of a binary model.
+#define TEXT_BINARY_TAG 0x54584554
+
+void WeakLearner::exportBinary(BinaryWriter& writer)
+{
+	std::string params = exportParams();
+	writer.write((uint32_t)TEXT_BINARY_TAG);
+	writer.write((int32_t)params.size());
+	writer.writeArray(params.data(), params.size());
+}
+
+bool WeakLearner::importBinary(BinaryReader& reader, int)
+{
+	uint32_t tag;
+	int32_t size;
+	if (!reader.read(tag) || tag != TEXT_BINARY_TAG || !reader.read(size))
+		return false;
+
+	const char* data = reader.readArray<const char>(size);
+	if (data == nullptr)
+		return false;
+
+	ParamReader params(std::string_view(data, size));
+	importParams(params);
+	return true;
 }
\ No newline at end of file
@@ -1,64 +1,183 @@
-/*
-WeakLearner.h
-Base abstact class which provides an interface for training a set of samples, 
-computing the estimated label given a sample and computing the training error given a
-training set.
-
-All supervised classification algorithms derive from this class.
-
-Greg Smith
-gregjksmith@gmail.com
-*/
-
-#pragma once
-#include <Sample.h>
-#include <vector>
-#include <fstream>
-#include <string>
-#include <ExportStringUtils.h>
-
-/*
-WeakLearner. Base Learner class. All supervised algorithms derive from this class.
-*/
-class WeakLearner
-{
-public:
-	WeakLearner();
-	virtual ~WeakLearner();
-
-	/*
-	Computes the estimated label betwen [-1,1] of a sample given the learned
-	parameters of the algorithm.
-	*/
-	virtual float label(Sample* x) = 0;
-	
-	/*
-	Trains a supervised learning algorithm given a set of samples and a set class.
-	Training is performed one agains many, where the sample is considered positive (+1)
-	if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
-	
-	std::vector<Sample*> samples: input training set;
-	int classIndex: positive class Index.
-	float* sampleWeights: provides a mechansism to weight samples during samples. Utilized with AdaBoost.
-	*/
-	void train(std::vector<Sample*>& samples, int classIndex);
-	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex) = 0;
-
-	/*
-	Computes the classification error on a labeled data set 'samples', with classIndex.
-	*/
-	virtual float error(std::vector<Sample*>& samples, int classIndex);
-
-	std::string exportParams();
-
-	void importParams(std::string& params);
-
-protected:
-	/*
-	Returns 1.0 if the two class indices match, -1.0 else.
-	*/
-	virtual float binaryLabel(int class0, int class1);
-
-	virtual void exportInternal(std::string& params) = 0;
-	virtual void importInternal(std::string& params) = 0;
+/*
+WeakLearner.h
+Base abstact class which provides an interface for training a set of samples, 
+computing the estimated label given a sample and computing the training error given a
+training set.
+
+All supervised classification algorithms derive from this class.
+
+Greg Smith
+gregjksmith@gmail.com
+*/
+
+#pragma once
+#include <Sample.h>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <ExportStringUtils.h>
+#include <BinaryFormat.h>
+#include <Quantization.h>
+
+/*
+TrainingCache. Base class for data computed once per training set and shared between every
+weak learner trained on that set, e.g. each class and each boosting round of an AdaBoost model.
+*/
+class TrainingCache
+{
+public:
+	virtual ~TrainingCache() {}
+};
+
+/*
+WeakLearner. Base Learner class. All supervised algorithms derive from this class.
+*/
+class WeakLearner
+{
+public:
+	WeakLearner();
+	virtual ~WeakLearner();
+
+	/*
+	Computes the estimated label betwen [-1,1] of a sample given the learned
+	parameters of the algorithm.
+	*/
+	virtual float label(Sample* x) = 0;
+	
+	/*
+	Computes the estimated labels of every sample in 'samples', stored in 'labels'.
+	Learners with a vectorized inference kernel override this, the base learner calls label.
+	*/
+	virtual void labelBatch(std::vector<Sample*>& samples, float* labels);
+
+	/*
+	Trains a supervised learning algorithm given a set of samples and a set class.
+	Training is performed one agains many, where the sample is considered positive (+1)
+	if it matches the desired class negative 'classIndex' and negative (-1) if it does not.
+	
+	std::vector<Sample*> samples: input training set;
+	int classIndex: positive class Index.
+	float* sampleWeights: provides a mechansism to weight samples during samples. Utilized with AdaBoost.
+	*/
+	void train(std::vector<Sample*>& samples, int classIndex);
+	virtual void train(std::vector<Sample*>& samples, float* sampleWeights, int classIndex) = 0;
+
+	/*
+	Creates a new, untrained learner with the same training configuration.
+	*/
+	virtual WeakLearner* create() = 0;
+
+	/*
+	Computes the classification error on a labeled data set 'samples', with classIndex.
+	*/
+	virtual float error(std::vector<Sample*>& samples, int classIndex);
+
+	/*
+	Creates the dataset scoped cache used by the learner when training on 'samples'.
+	Returns nullptr if the learner does not use a cache. The caller owns the cache.
+	*/
+	virtual TrainingCache* createTrainingCache(std::vector<Sample*>& samples);
+
+	/*
+	Sets the cache used by the next call to train. The cache must have been created
+	for the same training set, and must outlive the training call.
+	*/
+	void setTrainingCache(TrainingCache* cache);
+
+	/*
+	Seeds the next call to train with the solution of a previously trained learner of the
+	same type and class index, e.g. the learner of the previous boosting round.
+	Learners without an iterative solver ignore the warm start.
+	*/
+	virtual void warmStart(WeakLearner* previous);
+
+	/*
+	Releases the state kept by train to warm start a later learner, e.g. the multipliers of an Svm,
+	once no learner will be warm started from this one. The model is unchanged.
+	*/
+	virtual void releaseWarmStart();
+
+	/*
+	Seeds the random choices of the next call to train, e.g. the attributes sampled by a DecisionTree,
+	such that learners trained concurrently do not share a random generator. Learners without random
+	choices ignore the seed.
+	*/
+	virtual void setRandomSeed(unsigned int seed);
+
+	/*
+	Returns true if trainClasses trains learners of this configuration jointly.
+	*/
+	virtual bool jointTraining();
+
+	/*
+	Trains 'numClasses' learners created by create on the same training set, learner c for class
+	classIndices[c] with the sample weights sampleWeights[c], as if each was trained by train. Learners
+	which share the passes over the training set between the classes override it, e.g. DecisionTree.
+	Returns false if the learners were not trained, the caller then trains each learner with train.
+	*/
+	virtual bool trainClasses(std::vector<Sample*>& samples, float** sampleWeights, const int* classIndices, int numClasses, WeakLearner** learners);
+
+	/*
+	Returns the number of solver iterations performed by the last call to train.
+	*/
+	int numIterations();
+
+	/*
+	If fastMath is true, the learner uses the approximations of FastMath.h in place of exp and
+	log, in training and in inference. Learners without transcendental functions ignore it.
+	*/
+	void setFastMath(bool fastMath);
+	bool fastMath();
+
+	/*
+	Quantizes the parameters used for inference, see Quantization.h. The float parameters are
+	released, exported models hold the dequantized values, and training the learner again
+	discards the quantization. QUANTIZE_NONE restores float parameters with the dequantized
+	values. Learners without quantized inference kernels ignore it.
+	*/
+	virtual void quantize(QuantizationType type);
+
+	/*
+	Returns the size in bytes of the parameters used for inference, 0 if unknown.
+	*/
+	virtual size_t parameterSize();
+
+	std::string exportParams();
+
+	/*
+	Loads the text parameters at the start of 'params', which are removed from the string.
+	*/
+	void importParams(std::string& params);
+
+	/*
+	Loads the text parameters at the cursor of 'params'.
+	*/
+	void importParams(ParamReader& params);
+
+	/*
+	Appends the parameters of the learner to a binary model. The base learner stores its text parameters.
+	*/
+	virtual void exportBinary(BinaryWriter& writer);
+
+	/*
+	Loads the parameters of the learner from a binary model. The parameter arrays reference the model
+	data without copying, the data must outlive the learner or the next training call.
+	int n: number of attributes of the samples of the model.
+	Returns false if the data is not valid for the learner, or references attributes beyond n.
+	*/
+	virtual bool importBinary(BinaryReader& reader, int n);
+
+protected:
+	/*
+	Returns 1.0 if the two class indices match, -1.0 else.
+	*/
+	virtual float binaryLabel(int class0, int class1);
+
+	virtual void exportInternal(std::string& params) = 0;
+	virtual void importInternal(ParamReader& params) = 0;
+
+	TrainingCache* _trainingCache;	//dataset scoped cache, not owned.
+	int _numIterations;	//solver iterations of the last training call.
+	bool _fastMath;
+	bool _mappedParams;	//true if the parameter arrays reference binary model data, not owned by the learner.
 };
\ No newline at end of file
@@ -1,113 +1,410 @@
-/*
-Training Examples:
-
-Greg Smith
-gregjksmith@gmail.com
-*/
-
-#include <stdio.h>
-#include <vector>
-#include <random>
-#include <Sample.h>
-#include <AdaBoost.h>
-#include <LogisticRegression.h>
-#include <DecisionTree.h>
-#include <NaiveBayes.h>
-#include <Svm.h>
-
-float gaussianRV(float var)
-{
-	float xMax = sqrt(9.21f * var);
-	
-	while (true)
-	{
-		float xSample = (rand() / (float)RAND_MAX - 0.5f) * 2.0f * xMax;
-		float p = exp(-pow(xSample, 2.0f) / (2.0f * var));
-		float a = rand() / (float)RAND_MAX;
-		if (a < p)
-			return xSample;
-	}
-}
-
-void computeRandomTrainingSet(std::vector<Sample*>& samples, int attributeSize, int numSamples, float var)
-{
-	float* x = new float[attributeSize];
-	for (int i = 0; i < numSamples; i++)
-	{
-		int y = rand() % attributeSize;
-		for (int j = 0; j < attributeSize; j++)
-		{
-			if (j == y)
-				x[j] = 1.0f;
-			else
-				x[j] = -1.0f;
-			
-			float rv = gaussianRV(var);
-			x[j] += rv;
-		}
-
-		Sample* s = new Sample(x, y, attributeSize);
-		samples.push_back(s);
-	}
-	delete[] x;
-}
-
-void main()
-{
-	std::vector<Sample*> samples;
-	const int numSamples = 1000;
-	const int numClasses = 10;
-	const float sampleVariance = 0.125f;
-	const int numWeakLearners[] = { 1,2,5 };
-	computeRandomTrainingSet(samples, numClasses, numSamples, sampleVariance);
-
-
-	printf("Training set, num samples: %i, num classes: %i, sample variance: %0.2f\n", numSamples, numClasses, sampleVariance);
-	
-	//test Naive Bayes
-	for (int i = 0; i < 3; i++)
-	{
-		auto naiveBayes = new AdaBoost<NaiveBayes>(samples, numWeakLearners[i]);
-		float error = naiveBayes->error(samples);
-
-		printf("Training Naive Bayes: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
-
-		delete naiveBayes;
-	}
-
-		
-	//test Decision Tree
-	for (int i = 0; i < 3; i++)
-	{
-		auto decisionTree = new AdaBoost<DecisionTree>(samples, numWeakLearners[i]);
-		float error = decisionTree->error(samples);
-
-		printf("Training Decision Tree: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
-
-		delete decisionTree;
-	}
-
-	//test Logistic Regression
-	for (int i = 0; i < 3; i++)
-	{
-		auto logisticRegression = new AdaBoost<LogisticRegression>(samples, numWeakLearners[i]);
-		float error = logisticRegression->error(samples);
-
-		printf("Training Logistic Regression: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
-
-		delete logisticRegression;
-	}
-
-	//test SVM
-	for (int i = 0; i < 3; i++)
-	{
-		auto svm = new AdaBoost<LogisticRegression>(samples, numWeakLearners[i]);
-		float error = svm->error(samples);
-
-		printf("Training SVM: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
-
-		delete svm;
-	}
-
-	system("pause");
+/*
+Training Examples:
+
+Greg Smith
+gregjksmith@gmail.com
+*/
+
+#include <stdio.h>
+#include <vector>
+#include <random>
+#include <Sample.h>
+#include <AdaBoost.h>
+#include <Bagging.h>
+#include <GradientBoosting.h>
+#include <LogisticRegression.h>
+#include <MultinomialLogisticRegression.h>
+#include <DecisionTree.h>
+#include <NaiveBayes.h>
+#include <Svm.h>
+#include <FastMath.h>
+#include <QuantileSketch.h>
+#include <OutOfCoreTree.h>
+#include <Allreduce.h>
+#include <ctime>
+
+float gaussianRV(float var)
+{
+	float xMax = sqrt(9.21f * var);
+	
+	while (true)
+	{
+		float xSample = (rand() / (float)RAND_MAX - 0.5f) * 2.0f * xMax;
+		float p = exp(-pow(xSample, 2.0f) / (2.0f * var));
+		float a = rand() / (float)RAND_MAX;
+		if (a < p)
+			return xSample;
+	}
+}
+
+void computeRandomTrainingSet(std::vector<Sample*>& samples, int attributeSize, int numSamples, float var)
+{
+	float* x = new float[attributeSize];
+	for (int i = 0; i < numSamples; i++)
+	{
+		int y = rand() % attributeSize;
+		for (int j = 0; j < attributeSize; j++)
+		{
+			if (j == y)
+				x[j] = 1.0f;
+			else
+				x[j] = -1.0f;
+			
+			float rv = gaussianRV(var);
+			x[j] += rv;
+		}
+
+		Sample* s = new Sample(x, y, attributeSize);
+		samples.push_back(s);
+	}
+	delete[] x;
+}
+
+/*
+Compares the fast math approximations with the standard library: the maximum error over a dense
+grid of arguments, and the time per value.
+*/
+void benchmarkFastMath()
+{
+	const int numValues = 1 << 20;
+	const int numRepeats = 20;
+	float* x = new float[numValues];
+	float* y = new float[numValues];
+
+	//maximum errors.
+	double expError = 0.0;
+	double logError = 0.0;
+	double sigmoidError = 0.0;
+	for (int i = 0; i < numValues; i++)
+	{
+		float t = (float)i / (float)numValues;
+
+		float xExp = -87.0f + 175.0f * t;
+		expError = fmax(expError, fabs(fastExp(xExp) - exp((double)xExp)) / exp((double)xExp));
+
+		float xLog = 0.5f + 1.5f * t;
+		logError = fmax(logError, fabs(fastLog(xLog) - log((double)xLog)));
+
+		float xSigmoid = -40.0f + 80.0f * t;
+		sigmoidError = fmax(sigmoidError, fabs(fastSigmoid(xSigmoid) - 1.0 / (1.0 + exp(-(double)xSigmoid))));
+	}
+	printf("Fast math maximum error: exp (relative) %0.2e, log (absolute, [0.5, 2]) %0.2e, sigmoid (absolute) %0.2e\n", expError, logError, sigmoidError);
+
+	//time per value.
+	for (int i = 0; i < numValues; i++)
+		x[i] = (rand() / (float)RAND_MAX - 0.5f) * 20.0f;
+
+	clock_t start = clock();
+	for (int r = 0; r < numRepeats; r++)
+	{
+		for (int i = 0; i < numValues; i++)
+			y[i] = exp(x[i]);
+	}
+	double libmExp = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < numRepeats; r++)
+		fastExp(x, y, numValues);
+	double simdExp = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < numRepeats; r++)
+	{
+		for (int i = 0; i < numValues; i++)
+			y[i] = 1.0f / (1.0f + exp(-x[i]));
+	}
+	double libmSigmoid = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < numRepeats; r++)
+		fastSigmoid(x, y, numValues);
+	double simdSigmoid = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	double scale = 1e9 / ((double)numValues * numRepeats);
+	printf("Time per value (ns): exp %0.2f, fastExp %0.2f, sigmoid %0.2f, fastSigmoid %0.2f\n", libmExp * scale, simdExp * scale, libmSigmoid * scale, simdSigmoid * scale);
+
+	delete[] x;
+	delete[] y;
+}
+
+/*
+Times the import of a multi-megabyte text model, an AdaBoost<LogisticRegression> model with
+'numClasses' classes of 'numAttributes' weights each, and of the same model in the binary format.
+*/
+void benchmarkModelImport(int numAttributes, int numClasses)
+{
+	std::string params;
+	params += std::to_string(1) + ENSEMBLE_DELIM;
+	params += std::to_string(numAttributes) + ENSEMBLE_DELIM;
+	params += std::to_string(numClasses) + ENSEMBLE_DELIM;
+	for (int k = 0; k < numClasses; k++)
+	{
+		params += std::to_string(1.0f) + ENSEMBLE_DELIM;
+		params += std::to_string(numAttributes) + WEAK_LEARNER_DELIM;
+		for (int i = 0; i <= numAttributes; i++)
+			params += std::to_string(gaussianRV(1.0f)) + WEAK_LEARNER_DELIM;
+		params += ENSEMBLE_DELIM;
+	}
+	double size = params.size() / 1e6;
+
+	AdaBoost<LogisticRegression> model;
+	clock_t start = clock();
+	model.importParams(params);
+	double textImport = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	std::vector<char> buffer;
+	model.exportBinary(buffer);
+	AdaBoost<LogisticRegression> binaryModel;
+	start = clock();
+	binaryModel.importBinary(buffer.data(), buffer.size());
+	double binaryImport = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("Model import: text %0.1f MB in %0.3f s (%0.1f MB/s), binary %0.1f MB in %0.4f s\n", size, textImport, size / textImport, buffer.size() / 1e6, binaryImport);
+}
+
+void main()
+{
+	std::vector<Sample*> samples;
+	const int numSamples = 1000;
+	const int numClasses = 10;
+	const float sampleVariance = 0.125f;
+	const int numWeakLearners[] = { 1,2,5 };
+	computeRandomTrainingSet(samples, numClasses, numSamples, sampleVariance);
+
+
+	printf("Training set, num samples: %i, num classes: %i, sample variance: %0.2f\n", numSamples, numClasses, sampleVariance);
+	
+	//test Naive Bayes
+	for (int i = 0; i < 3; i++)
+	{
+		auto naiveBayes = new AdaBoost<NaiveBayes>(samples, numWeakLearners[i]);
+		float error = naiveBayes->error(samples);
+
+		printf("Training Naive Bayes: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
+
+		//statistics of the last boosting round of the first class.
+		const BoostingRound& round = naiveBayes->rounds(0).back();
+		printf("\tLast round of class 0: Weighted Error %0.6f, Training Error %0.6f, Exponential Loss %0.6f\n", round.error, round.trainingError, round.loss);
+
+		delete naiveBayes;
+	}
+
+		
+	//test Decision Tree
+	for (int i = 0; i < 3; i++)
+	{
+		auto decisionTree = new AdaBoost<DecisionTree>(samples, numWeakLearners[i]);
+		float error = decisionTree->error(samples);
+
+		printf("Training Decision Tree: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
+
+		delete decisionTree;
+	}
+
+	//test Logistic Regression
+	for (int i = 0; i < 3; i++)
+	{
+		auto logisticRegression = new AdaBoost<LogisticRegression>(samples, numWeakLearners[i]);
+		float error = logisticRegression->error(samples);
+
+		printf("Training Logistic Regression: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
+
+		delete logisticRegression;
+	}
+
+	//test Multinomial Logistic Regression, all classes are trained jointly.
+	{
+		auto multinomialLogisticRegression = new MultinomialLogisticRegression(samples);
+		float error = multinomialLogisticRegression->error(samples);
+
+		printf("Training Multinomial Logistic Regression: Data Passes: %i, Classification Error %0.6f\n", multinomialLogisticRegression->numDataPasses(), error);
+
+		delete multinomialLogisticRegression;
+	}
+
+	//test SVM
+	for (int i = 0; i < 3; i++)
+	{
+		auto svm = new AdaBoost<Svm>(samples, numWeakLearners[i]);
+		float error = svm->error(samples);
+
+		printf("Training SVM: Weak Learners: %i, Classification Error %0.6f\n", numWeakLearners[i], error);
+
+		delete svm;
+	}
+
+	//compare the fast math approximations with the standard library, and their effect on training.
+	benchmarkFastMath();
+	for (int fastMath = 0; fastMath < 2; fastMath++)
+	{
+		NaiveBayes prototype;
+		prototype.setFastMath(fastMath == 1);
+		auto naiveBayes = new AdaBoost<NaiveBayes>(samples, numWeakLearners[2], prototype);
+		float error = naiveBayes->error(samples);
+
+		printf("Training Naive Bayes: Fast Math: %i, Weak Learners: %i, Classification Error %0.6f\n", fastMath, numWeakLearners[2], error);
+
+		delete naiveBayes;
+	}
+
+	benchmarkModelImport(10000, 200);
+
+	//resume the boosting of an imported model.
+	{
+		auto naiveBayes = new AdaBoost<NaiveBayes>(samples, numWeakLearners[1]);
+		std::string params = naiveBayes->exportParams();
+		delete naiveBayes;
+
+		AdaBoost<NaiveBayes> resumed;
+		resumed.importParams(params);
+		resumed.continueTraining(samples, numWeakLearners[2] - numWeakLearners[1]);
+		printf("Resumed Naive Bayes: Weak Learners: %i, Classification Error %0.6f\n", resumed.numWeakLearners(), resumed.error(samples));
+	}
+
+	//compare the inference memory and the accuracy of the quantized models.
+	const QuantizationType quantizationTypes[] = { QUANTIZE_NONE, QUANTIZE_FP16, QUANTIZE_INT8 };
+	const char* quantizationNames[] = { "float", "fp16", "int8" };
+	for (int i = 0; i < 3; i++)
+	{
+		auto logisticRegression = new AdaBoost<LogisticRegression>(samples, numWeakLearners[2]);
+		logisticRegression->quantize(quantizationTypes[i]);
+		float error = logisticRegression->error(samples);
+
+		printf("Quantized Logistic Regression: %s, Parameter Size %i bytes, Classification Error %0.6f\n", quantizationNames[i], (int)logisticRegression->parameterSize(), error);
+
+		delete logisticRegression;
+	}
+
+	//stop the boosting of each class when the loss on a held-out set no longer improves.
+	{
+		std::vector<Sample*> validationSamples;
+		computeRandomTrainingSet(validationSamples, numClasses, numSamples / 4, sampleVariance * 8.0f);
+
+		std::vector<Sample*> noisySamples;
+		computeRandomTrainingSet(noisySamples, numClasses, numSamples, sampleVariance * 8.0f);
+
+		AdaBoost<NaiveBayes> naiveBayes;
+		naiveBayes.setValidationSet(&validationSamples, 5);
+		naiveBayes.continueTraining(noisySamples, 50);
+		printf("Early Stopping Naive Bayes: Weak Learners of class 0: %i of %i trained rounds, Validation Error %0.6f\n",
+			naiveBayes.numWeakLearners(0), (int)naiveBayes.rounds(0).size(), naiveBayes.error(validationSamples));
+
+		for (int i = 0; i < validationSamples.size(); i++)
+			delete validationSamples[i];
+		for (int i = 0; i < noisySamples.size(); i++)
+			delete noisySamples[i];
+	}
+
+	//random forest, trees on bootstrap samples with sqrt(n) attributes sampled per split, trained on every core.
+	{
+		DecisionTree prototype;
+		prototype.setAttributeSampling((int)sqrt((float)numClasses));
+		Bagging<DecisionTree> randomForest(samples, 20, prototype);
+		printf("Random Forest: Trees: %i, Out of Bag Error %0.6f, Classification Error %0.6f\n", randomForest.numWeakLearners(), randomForest.outOfBagError(), randomForest.error(samples));
+	}
+
+	//boosted decision trees of at most 16 leaves, split best first.
+	{
+		TreeGrowthLimits limits;
+		limits.maxLeaves = 16;
+		limits.leafWise = true;
+		DecisionTree prototype;
+		prototype.setGrowthLimits(limits);
+		//the leaves of bounded trees are impure, boosting must reduce the error of the first round.
+		AdaBoost<DecisionTree> boostedTrees(samples, 1, prototype);
+		float firstRoundError = boostedTrees.error(samples);
+		boostedTrees.continueTraining(samples, 9, prototype);
+		float error = boostedTrees.error(samples);
+		printf("Bounded Decision Trees: Parameter Size %i bytes, Classification Error %0.6f after 1 round, %0.6f after 10 rounds%s\n",
+			(int)boostedTrees.parameterSize(), firstRoundError, error, (error < firstRoundError) ? "" : ", boosting made no progress");
+
+		//the same trees, split at the entropy optimal thresholds of the presorted attributes.
+		prototype.setExactSplits(true);
+		AdaBoost<DecisionTree> exactTrees(samples, 10, prototype);
+		printf("Exact Split Decision Trees: Parameter Size %i bytes, Classification Error %0.6f\n", (int)exactTrees.parameterSize(), exactTrees.error(samples));
+
+		//the same trees, split at the bin edges of the quantiles of the training set, sketched in one pass.
+		prototype.setExactSplits(false);
+		prototype.setQuantileBins(NUM_BINS);
+		AdaBoost<DecisionTree> quantileTrees(samples, 10, prototype);
+		printf("Quantile Bin Decision Trees: Parameter Size %i bytes, Classification Error %0.6f\n", (int)quantileTrees.parameterSize(), quantileTrees.error(samples));
+	}
+
+	//gradient boosting of leaf-wise histogram trees, one tree per class and round.
+	{
+		GradientBoosting gradientBoosting(samples, 50);
+		printf("Gradient Boosting: Trees: %i, Nodes: %i, Classification Error %0.6f\n", gradientBoosting.numTrees(), gradientBoosting.numNodes(), gradientBoosting.error(samples));
+	}
+
+	//a tree trained level by level on a binned sample file, with the node of every sample kept on disk.
+	{
+		writeSampleFile("samples.bin", samples, nullptr);
+		FileSampleReader reader("samples.bin");
+		AttributeSketches sketches(reader.n());
+		sketches.add(reader);
+		AttributeBins bins = sketches.bins(NUM_BINS);
+		writeBinnedSampleFile("samples.binned", reader, bins);
+
+		TreeGrowthLimits limits;
+		limits.maxDepth = 8;
+		OutOfCoreTree outOfCoreTree("samples.binned", "nodes.bin");
+		outOfCoreTree.setGrowthLimits(limits);
+		DecisionTree tree;
+		outOfCoreTree.train(0, tree);
+		printf("Out of Core Decision Tree: Passes: %i, Nodes: %i, Classification Error of class 0 %0.6f\n", outOfCoreTree.numPasses(), tree.numNodes(), tree.error(samples, 0));
+
+		//the same tree and a logistic regression, trained by worker processes on shards of the training set.
+		//the workers sum their histograms and gradients, and train the same models.
+		int numWorkers = 4;
+		std::vector<std::vector<Sample*>> shards(numWorkers);
+		for (int i = 0; i < samples.size(); i++)
+			shards[i % numWorkers].push_back(samples[i]);
+		for (int r = 0; r < numWorkers; r++)
+		{
+			std::string path = "shard" + std::to_string(r);
+			writeSampleFile(path + ".bin", shards[r], nullptr);
+			FileSampleReader shardReader(path + ".bin");
+			writeBinnedSampleFile(path + ".binned", shardReader, bins);
+		}
+
+		bool trained = launchWorkers(numWorkers, [&](Allreduce& allreduce) {
+			std::string path = "shard" + std::to_string(allreduce.rank());
+			OutOfCoreTree shardTree(path + ".binned", path + ".nodes");
+			shardTree.setGrowthLimits(limits);
+			shardTree.setAllreduce(&allreduce);
+			DecisionTree distributedTree;
+			if (!shardTree.train(0, distributedTree))
+				return false;
+
+			LogisticRegression logisticRegression(LogisticRegression::LBFGS);
+			logisticRegression.setAllreduce(&allreduce);
+			std::vector<float> sampleWeights(shards[allreduce.rank()].size(), 1.0f);
+			logisticRegression.train(shards[allreduce.rank()], sampleWeights.data(), 0);
+			if (logisticRegression.failed())
+				return false;
+
+			if (allreduce.rank() == 0)
+			{
+				printf("Distributed Decision Tree: Workers: %i, Nodes: %i, Classification Error of class 0 %0.6f\n", numWorkers, distributedTree.numNodes(), distributedTree.error(samples, 0));
+				printf("Distributed Logistic Regression: Workers: %i, Classification Error of class 0 %0.6f\n", numWorkers, logisticRegression.error(samples, 0));
+			}
+			return allreduce.isOpen();
+		});
+		if (!trained)
+			printf("Distributed training failed\n");
+
+		for (int r = 0; r < numWorkers; r++)
+		{
+			std::string path = "shard" + std::to_string(r);
+			remove((path + ".bin").c_str());
+			remove((path + ".binned").c_str());
+			remove((path + ".nodes").c_str());
+		}
+
+		remove("samples.bin");
+		remove("samples.binned");
+		remove("nodes.bin");
+	}
+
+	system("pause");
 }
\ No newline at end of file